@@ -0,0 +1,387 @@
+//headless generator, runs the noise and biome pipeline without a window or render system
+//writes meshes, heightmaps and stats so planets can be generated on build machines
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Planet.h"
+#include "PlanetStats.h"
+#include "HeightmapExporter.h"
+#include "MeshExporter.h"
+#include "PlanetSweep.h"
+#include "ThumbnailRenderer.h"
+#include "PlanetRegression.h"
+#include "PlanetBenchmark.h"
+#include "Trace.h"
+#ifndef _WIN32
+#include "PlanetDaemon.h"
+#endif
+
+static void printUsage()
+{
+    std::printf(
+        "usage: ProcTerraBatch [options]\n"
+        "  --planet <file>             load the values from a planet.bin, defaults otherwise\n"
+        "  --params <file>             one Name=Value per line, # starts a comment\n"
+        "  --set <Name>=<Value>        one value, names are the PlanetParam ids e.g. Seed=42 or Frequency=0.8\n"
+        "  --out <path>                output path without extension, default ./planet\n"
+        "  --mesh <ply|glb>            export the mesh\n"
+        "  --mesh-sections <n>         sections of the exported mesh, default the planet sections\n"
+        "  --heightmap <cube|equirect> export the heightmap\n"
+        "  --heightmap-format <raw|pgm|png>\n"
+        "  --heightmap-width <n>       default 2048\n"
+        "  --stats                     write <out>.json\n"
+        "  --thumbnail <png|ppm>       render a preview on the cpu, always on for a sweep\n"
+        "  --thumbnail-width <n>       square, default 128, 0 for none\n"
+        "  --cache                     use the ./cache mesh cache\n"
+        "  --regression                generate the presets on 1 and all threads and check them against the stored face hashes\n"
+        "  --regression-print          print the face hashes of the presets in the form of the stored ones\n"
+        "  --memory                    print the cpu and gpu bytes of the planet, gpu values are what the app would create\n"
+        "  --memory-sections <list>    a,b,c, the report for each of these sections instead of the planet sections\n"
+        "benchmark, times the stages of generate() for every preset, --planet and --set are ignored\n"
+        "  --benchmark <file>          write the json report there\n"
+        "  --benchmark-sections <list> a,b,c, default 20,50,100,150,200,250,400\n"
+        "  --benchmark-repeats <n>     runs of each, the median is reported, default 5\n"
+        "  --jobs <n>                  also the threads of generate(), default all cores\n"
+        "sweep, every combination of the axes is generated in parallel into <out>.jsonl and thumbnails, no meshes or heightmaps\n"
+        "  --sweep <Name>=<values>     a,b,c or first..last or first..last:step, e.g. Seed=0..999\n"
+        "  --jobs <n>                  planets generated at once, default all cores\n"
+#ifdef PROCTERRA_TRACE
+        "  --trace <file>              record chrome trace events of everything after it, written on exit\n"
+#endif
+#ifndef _WIN32
+        "daemon, serves generation requests on a unix socket until SIGINT or SIGTERM, see PlanetDaemon.h for the protocol\n"
+        "  --daemon <socket>           path of the socket, --planet and --set are the base of every request\n"
+        "  --daemon-cache <MB>         results kept in memory, default 256\n"
+#endif
+        );
+}
+
+//Name=Value, prints what was wrong
+static bool setParam(Planet& planet, std::vector<std::string>& vecParams, const std::string& strAssignment)
+{
+    size_t nEquals = strAssignment.find('=');
+    if (nEquals == std::string::npos || !planet.setParam(strAssignment.substr(0, nEquals), strAssignment.substr(nEquals + 1)))
+    {
+        std::fprintf(stderr, "invalid parameter '%s'\n", strAssignment.c_str());
+        return false;
+    }
+    vecParams.emplace_back(strAssignment);
+    return true;
+}
+
+static bool readParamsFile(Planet& planet, std::vector<std::string>& vecParams, const std::string& strPath)
+{
+    std::ifstream file(strPath);
+    if (!file)
+    {
+        std::fprintf(stderr, "cannot open '%s'\n", strPath.c_str());
+        return false;
+    }
+    std::string strLine;
+    while (std::getline(file, strLine))
+    {
+        strLine = strLine.substr(0, strLine.find('#'));
+        strLine.erase(0, strLine.find_first_not_of(" \t\r"));
+        strLine.erase(strLine.find_last_not_of(" \t\r") + 1);
+        if (!strLine.empty() && !setParam(planet, vecParams, strLine))
+            return false;
+    }
+    return true;
+}
+
+//a,b,c
+static bool readSections(std::vector<size_t>& vecSections, const char* strValue)
+{
+    vecSections.clear();
+    for (const char* str = strValue; *str; str += *str == ',')
+    {
+        char* strEnd;
+        vecSections.emplace_back(std::strtoul(str, &strEnd, 10));
+        if (strEnd == str || vecSections.back() == 0)
+        {
+            std::fprintf(stderr, "invalid sections '%s'\n", strValue);
+            return false;
+        }
+        str = strEnd;
+    }
+    return true;
+}
+
+static void printMemory(const Planet& planet)
+{
+    PlanetMemory memory = planet.getMemoryUsage();
+    auto getMB = [](const size_t nBytes) { return nBytes / 1048576.0; };
+    std::printf("%zu sections, %zu vertices\n", planet.nSections, planet.nVertices * 6);
+    std::printf("  cpu grid        %10.2f MB\n", getMB(memory.nGridBytes));
+    std::printf("  cpu ring grid   %10.2f MB\n", getMB(memory.nRingGridBytes));
+    std::printf("  cpu faces       %10.2f MB\n", getMB(memory.nFaceBufferBytes));
+    std::printf("  cpu rings       %10.2f MB\n", getMB(memory.nRingBufferBytes));
+    std::printf("  cpu lod         %10.2f MB\n", getMB(memory.nLodBytes));
+    std::printf("  cpu ring debris %10.2f MB\n", getMB(memory.nRingDebrisBytes));
+    std::printf("  gpu face verts  %10.2f MB\n", getMB(memory.nGpuFaceVertexBytes));
+    std::printf("  gpu face index  %10.2f MB\n", getMB(memory.nGpuFaceIndexBytes));
+    std::printf("  gpu ring verts  %10.2f MB\n", getMB(memory.nGpuRingVertexBytes));
+    std::printf("  gpu ring index  %10.2f MB\n", getMB(memory.nGpuRingIndexBytes));
+    std::printf("  gpu lod index   %10.2f MB\n", getMB(memory.nGpuLodIndexBytes));
+    std::printf("  gpu ring debris %10.2f MB\n", getMB(memory.nGpuRingDebrisBytes));
+    std::printf("  total           %10.2f MB cpu, %.2f MB gpu%s\n", getMB(memory.getCpuBytes()), getMB(memory.getGpuBytes()), memory.bGpuEstimated ? " (estimated)" : "");
+}
+
+int main(int argc, char** argv)
+{
+    TRACE_THREAD_NAME("main");
+#ifdef PROCTERRA_TRACE
+    //written when main returns, whatever the mode
+    struct TraceWriter
+    {
+        std::string strPath;
+        ~TraceWriter()
+        {
+            if (!strPath.empty() && !Trace::stop(strPath))
+                std::fprintf(stderr, "cannot write '%s'\n", strPath.c_str());
+        }
+    } traceWriter;
+#endif
+    Planet planet(nullptr, MeshType::NORMAL_BIOMES, "Batch", 0);
+    planet.resetToDefaultValues();
+
+    std::string strOut = "./planet";
+    bool bMesh = false, bHeightmap = false, bStats = false, bThumbnail = false;
+    MeshFormat meshFormat = MeshFormat::GLB;
+    size_t nMeshSections = 0;
+    HeightmapLayout heightmapLayout = HeightmapLayout::Equirectangular;
+    HeightmapFormat heightmapFormat = HeightmapFormat::PNG16;
+    size_t nHeightmapWidth = 2048;
+    std::string strPlanetFile;
+    std::vector<std::string> vecParams, vecSweepAxes;
+    size_t nJobs = 0, nThumbnailWidth = SweepThumbnailWidth;
+    std::string strBenchmark;
+    std::vector<size_t> vecBenchmarkSections(std::begin(BenchmarkSections), std::end(BenchmarkSections));
+    size_t nBenchmarkRepeats = BenchmarkRepeats;
+    bool bMemory = false;
+    std::vector<size_t> vecMemorySections;
+    ThumbnailFormat thumbnailFormat = ThumbnailFormat::PNG;
+#ifndef _WIN32
+    std::string strDaemonSocket;
+    size_t nDaemonCacheBudget = DaemonCacheBudget;
+#endif
+
+    //--planet is applied first so the other values override it whatever the order
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (std::strcmp(argv[i], "--planet") != 0)
+            continue;
+        strPlanetFile = argv[i + 1];
+        if (!planet.readPlanetFile(strPlanetFile))
+        {
+            std::fprintf(stderr, "cannot read '%s'\n", argv[i + 1]);
+            return 1;
+        }
+    }
+    //nothing is written next to the app unless asked for
+    planet.bMeshCache = false;
+    planet.bBakeElevation = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string strArg = argv[i];
+        const char* strValue = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strArg == "--stats")
+            bStats = true;
+        else if (strArg == "--regression" || strArg == "--regression-print")
+            return PlanetRegression::run(strArg == "--regression-print") ? 0 : 1;
+        else if (strArg == "--cache")
+            planet.bMeshCache = true;
+        else if (strArg == "--memory")
+            bMemory = true;
+        else if (strArg == "--help" || strArg == "-h")
+        {
+            printUsage();
+            return 0;
+        }
+        else if (strValue == nullptr)
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            i++;
+            if (strArg == "--planet")
+                continue;
+            else if (strArg == "--params")
+            {
+                if (!readParamsFile(planet, vecParams, strValue))
+                    return 1;
+            }
+            else if (strArg == "--set")
+            {
+                if (!setParam(planet, vecParams, strValue))
+                    return 1;
+            }
+            else if (strArg == "--out")
+                strOut = strValue;
+            else if (strArg == "--mesh")
+            {
+                bMesh = true;
+                meshFormat = std::strcmp(strValue, "ply") == 0 ? MeshFormat::PLY : MeshFormat::GLB;
+            }
+            else if (strArg == "--mesh-sections")
+                nMeshSections = std::strtoul(strValue, nullptr, 10);
+            else if (strArg == "--heightmap")
+            {
+                bHeightmap = true;
+                heightmapLayout = std::strcmp(strValue, "cube") == 0 ? HeightmapLayout::CubeFaces : HeightmapLayout::Equirectangular;
+            }
+            else if (strArg == "--heightmap-format")
+                heightmapFormat = std::strcmp(strValue, "raw") == 0 ? HeightmapFormat::Raw16 : std::strcmp(strValue, "pgm") == 0 ? HeightmapFormat::PGM16 : HeightmapFormat::PNG16;
+            else if (strArg == "--heightmap-width")
+                nHeightmapWidth = std::strtoul(strValue, nullptr, 10);
+            else if (strArg == "--sweep")
+                vecSweepAxes.emplace_back(strValue);
+            else if (strArg == "--jobs")
+                nJobs = std::strtoul(strValue, nullptr, 10);
+            else if (strArg == "--thumbnail")
+            {
+                bThumbnail = true;
+                thumbnailFormat = std::strcmp(strValue, "ppm") == 0 ? ThumbnailFormat::PPM : ThumbnailFormat::PNG;
+            }
+            else if (strArg == "--thumbnail-width")
+                nThumbnailWidth = std::strtoul(strValue, nullptr, 10);
+#ifdef PROCTERRA_TRACE
+            else if (strArg == "--trace")
+            {
+                traceWriter.strPath = strValue;
+                Trace::start();
+            }
+#endif
+            else if (strArg == "--benchmark")
+                strBenchmark = strValue;
+            else if (strArg == "--benchmark-sections")
+            {
+                if (!readSections(vecBenchmarkSections, strValue))
+                    return 1;
+            }
+            else if (strArg == "--memory-sections")
+            {
+                bMemory = true;
+                if (!readSections(vecMemorySections, strValue))
+                    return 1;
+            }
+            else if (strArg == "--benchmark-repeats")
+                nBenchmarkRepeats = std::strtoul(strValue, nullptr, 10);
+#ifndef _WIN32
+            else if (strArg == "--daemon")
+                strDaemonSocket = strValue;
+            else if (strArg == "--daemon-cache")
+                nDaemonCacheBudget = std::strtoull(strValue, nullptr, 10) * 1024 * 1024;
+#endif
+            else
+            {
+                printUsage();
+                return 1;
+            }
+        }
+    }
+
+    if (!strBenchmark.empty())
+        return PlanetBenchmark::run(strBenchmark, vecBenchmarkSections, nBenchmarkRepeats, nJobs) ? 0 : 1;
+
+#ifndef _WIN32
+    if (!strDaemonSocket.empty())
+    {
+        PlanetDaemon daemon(strPlanetFile, vecParams, nDaemonCacheBudget);
+        return daemon.run(strDaemonSocket, nJobs) ? 0 : 1;
+    }
+#endif
+
+    if (!vecSweepAxes.empty())
+    {
+        PlanetSweep sweep(strPlanetFile, vecParams);
+        for (auto& strAxis : vecSweepAxes)
+        {
+            if (!sweep.addAxis(strAxis))
+            {
+                std::fprintf(stderr, "invalid sweep '%s'\n", strAxis.c_str());
+                return 1;
+            }
+        }
+        return sweep.run(strOut, nJobs, nThumbnailWidth, thumbnailFormat) ? 0 : 1;
+    }
+
+    //the buffers only reach their size once generated, headless faces arent clamped to 16 bit indices like the app
+    if (!vecMemorySections.empty())
+    {
+        for (size_t nSections : vecMemorySections)
+        {
+            planet.nSections = std::max(nSections, MinSections);
+            planet.initHeadless();
+            planet.generate();
+            printMemory(planet);
+        }
+        return 0;
+    }
+
+    auto timeStart = std::chrono::steady_clock::now();
+    planet.initHeadless();
+    planet.generate();
+    PlanetStats stats = PlanetStats::compute(planet);
+    stats.fGenerateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+    std::printf("generated %016llx in %.1f ms, content %016llx\n", static_cast<unsigned long long>(stats.meshHash), stats.fGenerateMs, static_cast<unsigned long long>(stats.contentHash));
+    planet.storeMeshCache();
+
+    if (bMemory)
+        printMemory(planet);
+
+    int iResult = 0;
+    if (bMesh)
+    {
+        MeshExporter meshExporter(planet);
+        if (!meshExporter.exportMesh(strOut, meshFormat, nMeshSections ? nMeshSections : planet.nSections))
+        {
+            std::fprintf(stderr, "mesh export failed\n");
+            iResult = 1;
+        }
+    }
+    if (bHeightmap)
+    {
+        HeightmapExporter heightmapExporter(planet);
+        if (!heightmapExporter.exportHeightmap(strOut, heightmapLayout, heightmapFormat, nHeightmapWidth, nHeightmapWidth / 2))
+        {
+            std::fprintf(stderr, "heightmap export failed\n");
+            iResult = 1;
+        }
+    }
+    if (bThumbnail && nThumbnailWidth)
+    {
+        auto timeRender = std::chrono::steady_clock::now();
+        ThumbnailSettings thumbnailSettings;
+        thumbnailSettings.nWidth = thumbnailSettings.nHeight = nThumbnailWidth;
+        ThumbnailRenderer thumbnail(planet);
+        thumbnail.render(thumbnailSettings);
+        std::printf("thumbnail in %.1f ms\n", std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeRender).count());
+        if (!thumbnail.write(strOut + (thumbnailFormat == ThumbnailFormat::PNG ? ".png" : ".ppm"), thumbnailFormat))
+        {
+            std::fprintf(stderr, "thumbnail export failed\n");
+            iResult = 1;
+        }
+    }
+    if (bStats)
+    {
+        FILE* file = std::fopen((strOut + ".json").c_str(), "w");
+        bool bWritten = file != nullptr && std::fputs(stats.toJson().c_str(), file) >= 0;
+        if (file != nullptr)
+            bWritten = std::fclose(file) == 0 && bWritten;
+        if (!bWritten)
+        {
+            std::fprintf(stderr, "cannot write '%s.json'\n", strOut.c_str());
+            iResult = 1;
+        }
+    }
+    return iResult;
+}
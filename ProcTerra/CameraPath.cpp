@@ -0,0 +1,115 @@
+#include "CameraPath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+//orientation of a camera looking along vDirection, ogre cameras look down -z
+static Ogre::Quaternion getLookRotation(const Ogre::Vector3& vDirection, const Ogre::Vector3& vUp)
+{
+    Ogre::Vector3 zAxis = -vDirection.normalisedCopy();
+    Ogre::Vector3 xAxis = vUp.crossProduct(zAxis).normalisedCopy();
+    Ogre::Vector3 yAxis = zAxis.crossProduct(xAxis);
+    return Ogre::Quaternion(xAxis, yAxis, zAxis);
+}
+
+void CameraPath::addKey(const float fTime, const Ogre::Vector3& vPosition, const Ogre::Quaternion& orientation)
+{
+    vecKeys.emplace_back(CameraKey{ fTime, vPosition, orientation });
+}
+
+void CameraPath::sample(const float fTime, Ogre::Vector3& vPosition, Ogre::Quaternion& orientation) const
+{
+    if (vecKeys.empty())
+        return;
+    //first key after fTime, keys with the same time are a cut
+    auto iter = std::upper_bound(vecKeys.begin(), vecKeys.end(), fTime, [](const float fTime, const CameraKey& key) { return fTime < key.fTime; });
+    if (iter == vecKeys.begin() || iter == vecKeys.end())
+    {
+        const CameraKey& key = iter == vecKeys.begin() ? vecKeys.front() : vecKeys.back();
+        vPosition = key.vPosition;
+        orientation = key.orientation;
+        return;
+    }
+    const CameraKey& next = *iter;
+    const CameraKey& prev = *(iter - 1);
+    float t = (fTime - prev.fTime) / (next.fTime - prev.fTime);
+    vPosition = prev.vPosition + (next.vPosition - prev.vPosition) * t;
+    orientation = Ogre::Quaternion::Slerp(t, prev.orientation, next.orientation, true);
+}
+
+bool CameraPath::read(const std::string& strPath)
+{
+    FILE* file = std::fopen(strPath.c_str(), "r");
+    if (file == nullptr)
+        return false;
+    vecKeys.clear();
+    char strLine[256];
+    while (std::fgets(strLine, sizeof(strLine), file))
+    {
+        if (strLine[0] == '#')
+            continue;
+        CameraKey key;
+        if (std::sscanf(strLine, "%f %f %f %f %f %f %f %f", &key.fTime, &key.vPosition.x, &key.vPosition.y, &key.vPosition.z,
+            &key.orientation.w, &key.orientation.x, &key.orientation.y, &key.orientation.z) != 8)
+            continue;
+        //keys have to be in order for sample()
+        if (!vecKeys.empty() && key.fTime < vecKeys.back().fTime)
+        {
+            vecKeys.clear();
+            break;
+        }
+        vecKeys.emplace_back(key);
+    }
+    std::fclose(file);
+    return !vecKeys.empty();
+}
+
+bool CameraPath::write(const std::string& strPath) const
+{
+    FILE* file = std::fopen(strPath.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    std::fprintf(file, "# ProcTerra camera path, time px py pz qw qx qy qz, positions in planet radii\n");
+    for (const auto& key : vecKeys)
+        std::fprintf(file, "%.4f %.6f %.6f %.6f %.6f %.6f %.6f %.6f\n", key.fTime, key.vPosition.x, key.vPosition.y, key.vPosition.z,
+            key.orientation.w, key.orientation.x, key.orientation.y, key.orientation.z);
+    return std::fclose(file) == 0;
+}
+
+CameraPath CameraPath::createDefault()
+{
+    const float fPi = 3.14159265f;
+    CameraPath path;
+    float fTime = 0.f;
+
+    //orbit once while zooming out from the startup distance, most of the planet in view
+    for (int i = 0; i <= static_cast<int>(12.f / CameraPathKeyInterval + 0.5f); i++)
+    {
+        float t = std::min(i * CameraPathKeyInterval, 12.f);
+        float fAngle = t / 12.f * 2.f * fPi;
+        float fDist = 3.3f + 2.5f * t / 12.f;
+        Ogre::Vector3 vPosition(std::sin(fAngle) * fDist, 0.3f * fDist, std::cos(fAngle) * fDist);
+        path.addKey(fTime + t, vPosition, getLookRotation(-vPosition, Ogre::Vector3::UNIT_Y));
+    }
+    fTime += 12.f;
+
+    //straight pass close over the surface, the lod levels change the whole way
+    for (int i = 0; i <= static_cast<int>(6.f / CameraPathKeyInterval + 0.5f); i++)
+    {
+        float t = std::min(i * CameraPathKeyInterval, 6.f);
+        Ogre::Vector3 vPosition(-4.f + 8.f * t / 6.f, 0.4f, 1.15f);
+        path.addKey(fTime + t, vPosition, getLookRotation(-vPosition, Ogre::Vector3::UNIT_Y));
+    }
+    fTime += 6.f;
+
+    //half way round the equator just above the surface, looking ahead and a little down like freelook
+    for (int i = 0; i <= static_cast<int>(12.f / CameraPathKeyInterval + 0.5f); i++)
+    {
+        float t = std::min(i * CameraPathKeyInterval, 12.f);
+        float fAngle = t / 12.f * fPi;
+        Ogre::Vector3 vUp(std::sin(fAngle), 0.f, std::cos(fAngle));
+        Ogre::Vector3 vAhead(std::cos(fAngle), 0.f, -std::sin(fAngle));
+        path.addKey(fTime + t, vUp * 1.15f, getLookRotation(vAhead - vUp * 0.15f, vUp));
+    }
+    return path;
+}
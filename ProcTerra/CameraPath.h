@@ -0,0 +1,32 @@
+#pragma once
+#include <Ogre.h>
+#include <string>
+#include <vector>
+
+constexpr float FlythroughStep = 1.f / 60.f;							//seconds of path and planet rotation per frame, whatever the frame took
+constexpr float CameraPathKeyInterval = 0.1f;							//seconds between recorded keys
+
+//camera position and orientation over time, positions are in planet radii so a path fits any resolution or dia multiplier
+struct CameraKey
+{
+	float fTime;
+	Ogre::Vector3 vPosition;
+	Ogre::Quaternion orientation;
+};
+
+class CameraPath
+{
+	std::vector<CameraKey> vecKeys;
+
+public:
+	void clear() { vecKeys.clear(); };
+	bool empty() const { return vecKeys.empty(); };
+	float getDuration() const { return vecKeys.empty() ? 0.f : vecKeys.back().fTime; };
+	void addKey(const float fTime, const Ogre::Vector3& vPosition, const Ogre::Quaternion& orientation);
+	void sample(const float fTime, Ogre::Vector3& vPosition, Ogre::Quaternion& orientation) const;	//interpolated, clamped to the ends
+	bool read(const std::string& strPath);																//text, a key per line: time px py pz qw qx qy qz
+	bool write(const std::string& strPath) const;
+
+	//orbit while zooming out, a close pass over the surface, then freelook along the equator
+	static CameraPath createDefault();
+};
@@ -1,4 +1,5 @@
 #include "Core.h"
+#include "Trace.h"
 #include <Ogre.h>
 #include <SDL.h>
 #include <SDL_syswm.h>
@@ -10,10 +11,13 @@
 #include <OgreOverlayContainer.h>
 #include <OgreTextAreaOverlayElement.h>
 #include <imgui.h>
+#include <chrono>
 
 Core::Core() :
 	OgreBites::ApplicationContext("Procedural Terra"),
 	lightType(LightType::AMBIENT),
+	sunlight(nullptr),
+	sunlightNode(nullptr),
 	colorAmbient(1.f, 1.f, 1.f),
 	colorSLDiffuse(.85f, 0.86, 0.86, 0.95),
 	fSLPowerScale(1.512f),
@@ -23,10 +27,100 @@ Core::Core() :
 	colorPrimary(Ogre::ColourValue::Black),
 	bWireFrame(false),
 	bToggleFreelook(false),
-	bToggleSkybox(true)
+	bToggleSkybox(true),
+	nFrameIndex(0),
+	nFrameCount(0),
+	bRecordFrames(false),
+	strFrameTimesPath("./frametimes.csv"),
+	nFrameGenerates(0),
+	nFrameUploads(0),
+	bFlythrough(false),
+	iFlythroughPreset(-1),
+	fPathTime(0.f),
+	bRecordPath(false),
+	fRecordTime(0.f),
+	strRecordPath("./camera.path"),
+	bIdleMode(true),
+	nActiveFrames(IdleSettleFrames),
+	fIdleSeconds(0.0),
+	nIdleWaits(0)
 {
 }
 
+void Core::recordFrameTimes(const std::string& strPath)
+{
+	strFrameTimesPath = strPath;
+	bRecordFrames = true;
+	frameRecorder.clear();
+}
+
+bool Core::runFlythrough(const std::string& strPathFile, const std::string& strOut)
+{
+	if (strPathFile.empty())
+		cameraPath = CameraPath::createDefault();
+	else if (!cameraPath.read(strPathFile))
+		return false;
+	strFlythroughOut = strOut;
+	bFlythrough = true;
+	return true;
+}
+
+void Core::run()
+{
+	//Root::startRendering() with a wait for the next event while nothing on screen would change
+	mRoot->getRenderSystem()->_initRenderTargets();
+	mRoot->clearEventTimes();
+	while (!mRoot->endRenderingQueued())
+	{
+		//pollEvents() in frameStarted handles what is queued, the frames after it let imgui and the camera settle
+		if (SDL_HasEvents(SDL_FIRSTEVENT, SDL_LASTEVENT))
+			nActiveFrames = IdleSettleFrames;
+		else if (isSceneStatic())
+		{
+			TRACE_SCOPE("Core::idle");
+			if (bRecordFrames)
+				frameRecorder.frameIdle();
+			auto timeIdle = std::chrono::steady_clock::now();
+			//null leaves the event queued, so the frame it wakes up for handles it with no delay
+			SDL_WaitEvent(nullptr);
+			fIdleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - timeIdle).count();
+			nIdleWaits++;
+			nActiveFrames = IdleSettleFrames;
+			//the wait isnt frame time, the freelook camera would jump by it
+			mRoot->clearEventTimes();
+		}
+		if (!mRoot->renderOneFrame())
+			break;
+	}
+}
+
+bool Core::isSceneStatic() const
+{
+	//anything that changes the picture on its own or is timed by frames keeps drawing, the gradient planet rotates with the planet
+	if (!bIdleMode || bFlythrough || bRecordPath || bSelected[8] || futureExport.valid())
+		return false;
+	if (planet->bYaw || planet->bPitch || planet->bRoll)
+		return false;
+	return nActiveFrames == 0;
+}
+
+CoreMemory Core::getMemoryUsage() const
+{
+	CoreMemory memory;
+	memory.planet = planet->getMemoryUsage();
+	memory.planetGradient = planetGradient->getMemoryUsage();
+	memory.nRttBytes = rttMiniScreen ? rttMiniScreen->getSize() : 0;
+	return memory;
+}
+
+void Core::recordCameraPath(const std::string& strPath)
+{
+	strRecordPath = strPath;
+	bRecordPath = true;
+	recordedPath.clear();
+	fRecordTime = 0.f;
+}
+
 //run
 bool Core::keyPressed(const OgreBites::KeyboardEvent& evt)
 {
@@ -118,11 +212,36 @@ bool Core::textInput(const OgreBites::TextInputEvent& evt)
 
 bool Core::frameStarted(const Ogre::FrameEvent& evt)
 {
+	TRACE_SCOPE("Core::frameStarted");
+	if (bRecordFrames)
+		frameRecorder.frameStarted();
+	if (bFlythrough)
+		flythroughRecorder.frameStarted();
+	nFrameGenerates = planet->getGenerateCount() + planetGradient->getGenerateCount();
+	nFrameUploads = planet->getUploadCount() + planetGradient->getUploadCount();
+	//cpu time of the update and ui below, not measured at all while the performance window is closed
+	bool bPerformance = bSelected[8];
+	std::chrono::steady_clock::time_point timeUpdate;
+	if (bPerformance)
+		timeUpdate = std::chrono::steady_clock::now();
+
 	OgreBites::ApplicationContext::frameStarted(evt);
 
-	//update planet rotation
-	planet->update(evt.timeSinceLastFrame);
-	planetGradient->update(evt.timeSinceLastFrame);
+	//update planet rotation, a flythrough moves everything by a fixed step so every run sees the same frames
+	float fDeltaTime = bFlythrough ? FlythroughStep : evt.timeSinceLastFrame;
+	planet->update(fDeltaTime);
+	planetGradient->update(fDeltaTime);
+	if (bFlythrough)
+		updateFlythrough();
+	if (bRecordPath)
+	{
+		fRecordTime += evt.timeSinceLastFrame;
+		if (recordedPath.empty() || fRecordTime - recordedPath.getDuration() >= CameraPathKeyInterval)
+		{
+			Ogre::SceneNode* cameraNode = mCamera->getParentSceneNode();
+			recordedPath.addKey(fRecordTime, cameraNode->getPosition() / (planet->fSideLength / 2.f), cameraNode->getOrientation());
+		}
+	}
 	
 	Ogre::ImGuiOverlay::NewFrame();
 	
@@ -153,6 +272,9 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 		ImGui::MenuItem("Mesh", nullptr, &bSelected[4]);
 		ImGui::MenuItem("Lighting", nullptr, &bSelected[5]);
 		ImGui::MenuItem("Settings", nullptr, &bSelected[6]);
+		ImGui::MenuItem("Export", nullptr, &bSelected[7]);
+		if (ImGui::MenuItem("Performance", nullptr, &bSelected[8]))
+			nFrameIndex = nFrameCount = 0;
 		if (ImGui::MenuItem("Quit"))
 			mRoot->queueEndRendering();
 		ImGui::EndPopup();
@@ -237,7 +359,7 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 		if (planet->fractalType != FastNoiseLite::FractalType_None)
 		{
 			ImGui::InputInt("Octaves", &planet->iOctaves);
-			planetGradient->iOctaves = planet->iOctaves;
+			planet->iOctaves = planetGradient->iOctaves = std::clamp(planet->iOctaves, 1, MaxOctaves);
 			ImGui::InputFloat("Gain", &planet->fFractalGain, 0.f, 0.f, "%.6f");
 			planetGradient->fFractalGain = planet->fFractalGain;
 			ImGui::InputFloat("Weighted Strength", &planet->fFractalWeightedStrength, 0.f, 0.f, "%.6f");
@@ -308,7 +430,7 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 			if (planet->domainWarpFractalType != FastNoiseLite::FractalType::FractalType_None)
 			{
 				ImGui::InputInt("DW Fractal Octaves", &planet->iDWFractalOctaves);
-				planetGradient->iDWFractalOctaves = planet->iDWFractalOctaves;
+				planet->iDWFractalOctaves = planetGradient->iDWFractalOctaves = std::clamp(planet->iDWFractalOctaves, 1, MaxOctaves);
 				ImGui::InputFloat("DW Fractal Gain", &planet->fDWFractalGain, 0.f, 0.f, "%.6f");
 				planetGradient->fDWFractalGain = planet->fDWFractalGain;
 				ImGui::InputFloat("DW Fractal Lacunarity", &planet->fDWFractalLacunarity, 0.f, 0.f, "%.6f");
@@ -391,57 +513,57 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 	}
 	if (bSelected[3] && ImGui::Begin("Rings Configuration", &bSelected[3]))
 	{
+		//the ring mesh is cheap to rebuild so every change shows right away
+		bool bRingsChanged = false;
+
+		//rocks through the visible rings, the count is applied once the slider is released
+		bRingsChanged |= ImGui::Checkbox("Debris Field", &planet->bRingDebris);
+		ImGui::SliderInt("Rocks Per Ring", &imRingDebris, 1000, static_cast<int>(MaxRingDebrisPerRing));
+		if (ImGui::IsItemDeactivatedAfterEdit())
+		{
+			planet->nRingDebris = imRingDebris;
+			bRingsChanged = true;
+		}
+		ImGui::NewLine();
+
 		imSelection = 0;
 		for (auto& ring : planet->vecRings)
 		{
-			if (ImGui::Checkbox(std::string("Toggle Ring " + std::to_string(imSelection)).c_str(), &ring.bVisible))
-			{
-				ring.entityY->setVisible(ring.bVisible);
-				ring.entityNY->setVisible(ring.bVisible);
-			}
+			bRingsChanged |= ImGui::Checkbox(std::string("Toggle Ring " + std::to_string(imSelection)).c_str(), &ring.bVisible);
 			
-			ImGui::InputFloat(std::string("Size Ring " + std::to_string(imSelection)).c_str(), &ring.fOuterRingDia);
+			bRingsChanged |= ImGui::InputFloat(std::string("Size Ring " + std::to_string(imSelection)).c_str(), &ring.fOuterRingDia);
 			ring.fOuterRingDia = std::clamp(ring.fOuterRingDia, 1.f, MaxOuterRingDia);
-			ImGui::SliderFloat(std::string("Size Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fOuterRingDia, 1.f, 4.f);
+			bRingsChanged |= ImGui::SliderFloat(std::string("Size Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fOuterRingDia, 1.f, 4.f);
 
-			ImGui::InputFloat(std::string("Width Ring " + std::to_string(imSelection)).c_str(), &ring.fInnerThickness);
+			bRingsChanged |= ImGui::InputFloat(std::string("Width Ring " + std::to_string(imSelection)).c_str(), &ring.fInnerThickness);
 			ring.fInnerThickness = std::clamp(ring.fInnerThickness, 0.f, 1.f);
-			ImGui::SliderFloat(std::string("Width Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fInnerThickness, 0.f, 1.f);
+			bRingsChanged |= ImGui::SliderFloat(std::string("Width Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fInnerThickness, 0.f, 1.f);
 
 			fColor[0] = ring.colorOuter.r, fColor[1] = ring.colorOuter.g, fColor[2] = ring.colorOuter.b;
-			ImGui::ColorEdit3(std::string("Color Outer Ring " + std::to_string(imSelection)).c_str(), fColor);
+			bRingsChanged |= ImGui::ColorEdit3(std::string("Color Outer Ring " + std::to_string(imSelection)).c_str(), fColor);
 			ring.colorOuter = Ogre::ColourValue(fColor[0], fColor[1], fColor[2]);
 
 			fColor[0] = ring.colorInner.r, fColor[1] = ring.colorInner.g, fColor[2] = ring.colorInner.b;
-			ImGui::ColorEdit3(std::string("Color Inner Ring " + std::to_string(imSelection)).c_str(), fColor);
+			bRingsChanged |= ImGui::ColorEdit3(std::string("Color Inner Ring " + std::to_string(imSelection)).c_str(), fColor);
 			ring.colorInner = Ogre::ColourValue(fColor[0], fColor[1], fColor[2]);
 
-			fSelection = ring.fYaw;
-			ImGui::InputFloat(std::string("Yaw Ring " + std::to_string(imSelection)).c_str(), &ring.fYaw);
+			bRingsChanged |= ImGui::InputFloat(std::string("Yaw Ring " + std::to_string(imSelection)).c_str(), &ring.fYaw);
 			ring.fYaw = std::clamp(ring.fYaw, -1.f, 1.0f);
-			ImGui::SliderFloat(std::string("Yaw Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fYaw, -1.f, 1.f);
-			ring.sceneNodeY->yaw(Ogre::Radian(ring.fYaw - fSelection), Ogre::Node::TS_WORLD);
-			ring.sceneNodeNY->yaw(Ogre::Radian(ring.fYaw - fSelection), Ogre::Node::TS_WORLD);
+			bRingsChanged |= ImGui::SliderFloat(std::string("Yaw Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fYaw, -1.f, 1.f);
 
-			fSelection = ring.fPitch;
-			ImGui::InputFloat(std::string("Pitch Ring " + std::to_string(imSelection)).c_str(), &ring.fPitch);
+			bRingsChanged |= ImGui::InputFloat(std::string("Pitch Ring " + std::to_string(imSelection)).c_str(), &ring.fPitch);
 			ring.fPitch = std::clamp(ring.fPitch, -1.f, 1.0f);
-			ImGui::SliderFloat(std::string("Pitch Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fPitch, -1.f, 1.f);
-			ring.sceneNodeY->pitch(Ogre::Radian(ring.fPitch - fSelection), Ogre::Node::TS_WORLD);
-			ring.sceneNodeNY->pitch(Ogre::Radian(ring.fPitch - fSelection), Ogre::Node::TS_WORLD);
+			bRingsChanged |= ImGui::SliderFloat(std::string("Pitch Slider Ring " + std::to_string(imSelection)).c_str(), &ring.fPitch, -1.f, 1.f);
 
-			fSelection = ring.fRoll;
-			ImGui::InputFloat(std::string("Roll Ring " + std::to_string(imSelection)).c_str(), &ring.fRoll);
+			bRingsChanged |= ImGui::InputFloat(std::string("Roll Ring " + std::to_string(imSelection)).c_str(), &ring.fRoll);
 			ring.fRoll = std::clamp(ring.fRoll, -1.f, 1.0f);
-			ImGui::SliderFloat(std::string("Roll Slider Ring " + std::to_string(imSelection++)).c_str(), &ring.fRoll, -1.f, 1.f);
-			ring.sceneNodeY->roll(Ogre::Radian(ring.fRoll - fSelection), Ogre::Node::TS_WORLD);
-			ring.sceneNodeNY->roll(Ogre::Radian(ring.fRoll - fSelection), Ogre::Node::TS_WORLD);
+			bRingsChanged |= ImGui::SliderFloat(std::string("Roll Slider Ring " + std::to_string(imSelection++)).c_str(), &ring.fRoll, -1.f, 1.f);
 
 			ImGui::NewLine();
 
 		}
-
-		ImGui::TextColored(ImVec4(1.f, 0.f, 0.f, 1.f), "(!) Generate to update the Ring Meshes.");
+		if (bRingsChanged)
+			planet->updateRings();
 
 		ImGui::NewLine();
 		if (ImGui::Button("Reset to Defaults"))
@@ -449,9 +571,19 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 	}
 	if (bSelected[4] && ImGui::Begin("Mesh Configuration", &bSelected[4]))
 	{
+		//rebuild once the slider is released instead of on every step of the drag
 		ImGui::SliderInt("Segments", &imSections, MinSections, MaxSections);													//label is Segments, value bieng changed is Sections
+		bool bResolutionChanged = ImGui::IsItemDeactivatedAfterEdit();
 		ImGui::SliderInt("Diameter Multiplier", &imDiaMultiplier, MinDiaMultiplier, MaxDiaMultiplier);
-		ImGui::TextColored(ImVec4(1.f, 0.f, 0.f, 1.f), "(!) Restart app for these changes to take effect.");
+		bResolutionChanged |= ImGui::IsItemDeactivatedAfterEdit();
+		if (bResolutionChanged)
+		{
+			planet->setResolution(imSections, imDiaMultiplier);
+			planetGradient->setResolution(imSections, imDiaMultiplier);
+			//keep the planet in view since its size changes with the resolution
+			if (cameraMan->getStyle() == OgreBites::CS_ORBIT)
+				resetCameraPosition();
+		}
 
 	}
 	if (bSelected[5] && ImGui::Begin("Lighting Configuration", &bSelected[5]))
@@ -459,40 +591,35 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 		imSelection = static_cast<int>(lightType);
 		ImGui::RadioButton("Ambient Light", &imSelection, 0);
 		ImGui::RadioButton("Sunlight", &imSelection, 1);
-		lightType = static_cast<LightType>(imSelection);
+		if (static_cast<LightType>(imSelection) != lightType)
+			setLightType(static_cast<LightType>(imSelection));
 
-		if (lightType == planet->getLightType())
+		if (lightType == LightType::AMBIENT)
 		{
-			if (lightType == LightType::AMBIENT)
-			{
-				//ambient colors
-				fColor4[0] = colorAmbient.r, fColor4[1] = colorAmbient.g, fColor4[2] = colorAmbient.b, fColor4[3] = colorAmbient.a;
-				ImGui::ColorEdit4("Ambient Color", fColor4);
-				colorAmbient = Ogre::ColourValue(fColor4[0], fColor4[1], fColor4[2], fColor4[3]);
-				mSceneMgr->setAmbientLight(colorAmbient);
-			}
-			else if (lightType == LightType::DIRECTIONAL)
-			{
-				//sunlight colors
-				fColor4[0] = colorSLDiffuse.r, fColor4[1] = colorSLDiffuse.g, fColor4[2] = colorSLDiffuse.b, fColor4[3] = colorSLDiffuse.a;
-				ImGui::ColorEdit4("Diffuse", fColor4);
-				colorSLDiffuse = Ogre::ColourValue(fColor4[0], fColor4[1], fColor4[2], fColor4[3]);
-
-				ImGui::SliderFloat("Power Scale", &fSLPowerScale, 0.f, 5.f);
+			//ambient colors
+			fColor4[0] = colorAmbient.r, fColor4[1] = colorAmbient.g, fColor4[2] = colorAmbient.b, fColor4[3] = colorAmbient.a;
+			ImGui::ColorEdit4("Ambient Color", fColor4);
+			colorAmbient = Ogre::ColourValue(fColor4[0], fColor4[1], fColor4[2], fColor4[3]);
+			mSceneMgr->setAmbientLight(colorAmbient);
+		}
+		else if (lightType == LightType::DIRECTIONAL)
+		{
+			//sunlight colors
+			fColor4[0] = colorSLDiffuse.r, fColor4[1] = colorSLDiffuse.g, fColor4[2] = colorSLDiffuse.b, fColor4[3] = colorSLDiffuse.a;
+			ImGui::ColorEdit4("Diffuse", fColor4);
+			colorSLDiffuse = Ogre::ColourValue(fColor4[0], fColor4[1], fColor4[2], fColor4[3]);
 
-				ImGui::Text("Light Direction");
-				ImGui::SliderFloat("X", &vSLDirection.x, -1.0f, 1.0f);
-				ImGui::SliderFloat("Y", &vSLDirection.y, -1.0f, 1.0f);
-				ImGui::SliderFloat("Z", &vSLDirection.z, -1.0f, 1.0f);
+			ImGui::SliderFloat("Power Scale", &fSLPowerScale, 0.f, 5.f);
 
-				sunlight->setDiffuseColour(colorSLDiffuse);
-				sunlight->setPowerScale(fSLPowerScale);
-				sunlightNode->setDirection(vSLDirection);
-			}
+			ImGui::Text("Light Direction");
+			ImGui::SliderFloat("X", &vSLDirection.x, -1.0f, 1.0f);
+			ImGui::SliderFloat("Y", &vSLDirection.y, -1.0f, 1.0f);
+			ImGui::SliderFloat("Z", &vSLDirection.z, -1.0f, 1.0f);
 
+			sunlight->setDiffuseColour(colorSLDiffuse);
+			sunlight->setPowerScale(fSLPowerScale);
+			sunlightNode->setDirection(vSLDirection);
 		}
-		else
-			ImGui::TextColored(ImVec4(1.f, 0.f, 0.f, 1.f), "(!) Restart app for change in Lighting Type to take effect.");
 
 	}
 	if (bSelected[6] && ImGui::Begin("Application Settings", &bSelected[6]))
@@ -554,25 +681,218 @@ bool Core::frameStarted(const Ogre::FrameEvent& evt)
 		ImGui::SliderFloat("Window Size", &fWindowSize, 0.f, 1.f, "%.2f");
 		recMiniScreen->setCorners(-1.f, -1.f + (2.f * fWindowSize), -1.f + (2.f * fWindowSize), -1.f);
 
+		//stops drawing while the planets dont rotate and nothing is clicked, input wakes it up for the next frame
+		ImGui::NewLine();
+		ImGui::Checkbox("Idle When Nothing Changes", &bIdleMode);
+
 	
 		ImGui::NewLine();
-		ImGui::Checkbox("Toggle Auto LOD Generation (for slower GPUs)", &planet->bAutoLodGeneration);
+		bool bAutoLodGeneration = planet->bAutoLodGeneration;
+		if (ImGui::Checkbox("Toggle Auto LOD Generation (for slower GPUs)", &bAutoLodGeneration))
+			planet->setAutoLodGeneration(bAutoLodGeneration);
+		if (planet->bAutoLodGeneration)
+		{
+			bool bLodStitchEdges = planet->bLodStitchEdges;
+			if (ImGui::Checkbox("Stitch LOD Edges", &bLodStitchEdges))
+				planet->setLodStitchEdges(bLodStitchEdges);
+		}
 		//planetGradient->bAutoLodGeneration = planet->bAutoLodGeneration;
-		ImGui::TextColored(ImVec4(1.f, 0.f, 0.f, 1.f), "(!) Restart app for LOD Generation to take effect.");
+		ImGui::Checkbox("Bake Elevation On Exit (faster startup)", &planet->bBakeElevation);
+		if (ImGui::Checkbox("Cache Meshes (faster startup)", &planet->bMeshCache))
+			planetGradient->bMeshCache = planet->bMeshCache;
 
 		ImGui::NewLine();
 		ImGui::TextColored(ImVec4(0.f, 1.f, 0.f, 1.f), "//chirag 2022");
 
 	}
+
+	//export
+	if (bSelected[7] && ImGui::Begin("Export", &bSelected[7]))
+	{
+		ImGui::InputText("File (no extension)", strExportPath, sizeof(strExportPath));
+
+		ImGui::NewLine();
+		ImGui::Text("Heightmap");
+		ImGui::RadioButton("Cube Faces", &imExportLayout, static_cast<int>(HeightmapLayout::CubeFaces));
+		ImGui::SameLine();
+		ImGui::RadioButton("Equirectangular", &imExportLayout, static_cast<int>(HeightmapLayout::Equirectangular));
+		ImGui::RadioButton("RAW", &imExportFormat, static_cast<int>(HeightmapFormat::Raw16));
+		ImGui::SameLine();
+		ImGui::RadioButton("PGM", &imExportFormat, static_cast<int>(HeightmapFormat::PGM16));
+		ImGui::SameLine();
+		ImGui::RadioButton("PNG", &imExportFormat, static_cast<int>(HeightmapFormat::PNG16));
+		ImGui::InputInt("Width", &imExportWidth, 256, 1024);
+		imExportWidth = std::clamp(imExportWidth, 16, 65536);
+		if (imExportLayout == static_cast<int>(HeightmapLayout::Equirectangular))
+			ImGui::Text("%d x %d, 16 bit", imExportWidth, imExportWidth / 2);
+		else
+			ImGui::Text("6 x %d x %d, 16 bit", imExportWidth, imExportWidth);
+
+		//exports the planet as it was last generated, one export runs at a time
+		if (!futureExport.valid() && ImGui::Button("Export Heightmap"))
+		{
+			heightmapExporter = std::make_unique<HeightmapExporter>(*planet);
+			futureExport = std::async(std::launch::async,
+				[exporter = heightmapExporter.get(), strPath = std::string(strExportPath), layout = static_cast<HeightmapLayout>(imExportLayout),
+				format = static_cast<HeightmapFormat>(imExportFormat), nWidth = static_cast<size_t>(imExportWidth)]()
+				{
+					return exporter->exportHeightmap(strPath, layout, format, nWidth, nWidth / 2);
+				});
+			strExportStatus.clear();
+		}
+
+		ImGui::NewLine();
+		ImGui::Text("Mesh");
+		ImGui::RadioButton("PLY", &imMeshFormat, static_cast<int>(MeshFormat::PLY));
+		ImGui::SameLine();
+		ImGui::RadioButton("GLB", &imMeshFormat, static_cast<int>(MeshFormat::GLB));
+		ImGui::InputInt("Sections", &imMeshSections, 50, 250);
+		imMeshSections = std::clamp(imMeshSections, static_cast<int>(MinSections), 4096);
+		ImGui::Text("6 x %d x %d vertices, visible rings included", imMeshSections + 1, imMeshSections + 1);
+		//the faces are built on all cores from a headless copy, so the planet can keep changing meanwhile
+		if (!futureExport.valid() && ImGui::Button("Export Mesh"))
+		{
+			planetExport = std::make_unique<Planet>(nullptr, MeshType::NORMAL_BIOMES, "export", 0);
+			planetExport->initHeadlessCopy(*planet);
+			meshExporter = std::make_unique<MeshExporter>(*planetExport);
+			futureExport = std::async(std::launch::async,
+				[exporter = meshExporter.get(), strPath = std::string(strExportPath), format = static_cast<MeshFormat>(imMeshFormat), nSections = static_cast<size_t>(imMeshSections)]()
+				{
+					return exporter->exportMesh(strPath, format, nSections);
+				});
+			strExportStatus.clear();
+		}
+
+		if (futureExport.valid())
+		{
+			ImGui::ProgressBar(heightmapExporter ? heightmapExporter->getProgress() : meshExporter->getProgress());
+			if (futureExport.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				strExportStatus = futureExport.get() ? "Exported." : "(!) Export failed.";
+				heightmapExporter.reset();
+				meshExporter.reset();
+				planetExport.reset();
+			}
+		}
+		ImGui::Text("%s", strExportStatus.c_str());
+	}
+
+	//performance
+	if (bSelected[8] && ImGui::Begin("Performance", &bSelected[8]))
+	{
+		float fFrameMax = 0.f, fFrameSum = 0.f;
+		for (size_t i = 0; i < nFrameCount; i++)
+		{
+			fFrameMax = std::max(fFrameMax, fFrameTimes[i]);
+			fFrameSum += fFrameTimes[i];
+		}
+		char strOverlay[64];
+		std::snprintf(strOverlay, sizeof(strOverlay), "avg %.2f ms  max %.2f ms", nFrameCount ? fFrameSum / nFrameCount : 0.f, fFrameMax);
+		ImGui::PlotLines("Frame", fFrameTimes, static_cast<int>(nFrameCount), static_cast<int>(nFrameCount == PerformanceHistory ? nFrameIndex : 0), strOverlay, 0.f, std::max(fFrameMax, 16.7f), ImVec2(0.f, 60.f));
+		ImGui::PlotLines("Update + UI", fUpdateTimes, static_cast<int>(nFrameCount), static_cast<int>(nFrameCount == PerformanceHistory ? nFrameIndex : 0), nullptr, 0.f, std::max(fFrameMax, 16.7f), ImVec2(0.f, 60.f));
+
+		ImGui::NewLine();
+		ImGui::Text("Rendering");
+		const Ogre::RenderTarget::FrameStats& stats = getRenderWindow()->getStatistics();
+		const Ogre::RenderTarget::FrameStats& statsMini = rtMiniScreen->getStatistics();
+		ImGui::Text("Main window   %zu draw calls, %zu triangles", stats.batchCount, stats.triangleCount);
+		ImGui::Text("Mini window   %zu draw calls, %zu triangles", statsMini.batchCount, statsMini.triangleCount);
+		ImGui::Text("Idle          %.1f s in %zu waits, never while this window is open", fIdleSeconds, nIdleWaits);
+
+		//cpu side copies and the buffers the gpu holds, pooled buffers count their full size
+		ImGui::NewLine();
+		CoreMemory memory = getMemoryUsage();
+		ImGui::Text("Memory (MB)        Planet   Gradient");
+		auto memoryRow = [](const char* strName, const size_t nPlanet, const size_t nGradient)
+		{
+			ImGui::Text("%-16s %8.2f %10.2f", strName, nPlanet / 1048576.0, nGradient / 1048576.0);
+		};
+		memoryRow("CPU grid", memory.planet.nGridBytes, memory.planetGradient.nGridBytes);
+		memoryRow("CPU ring grid", memory.planet.nRingGridBytes, memory.planetGradient.nRingGridBytes);
+		memoryRow("CPU faces", memory.planet.nFaceBufferBytes, memory.planetGradient.nFaceBufferBytes);
+		memoryRow("CPU rings", memory.planet.nRingBufferBytes, memory.planetGradient.nRingBufferBytes);
+		memoryRow("CPU lod", memory.planet.nLodBytes, memory.planetGradient.nLodBytes);
+		memoryRow("CPU ring debris", memory.planet.nRingDebrisBytes, memory.planetGradient.nRingDebrisBytes);
+		memoryRow("GPU face verts", memory.planet.nGpuFaceVertexBytes, memory.planetGradient.nGpuFaceVertexBytes);
+		memoryRow("GPU face index", memory.planet.nGpuFaceIndexBytes, memory.planetGradient.nGpuFaceIndexBytes);
+		memoryRow("GPU ring verts", memory.planet.nGpuRingVertexBytes, memory.planetGradient.nGpuRingVertexBytes);
+		memoryRow("GPU ring index", memory.planet.nGpuRingIndexBytes, memory.planetGradient.nGpuRingIndexBytes);
+		memoryRow("GPU lod index", memory.planet.nGpuLodIndexBytes, memory.planetGradient.nGpuLodIndexBytes);
+		memoryRow("GPU ring debris", memory.planet.nGpuRingDebrisBytes, memory.planetGradient.nGpuRingDebrisBytes);
+		ImGui::Text("GPU mini screen  %8.2f", memory.nRttBytes / 1048576.0);
+		ImGui::Text("Total            %8.2f MB CPU, %.2f MB GPU", memory.getCpuBytes() / 1048576.0, memory.getGpuBytes() / 1048576.0);
+
+		//percentiles of the start to start time, the stutter a viewer sees
+		ImGui::NewLine();
+		ImGui::Text("Frame Times");
+		if (ImGui::Checkbox("Record Frame Times", &bRecordFrames))
+		{
+			frameRecorder.clear();
+			nFrameGenerates = planet->getGenerateCount() + planetGradient->getGenerateCount();
+			nFrameUploads = planet->getUploadCount() + planetGradient->getUploadCount();
+		}
+		if (bRecordFrames)
+		{
+			FramePercentiles all = frameRecorder.getPercentiles();
+			FramePercentiles idle = frameRecorder.getPercentiles(FrameTag_Generate | FrameTag_Upload);
+			ImGui::Text("All      %6zu frames  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", all.nFrames, all.fP50, all.fP95, all.fP99, all.fMax);
+			ImGui::Text("No work  %6zu frames  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", idle.nFrames, idle.fP50, idle.fP95, idle.fP99, idle.fMax);
+			if (ImGui::Button("Save CSV"))
+				strPerformanceStatus = frameRecorder.writeCSV(strFrameTimesPath) ? "Saved to " + strFrameTimesPath : "(!) Cannot write " + strFrameTimesPath;
+		}
+
+		//positions are kept in planet radii so the path can be flown at any resolution with --flythrough
+		if (ImGui::Checkbox("Record Camera Path", &bRecordPath))
+		{
+			if (bRecordPath)
+				recordCameraPath(strRecordPath);
+			else
+				strPerformanceStatus = recordedPath.write(strRecordPath) ? "Saved to " + strRecordPath : "(!) Cannot write " + strRecordPath;
+		}
+		ImGui::Text("%s", strPerformanceStatus.c_str());
+
+#ifdef PROCTERRA_TRACE
+		//records every thread until unticked, then writes it for chrome://tracing or ui.perfetto.dev
+		ImGui::NewLine();
+		bool bTrace = Trace::isRecording();
+		if (ImGui::Checkbox("Record Trace (./trace.json)", &bTrace))
+		{
+			if (bTrace)
+				Trace::start();
+			else
+				Trace::stop("./trace.json");
+		}
+#endif
+
+		//face stages add up over the threads building them, so they can be more than the faces wall time
+		ImGui::NewLine();
+		ImGui::Text("Last Generate (ms)");
+		for (Planet* pPlanet : { planet.get(), planetGradient.get() })
+		{
+			const GenerateTimings& timings = pPlanet->getGenerateTimings();
+			ImGui::Text("%s  %.2f total%s", pPlanet == planet.get() ? "Planet  " : "Gradient", timings.fTotalMs, timings.bMeshCache ? ", faces from the mesh cache" : "");
+			ImGui::Text("  normals %.2f  noise %.2f  displacement %.2f  colouring %.2f", timings.fNormalsMs, timings.fNoiseMs, timings.fDisplacementMs, timings.fColouringMs);
+			ImGui::Text("  faces %.2f  rings %.2f  upload %.2f  lod %.2f", timings.fFacesMs, timings.fRingsMs, timings.fUploadMs, timings.fLodMs);
+		}
+	}
 	
 	ImGui::EndFrame();
 
+	if (bPerformance)
+	{
+		fFrameTimes[nFrameIndex] = evt.timeSinceLastFrame * 1000.f;
+		fUpdateTimes[nFrameIndex] = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeUpdate).count();
+		nFrameIndex = (nFrameIndex + 1) % PerformanceHistory;
+		nFrameCount = std::min(nFrameCount + 1, PerformanceHistory);
+	}
+
 
 	return true;
 }
 
 bool Core::frameRenderingQueued(const Ogre::FrameEvent& evt)
 {
+	TRACE_SCOPE("Core::frameRenderingQueued");
 	OgreBites::ApplicationContext::frameRenderingQueued(evt);
 	cameraMan->frameRendered(evt);
 	
@@ -581,6 +901,32 @@ bool Core::frameRenderingQueued(const Ogre::FrameEvent& evt)
 
 bool Core::frameEnded(const Ogre::FrameEvent& evt)
 {
+	TRACE_SCOPE("Core::frameEnded");
+	if (bRecordFrames || bFlythrough)
+	{
+		uint32_t tags = 0;
+		if (planet->getGenerateCount() + planetGradient->getGenerateCount() != nFrameGenerates)
+			tags |= FrameTag_Generate;
+		if (planet->getUploadCount() + planetGradient->getUploadCount() != nFrameUploads)
+			tags |= FrameTag_Upload;
+		if (bRecordFrames)
+			frameRecorder.frameEnded(tags);
+		if (bFlythrough)
+			flythroughRecorder.frameEnded(tags);
+	}
+
+	//the camera moved or a planet changed, keep drawing until it settles
+	Ogre::SceneNode* cameraNode = mCamera->getParentSceneNode();
+	if (cameraNode->_getDerivedPosition() != vIdleCameraPosition || cameraNode->_getDerivedOrientation() != idleCameraOrientation ||
+		planet->getGenerateCount() + planetGradient->getGenerateCount() != nFrameGenerates ||
+		planet->getUploadCount() + planetGradient->getUploadCount() != nFrameUploads)
+	{
+		vIdleCameraPosition = cameraNode->_getDerivedPosition();
+		idleCameraOrientation = cameraNode->_getDerivedOrientation();
+		nActiveFrames = IdleSettleFrames;
+	}
+	else if (nActiveFrames > 0)
+		nActiveFrames--;
 	OgreBites::ApplicationContext::frameEnded(evt);
 
 	return true;
@@ -600,40 +946,111 @@ void Core::setup()
 {
 	OgreBites::ApplicationContext::setup();
 	addInputListener(this);
+	TRACE_THREAD_NAME("main");
 	mSceneMgr = mRoot->createSceneManager();
 
 	// register our scene with the RTSS
 	Ogre::RTShader::ShaderGenerator* shadergen = Ogre::RTShader::ShaderGenerator::getSingletonPtr();
 	shadergen->addSceneManager(mSceneMgr);
+	//shaders are always generated for the one sunlight, whether it is on or not
+	//so switching the lighting type doesnt regenerate them
+	Ogre::RTShader::RenderState* renderState = shadergen->getRenderState(Ogre::RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME);
+	renderState->setLightCountAutoUpdate(false);
+	renderState->setLightCount(Ogre::Vector3i(0, 1, 0));
 
 	//and the overlay system
 	mSceneMgr->addRenderQueueListener(Ogre::OverlaySystem::getSingletonPtr());
 
-	//auto lod
-	meshLodGenerator = OGRE_NEW Ogre::MeshLodGenerator();
-
-
 	initLevel();
 	initImGui();
 
 	//lighting
+	setLightType(lightType);
+}
+
+void Core::setLightType(const LightType lightType)
+{
+	this->lightType = lightType;
 	if (lightType == LightType::AMBIENT)                                             
 	{
-		mSceneMgr->setAmbientLight(Ogre::ColourValue(1.f, 1.f, 1.f));
+		mSceneMgr->setAmbientLight(colorAmbient);
+		if (sunlight)
+			sunlight->setVisible(false);
 	}
 	else
 	{
 		//use if directional light is enabled
-		sunlight = mSceneMgr->createLight();
-		sunlight->setType(Ogre::Light::LT_DIRECTIONAL);
-		sunlight->setDiffuseColour(colorSLDiffuse);
-		sunlight->setSpecularColour(Ogre::ColourValue(0.1f, 0.1f, 0.1f));
-		sunlight->setPowerScale(fSLPowerScale);
-		sunlightNode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
-		sunlightNode->setDirection(vSLDirection);
-		sunlightNode->attachObject(sunlight);
+		if (!sunlight)
+		{
+			sunlight = mSceneMgr->createLight();
+			sunlight->setType(Ogre::Light::LT_DIRECTIONAL);
+			sunlight->setDiffuseColour(colorSLDiffuse);
+			sunlight->setSpecularColour(Ogre::ColourValue(0.1f, 0.1f, 0.1f));
+			sunlight->setPowerScale(fSLPowerScale);
+			sunlightNode = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+			sunlightNode->setDirection(vSLDirection);
+			sunlightNode->attachObject(sunlight);
+		}
+		sunlight->setVisible(true);
+		mSceneMgr->setAmbientLight(Ogre::ColourValue::Black);
 	}
 
+	//both planets read the light type from the same file at startup, keep them matching
+	planet->setLightType(lightType);
+	planetGradient->setLightType(lightType);
+}
+
+void Core::updateFlythrough()
+{
+	//next preset once the path is flown, the frame that generates it is tagged and left out of the numbers
+	if (iFlythroughPreset < 0 || fPathTime > cameraPath.getDuration())
+	{
+		if (iFlythroughPreset >= 0)
+			vecFlythroughResults.emplace_back(flythroughRecorder.getPercentiles(FrameTag_Generate));
+		if (++iFlythroughPreset == static_cast<int>(PresetCount))
+		{
+			writeFlythroughReport();
+			bFlythrough = false;
+			mRoot->queueEndRendering();
+			return;
+		}
+		cameraMan->setStyle(OgreBites::CS_MANUAL);
+		planet->setPreset(static_cast<Preset>(iFlythroughPreset));
+		planetGradient->setPreset(static_cast<Preset>(iFlythroughPreset));
+		flythroughRecorder.clear();
+		fPathTime = 0.f;
+	}
+
+	Ogre::Vector3 vPosition;
+	Ogre::Quaternion orientation;
+	cameraPath.sample(fPathTime, vPosition, orientation);
+	Ogre::SceneNode* cameraNode = mCamera->getParentSceneNode();
+	cameraNode->setPosition(vPosition * (planet->fSideLength / 2.f));
+	cameraNode->setOrientation(orientation);
+	fPathTime += FlythroughStep;
+}
+
+void Core::writeFlythroughReport()
+{
+	FILE* file = std::fopen(strFlythroughOut.c_str(), "w");
+	if (file != nullptr)
+		std::fprintf(file, "{\n  \"step\": %.6f,\n  \"pathSeconds\": %.3f,\n  \"presets\": [", FlythroughStep, cameraPath.getDuration());
+	for (size_t i = 0; i < vecFlythroughResults.size(); i++)
+	{
+		const FramePercentiles& result = vecFlythroughResults[i];
+		const char* strPreset = Planet::getPresetName(static_cast<Preset>(i));
+		std::printf("%-14s %6zu frames  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms\n", strPreset, result.nFrames, result.fP50, result.fP95, result.fP99, result.fMax);
+		if (file != nullptr)
+			std::fprintf(file, "%s\n    { \"preset\": \"%s\", \"frames\": %zu, \"p50Ms\": %.3f, \"p95Ms\": %.3f, \"p99Ms\": %.3f, \"maxMs\": %.3f }",
+				i ? "," : "", strPreset, result.nFrames, result.fP50, result.fP95, result.fP99, result.fMax);
+	}
+	if (file == nullptr)
+	{
+		std::fprintf(stderr, "cannot write '%s'\n", strFlythroughOut.c_str());
+		return;
+	}
+	std::fprintf(file, "\n  ]\n}\n");
+	std::fclose(file);
 }
 
 void Core::initLevel()
@@ -671,6 +1088,8 @@ void Core::initLevel()
 			Ogre::PF_R8G8B8,
 			Ogre::TU_RENDERTARGET);
 	Ogre::RenderTarget* renderTexture = rttTexture->getBuffer()->getRenderTarget();
+	rtMiniScreen = renderTexture;
+	rttMiniScreen = rttTexture;
 	vpMiniScreen = renderTexture->addViewport(mCamera);
 	vpMiniScreen->setClearEveryFrame(true);
 	vpMiniScreen->setBackgroundColour(colorMiniScreen);
@@ -764,9 +1183,16 @@ void Core::initImGui()
 	imSelection = 0;
 	imSections = planet->nSections;
 	imDiaMultiplier = planet->iDiaMultiplier;
+	imRingDebris = static_cast<int>(planet->nRingDebris);
 	fSelection = 0.f;
 	fColor[0] = fColor[1] = fColor[2] = fColor4[0] = fColor4[1] = fColor4[2] = fColor4[3] = 0.f;
-	bSelected[0] = bSelected[1] = bSelected[2] = bSelected[3] = bSelected[4] = bSelected[5] = bSelected[6] = false;
+	bSelected[0] = bSelected[1] = bSelected[2] = bSelected[3] = bSelected[4] = bSelected[5] = bSelected[6] = bSelected[7] = bSelected[8] = false;
+	std::snprintf(strExportPath, sizeof(strExportPath), "./planet");
+	imExportLayout = static_cast<int>(HeightmapLayout::Equirectangular);
+	imExportFormat = static_cast<int>(HeightmapFormat::PNG16);
+	imExportWidth = 4096;
+	imMeshFormat = static_cast<int>(MeshFormat::GLB);
+	imMeshSections = 1000;
 	lightType = planet->getLightType();
 }
 
@@ -779,16 +1205,30 @@ void Core::resetCameraPosition()
 
 void Core::destroy()
 {
-	//write to dat file, only primary planet is neccesary
-	planet->nSections = imSections;
-	planet->iDiaMultiplier = imDiaMultiplier;
+	//let a running export finish writing its file
+	if (futureExport.valid())
+		futureExport.wait();
+	if (bRecordFrames)
+		frameRecorder.writeCSV(strFrameTimesPath);
+	if (bRecordPath)
+		recordedPath.write(strRecordPath);
+#ifdef PROCTERRA_TRACE
+	if (Trace::isRecording())
+		Trace::stop("./trace.json");
+#endif
+
+	//write to planet.bin, only primary planet is neccesary
 	planet->setLightType(lightType);
-	planet->writeDATFile();
+	planet->writePlanetFile();
+	//the planets update() hasnt stored yet, values changed less than MeshCacheStoreDelay before closing
+	planet->storeMeshCache();
+	planetGradient->storeMeshCache();
+	//the debris chunks arent owned by the scene manager
+	planet->destroyRingDebris();
 
 	Ogre::OverlayManager::getSingleton().destroy("ImGuiOverlay");
 	//mRenderWindow->removeListener(Ogre::OverlaySystem::getSingletonPtr());
 
-	OGRE_DELETE meshLodGenerator;
 	OGRE_DELETE mOverlaySystem;
 	OGRE_DELETE recMiniScreen;
 
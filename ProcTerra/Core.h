@@ -8,10 +8,27 @@
 #include <OgreCameraMan.h>
 #include <OgreImGuiOverlay.h>
 #include <OgreImGuiInputListener.h>
-#include <OgreMeshLodGenerator.h>
 #include <memory>
+#include <future>
 
 #include "Planet.h"
+#include "HeightmapExporter.h"
+#include "MeshExporter.h"
+#include "FrameRecorder.h"
+#include "CameraPath.h"
+
+constexpr size_t PerformanceHistory = 240;							//frames in the graphs of the performance window
+constexpr size_t IdleSettleFrames = 3;								//frames drawn after the last input or change before idling, so imgui catches up
+
+//what the app holds in memory, the rest is ogre, imgui and the driver
+struct CoreMemory
+{
+	PlanetMemory planet, planetGradient;
+	size_t nRttBytes;													//mini screen render texture
+
+	size_t getCpuBytes() const { return planet.getCpuBytes() + planetGradient.getCpuBytes(); }
+	size_t getGpuBytes() const { return planet.getGpuBytes() + planetGradient.getGpuBytes() + nRttBytes; }
+};
 
 
 class Core : public OgreBites::ApplicationContext, public Ogre::FrameListener, public OgreBites::InputListener, public Ogre::RenderTargetListener
@@ -19,8 +36,6 @@ class Core : public OgreBites::ApplicationContext, public Ogre::FrameListener, p
 	Ogre::SceneManager* mSceneMgr;						
 	Ogre::Viewport* vpPrimary, *vpMiniScreen;			
 	Ogre::ColourValue colorPrimary, colorMiniScreen;								//bkg colors for both viewports
-	
-	Ogre::MeshLodGenerator* meshLodGenerator;
 
 	bool bWireFrame, bToggleFreelook, bToggleSkybox;
 	Ogre::Camera* mCamera;
@@ -29,6 +44,8 @@ class Core : public OgreBites::ApplicationContext, public Ogre::FrameListener, p
 	//mini screen
 	float fWindowSize;									//size multiplier wrt main window size;
 	Ogre::Rectangle2D* recMiniScreen;
+	Ogre::RenderTarget* rtMiniScreen;
+	Ogre::TexturePtr rttMiniScreen;
 
 	//std::unique_ptr<ImguiListener> mImguiListener;
 	std::unique_ptr<OgreBites::ImGuiInputListener> mImguiListener;
@@ -37,16 +54,58 @@ class Core : public OgreBites::ApplicationContext, public Ogre::FrameListener, p
 	//lighting 
 	float fSLPowerScale;
 	LightType lightType;											//0 = ambient, 1 = sun light, used to store value from imgui
-	Ogre::Light* sunlight;
+	Ogre::Light* sunlight;											//created the first time sunlight is switched on
 	Ogre::SceneNode* sunlightNode;
 	Ogre::ColourValue colorAmbient;
 	Ogre::ColourValue colorSLDiffuse;
 	Ogre::Vector3 vSLDirection;
 
 	//imgui menu interaction
-	int imSelection, imSections, imDiaMultiplier;
+	int imSelection, imSections, imDiaMultiplier, imRingDebris;
 	float fSelection, fColor[3], fColor4[4];
-	bool bSelected[7];
+	bool bSelected[9];
+
+	//performance window, frames are only recorded while it is open
+	float fFrameTimes[PerformanceHistory], fUpdateTimes[PerformanceHistory];			//ms, a ring starting at nFrameIndex
+	size_t nFrameIndex, nFrameCount;
+
+	//frame times for finding stutter, frames where a planet generated or wrote its buffers are tagged
+	FrameRecorder frameRecorder;
+	bool bRecordFrames;
+	std::string strFrameTimesPath, strPerformanceStatus;							//csv written on exit while recording, or from the performance window
+	size_t nFrameGenerates, nFrameUploads;											//planet counters when the frame started
+
+	//flythrough benchmark, every preset flies cameraPath at FlythroughStep a frame, then the app exits
+	CameraPath cameraPath;
+	bool bFlythrough;
+	int iFlythroughPreset;															//-1 until the first is generated
+	float fPathTime;
+	FrameRecorder flythroughRecorder;
+	std::vector<FramePercentiles> vecFlythroughResults;								//of each preset done so far
+	std::string strFlythroughOut;
+	//camera path of a live session
+	CameraPath recordedPath;
+	bool bRecordPath;
+	float fRecordTime;
+	std::string strRecordPath;
+
+	//render on demand, a static scene waits for the next event instead of drawing the same frame again
+	bool bIdleMode;
+	size_t nActiveFrames;															//frames left to draw before idling
+	Ogre::Vector3 vIdleCameraPosition;												//camera at the end of the last frame
+	Ogre::Quaternion idleCameraOrientation;
+	double fIdleSeconds;
+	size_t nIdleWaits;
+
+	//export, runs on a background thread
+	char strExportPath[256];
+	int imExportLayout, imExportFormat, imExportWidth;
+	int imMeshFormat, imMeshSections;
+	std::unique_ptr<HeightmapExporter> heightmapExporter;
+	std::unique_ptr<Planet> planetExport;													//headless copy of the planet the mesh exporter works on
+	std::unique_ptr<MeshExporter> meshExporter;
+	std::future<bool> futureExport;
+	std::string strExportStatus;
 
 	//planets
 	std::unique_ptr<Planet> planet;
@@ -54,6 +113,12 @@ class Core : public OgreBites::ApplicationContext, public Ogre::FrameListener, p
 
 public:
 	Core();	
+	void recordFrameTimes(const std::string& strPath);								//from startup, for displays left running
+	bool runFlythrough(const std::string& strPathFile, const std::string& strOut);	//empty strPathFile for the built in path, false if it cant be read
+	void recordCameraPath(const std::string& strPath);								//from startup, written on exit
+	void setIdleMode(const bool bIdleMode) { this->bIdleMode = bIdleMode; };
+	void run();																		//Root::startRendering() that idles while nothing on screen would change
+	CoreMemory getMemoryUsage() const;
 	void setup();
 	bool frameStarted(const Ogre::FrameEvent& evt);
 	bool frameRenderingQueued(const Ogre::FrameEvent& evt);
@@ -75,6 +140,10 @@ private:
 	void initLevel();
 	void initImGui();
 	void resetCameraPosition();
+	void setLightType(const LightType lightType);
+	void updateFlythrough();
+	void writeFlythroughReport();
+	bool isSceneStatic() const;
 
 };
 
@@ -0,0 +1,100 @@
+#include "FrameRecorder.h"
+#include <algorithm>
+#include <cstdio>
+
+FrameRecorder::FrameRecorder(const size_t nCapacity) :
+    vecFrames(std::max<size_t>(nCapacity, 1))
+{
+    clear();
+}
+
+void FrameRecorder::clear()
+{
+    nNext = nCount = 0;
+    bIdle = false;
+    timeCleared = timeFrameStart = std::chrono::steady_clock::now();
+}
+
+void FrameRecorder::frameStarted()
+{
+    auto timeNow = std::chrono::steady_clock::now();
+    //the previous frame is complete once the next one starts, its length is from start to start
+    if (nCount && !bIdle)
+    {
+        FrameRecord& frame = vecFrames[(nNext + vecFrames.size() - 1) % vecFrames.size()];
+        frame.fFrameMs = std::chrono::duration<float, std::milli>(timeNow - timeFrameStart).count();
+    }
+    timeFrameStart = timeNow;
+    bIdle = false;
+}
+
+void FrameRecorder::frameIdle()
+{
+    if (!nCount || bIdle)
+        return;
+    FrameRecord& frame = vecFrames[(nNext + vecFrames.size() - 1) % vecFrames.size()];
+    frame.fFrameMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeFrameStart).count();
+    bIdle = true;
+}
+
+void FrameRecorder::frameEnded(const uint32_t tags)
+{
+    auto timeNow = std::chrono::steady_clock::now();
+    FrameRecord& frame = vecFrames[nNext];
+    frame.fStartMs = std::chrono::duration<double, std::milli>(timeFrameStart - timeCleared).count();
+    frame.fCpuMs = std::chrono::duration<float, std::milli>(timeNow - timeFrameStart).count();
+    //until the next frame starts
+    frame.fFrameMs = frame.fCpuMs;
+    frame.tags = tags;
+    nNext = (nNext + 1) % vecFrames.size();
+    nCount = std::min(nCount + 1, vecFrames.size());
+}
+
+FramePercentiles FrameRecorder::getPercentiles(const uint32_t excludeTags) const
+{
+    //the newest frame is left out, its length isnt known before the next one starts
+    std::vector<float> vecTimes;
+    vecTimes.reserve(nCount);
+    size_t nFirst = (nNext + vecFrames.size() - nCount) % vecFrames.size();
+    for (size_t i = 0; i + 1 < nCount; i++)
+    {
+        const FrameRecord& frame = vecFrames[(nFirst + i) % vecFrames.size()];
+        if ((frame.tags & excludeTags) == 0)
+            vecTimes.emplace_back(frame.fFrameMs);
+    }
+
+    FramePercentiles percentiles{ vecTimes.size(), 0.f, 0.f, 0.f, 0.f };
+    if (vecTimes.empty())
+        return percentiles;
+    //nearest rank
+    auto getPercentile = [&vecTimes](const double fPercent)
+    {
+        size_t nRank = std::min(vecTimes.size() - 1, static_cast<size_t>(fPercent / 100.0 * vecTimes.size()));
+        std::nth_element(vecTimes.begin(), vecTimes.begin() + nRank, vecTimes.end());
+        return vecTimes[nRank];
+    };
+    percentiles.fP50 = getPercentile(50.0);
+    percentiles.fP95 = getPercentile(95.0);
+    percentiles.fP99 = getPercentile(99.0);
+    percentiles.fMax = *std::max_element(vecTimes.begin(), vecTimes.end());
+    return percentiles;
+}
+
+bool FrameRecorder::writeCSV(const std::string& strPath) const
+{
+    FILE* file = std::fopen(strPath.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    FramePercentiles all = getPercentiles(), idle = getPercentiles(FrameTag_Generate | FrameTag_Upload);
+    std::fprintf(file, "# all frames %zu, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", all.nFrames, all.fP50, all.fP95, all.fP99, all.fMax);
+    std::fprintf(file, "# without generate or upload %zu, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms\n", idle.nFrames, idle.fP50, idle.fP95, idle.fP99, idle.fMax);
+    std::fprintf(file, "frame,start_ms,frame_ms,cpu_ms,generate,upload\n");
+    size_t nFirst = (nNext + vecFrames.size() - nCount) % vecFrames.size();
+    for (size_t i = 0; i + 1 < nCount; i++)
+    {
+        const FrameRecord& frame = vecFrames[(nFirst + i) % vecFrames.size()];
+        std::fprintf(file, "%zu,%.3f,%.3f,%.3f,%d,%d\n", i, frame.fStartMs, frame.fFrameMs, frame.fCpuMs,
+            (frame.tags & FrameTag_Generate) ? 1 : 0, (frame.tags & FrameTag_Upload) ? 1 : 0);
+    }
+    return std::fclose(file) == 0;
+}
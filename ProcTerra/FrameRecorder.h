@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr size_t FrameRecorderCapacity = 60 * 60 * 10;					//frames kept, 10 minutes at 60 fps, older ones are overwritten
+
+//what happened during a frame besides rendering
+enum FrameTag : uint32_t
+{
+	FrameTag_Generate = 1,												//a planet ran generate()
+	FrameTag_Upload = 2													//vertex or index buffers were written
+};
+
+struct FrameRecord
+{
+	double fStartMs;													//since the recorder was cleared
+	float fFrameMs;														//from the start of the previous frame, what the user sees
+	float fCpuMs;														//frameStarted to frameEnded
+	uint32_t tags;														//FrameTag bits
+};
+
+struct FramePercentiles
+{
+	size_t nFrames;
+	float fP50, fP95, fP99, fMax;
+};
+
+//ring buffer of frame times for finding stutter, hooked into the frame listener
+//percentiles are worked out on request so recording is two clock reads a frame
+class FrameRecorder
+{
+	std::vector<FrameRecord> vecFrames;
+	size_t nNext, nCount;
+	std::chrono::steady_clock::time_point timeCleared, timeFrameStart;
+	bool bIdle;															//the last frame was ended by frameIdle()
+
+public:
+	FrameRecorder(const size_t nCapacity = FrameRecorderCapacity);
+	void clear();
+	void frameStarted();
+	void frameEnded(const uint32_t tags);
+	void frameIdle();													//before waiting for input, the wait isnt counted as part of the last frame
+	size_t getCount() const { return nCount; }
+	FramePercentiles getPercentiles(const uint32_t excludeTags = 0) const;		//of fFrameMs, frames with any of excludeTags left out
+	bool writeCSV(const std::string& strPath) const;							//percentiles as # comments then a row per frame, oldest first
+};
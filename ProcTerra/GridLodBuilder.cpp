@@ -0,0 +1,146 @@
+#include "GridLodBuilder.h"
+#include <algorithm>
+#include <cmath>
+
+GridLodBuilder::GridLodBuilder() :
+    nSections(0),
+    nSegments(0),
+    bStitchEdges(true)
+{
+}
+
+void GridLodBuilder::clear()
+{
+    vecLevelStops.clear();
+    vecLevelIndices.clear();
+}
+
+size_t GridLodBuilder::getMemoryBytes() const
+{
+    size_t nBytes = 0;
+    for (const auto& vecStops : vecLevelStops)
+        nBytes += vecStops.capacity() * sizeof(size_t);
+    for (const auto& vecIndices : vecLevelIndices)
+        nBytes += vecIndices.capacity() * sizeof(unsigned short);
+    return nBytes;
+}
+
+void GridLodBuilder::build(const size_t nSections, const bool bStitchEdges)
+{
+    clear();
+    this->nSections = nSections;
+    this->nSegments = nSections + 1;
+    this->bStitchEdges = bStitchEdges;
+
+    //keep at least 2 cells on each side for the coarsest level
+    for (size_t level = 1, stride = 2; level <= MaxLodLevels && stride * 2 <= nSections; level++, stride *= 2)
+    {
+        //rows and columns kept by this level, the last one is clamped to the face border if sections isnt a multiple of stride
+        std::vector<size_t> vecStops;
+        for (size_t stop = 0; stop < nSections; stop += stride)
+            vecStops.emplace_back(stop);
+        vecStops.emplace_back(nSections);
+
+        std::vector<unsigned short> vecIndices;
+        vecIndices.reserve((vecStops.size() - 1) * (vecStops.size() - 1) * 6);
+        for (size_t row = 0; row + 1 < vecStops.size(); row++)
+            for (size_t col = 0; col + 1 < vecStops.size(); col++)
+                addCell(vecIndices, vecStops[row], vecStops[row + 1], vecStops[col], vecStops[col + 1]);
+
+        vecLevelStops.emplace_back(std::move(vecStops));
+        vecLevelIndices.emplace_back(std::move(vecIndices));
+    }
+}
+
+void GridLodBuilder::addCell(std::vector<unsigned short>& vecIndices, const size_t r0, const size_t r1, const size_t c0, const size_t c1) const
+{
+    //same winding as the full resolution face, vertex (row, col) is at row * nSegments + col
+    bool bBorder = r0 == 0 || c0 == 0 || r1 == nSections || c1 == nSections;
+    if (!bStitchEdges || !bBorder)
+    {
+        //lower
+        vecIndices.emplace_back(index(r0, c0));
+        vecIndices.emplace_back(index(r1, c1));
+        vecIndices.emplace_back(index(r1, c0));
+        //upper
+        vecIndices.emplace_back(index(r0, c0));
+        vecIndices.emplace_back(index(r0, c1));
+        vecIndices.emplace_back(index(r1, c1));
+        return;
+    }
+
+    //cell on the face border, walk its perimeter in the winding order and keep every full resolution vertex on the border sides
+    //so it matches the neighbouring face whatever its level, then fan the perimeter from the vertex in the middle of the cell
+    std::vector<unsigned short> vecPerimeter;
+    for (size_t c = c0; c < c1; c += (r0 == 0 ? 1 : c1 - c0))
+        vecPerimeter.emplace_back(index(r0, c));
+    for (size_t r = r0; r < r1; r += (c1 == nSections ? 1 : r1 - r0))
+        vecPerimeter.emplace_back(index(r, c1));
+    for (size_t c = c1; c > c0; c -= (r1 == nSections ? 1 : c1 - c0))
+        vecPerimeter.emplace_back(index(r1, c));
+    for (size_t r = r1; r > r0; r -= (c0 == 0 ? 1 : r1 - r0))
+        vecPerimeter.emplace_back(index(r, c0));
+
+    //the last cells are one section wide when sections isnt a multiple of the stride, their middle vertex is on an inner side
+    //the neighbouring cell doesnt have, so those are fanned from a corner whose two sides have no vertices in between
+    unsigned short centre = index((r0 + r1) / 2, (c0 + c1) / 2);
+    if (r1 - r0 < 2 || c1 - c0 < 2)
+    {
+        bool bTop = r0 == 0 && c1 - c0 > 1, bRight = c1 == nSections && r1 - r0 > 1;
+        bool bBottom = r1 == nSections && c1 - c0 > 1, bLeft = c0 == 0 && r1 - r0 > 1;
+        centre = !bTop && !bLeft ? index(r0, c0) : !bTop && !bRight ? index(r0, c1) : !bBottom && !bRight ? index(r1, c1) : index(r1, c0);
+    }
+    for (size_t i = 0; i < vecPerimeter.size(); i++)
+    {
+        unsigned short a = vecPerimeter[i];
+        unsigned short b = vecPerimeter[(i + 1) % vecPerimeter.size()];
+        //a corner is on the perimeter, the 2 sides it starts are left out
+        if (a == centre || b == centre)
+            continue;
+        vecIndices.emplace_back(a);
+        vecIndices.emplace_back(b);
+        vecIndices.emplace_back(centre);
+    }
+}
+
+float GridLodBuilder::computeError(const size_t level, const float* pPositions, const size_t stride) const
+{
+    const std::vector<size_t>& vecStops = vecLevelStops[level - 1];
+    auto position = [&](const size_t row, const size_t col) { return pPositions + (row * nSegments + col) * stride; };
+
+    float fMaxErrorSq = 0.f;
+    for (size_t row = 0; row + 1 < vecStops.size(); row++)
+    {
+        size_t r0 = vecStops[row], r1 = vecStops[row + 1];
+        for (size_t col = 0; col + 1 < vecStops.size(); col++)
+        {
+            size_t c0 = vecStops[col], c1 = vecStops[col + 1];
+            const float* p00 = position(r0, c0);
+            const float* p01 = position(r0, c1);
+            const float* p10 = position(r1, c0);
+            const float* p11 = position(r1, c1);
+
+            //every vertex inside the cell against the 2 coarse triangles covering it
+            for (size_t r = r0; r <= r1; r++)
+            {
+                float v = static_cast<float>(r - r0) / static_cast<float>(r1 - r0);
+                for (size_t c = c0; c <= c1; c++)
+                {
+                    float u = static_cast<float>(c - c0) / static_cast<float>(c1 - c0);
+                    const float* p = position(r, c);
+                    float fErrorSq = 0.f;
+                    for (size_t k = 0; k < 3; k++)
+                    {
+                        float fCoarse = u >= v ?
+                            p00[k] + u * (p01[k] - p00[k]) + v * (p11[k] - p01[k]) :
+                            p00[k] + v * (p10[k] - p00[k]) + u * (p11[k] - p10[k]);
+                        fErrorSq += (p[k] - fCoarse) * (p[k] - fCoarse);
+                    }
+                    fMaxErrorSq = std::max(fMaxErrorSq, fErrorSq);
+                }
+            }
+        }
+    }
+
+    return std::sqrt(fMaxErrorSq);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+constexpr size_t MaxLodLevels = 4;										//coarsest level skips 15 of every 16 rows and columns
+
+//builds the lod levels of a cube face by subsampling its regular vertex grid with a stride of 2, 4, 8...
+//every level indexes into the vertex buffer of the full resolution face so only new index lists are created
+class GridLodBuilder
+{
+	size_t nSections, nSegments;
+	bool bStitchEdges;													//keep every vertex along the face border so neighbouring faces dont crack
+	std::vector<std::vector<size_t>> vecLevelStops;						//rows / columns of the grid kept by each level
+	std::vector<std::vector<unsigned short>> vecLevelIndices;			//starts from level 1, level 0 is the face mesh itself
+
+	void addCell(std::vector<unsigned short>& vecIndices, const size_t r0, const size_t r1, const size_t c0, const size_t c1) const;
+	unsigned short index(const size_t row, const size_t col) const { return static_cast<unsigned short>(row * nSegments + col); }
+
+public:
+	GridLodBuilder();
+	void build(const size_t nSections, const bool bStitchEdges);
+	void clear();
+
+	size_t getNumLevels() const { return vecLevelIndices.size(); }
+	size_t getMemoryBytes() const;										//of the index lists and stops
+	const std::vector<unsigned short>& getIndices(const size_t level) const { return vecLevelIndices[level - 1]; }
+
+	//largest distance between a full resolution vertex and the coarse surface of the level
+	//pPositions holds xyz floats for every vertex of the face, each vertex stride floats apart
+	float computeError(const size_t level, const float* pPositions, const size_t stride) const;
+};
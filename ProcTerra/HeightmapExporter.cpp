@@ -0,0 +1,253 @@
+#include "HeightmapExporter.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+HeightmapFile::HeightmapFile() :
+    file(nullptr),
+    bOwned(false),
+    format(HeightmapFormat::Raw16),
+    nWidth(0)
+{
+}
+
+HeightmapFile::~HeightmapFile()
+{
+    if (file != nullptr && bOwned)
+        std::fclose(file);
+}
+
+bool HeightmapFile::open(const std::string& strPath, const HeightmapFormat format, const size_t nWidth, const size_t nHeight)
+{
+    FILE* fileOpened = std::fopen(strPath.c_str(), "wb");
+    if (fileOpened == nullptr)
+        return false;
+    bool bOpened = open(fileOpened, format, nWidth, nHeight);
+    bOwned = true;
+    return bOpened;
+}
+
+bool HeightmapFile::open(FILE* file, const HeightmapFormat format, const size_t nWidth, const size_t nHeight)
+{
+    this->file = file;
+    bOwned = false;
+    this->format = format;
+    this->nWidth = nWidth;
+
+    if (format == HeightmapFormat::PGM16)
+        std::fprintf(file, "P5\n%zu %zu\n65535\n", nWidth, nHeight);
+    else if (format == HeightmapFormat::PNG16)
+        png.begin(file, nWidth, nHeight, 16, PNGColourType::Grey);
+    return std::ferror(file) == 0;
+}
+
+bool HeightmapFile::writeRows(const uint16_t* pRows, const size_t nRows)
+{
+    //raw is little endian, pgm and png big endian
+    vecRow.resize(nWidth * 2 * nRows);
+    for (size_t i = 0; i < nWidth * nRows; i++)
+    {
+        unsigned char lo = static_cast<unsigned char>(pRows[i]), hi = static_cast<unsigned char>(pRows[i] >> 8);
+        vecRow[i * 2] = format == HeightmapFormat::Raw16 ? lo : hi;
+        vecRow[i * 2 + 1] = format == HeightmapFormat::Raw16 ? hi : lo;
+    }
+
+    if (format == HeightmapFormat::PNG16)
+        png.writeRows(vecRow.data(), nRows);
+    else
+        std::fwrite(vecRow.data(), 1, vecRow.size(), file);
+    return std::ferror(file) == 0;
+}
+
+bool HeightmapFile::close()
+{
+    if (file == nullptr)
+        return false;
+
+    if (format == HeightmapFormat::PNG16)
+        png.end();
+
+    bool bWritten = std::fflush(file) == 0 && std::ferror(file) == 0;
+    if (bOwned)
+        bWritten = std::fclose(file) == 0 && bWritten;
+    file = nullptr;
+    vecRow.clear();
+    vecRow.shrink_to_fit();
+    return bWritten;
+}
+
+HeightmapExporter::HeightmapExporter(Planet& planet) :
+    noise(planet.getNoise()),
+    domainWarp(planet.getDomainWarp()),
+    bDomainWarp(planet.bDomainWarp),
+    fRadius(planet.fSideLength / 2.f),
+    eMinDepth(planet.getMinDepth()),
+    fProgress(0.f),
+    nTile(0),
+    nWorkersBusy(0),
+    bStopWorkers(false),
+    nTileRows(0),
+    nNextRow(0)
+{
+}
+
+HeightmapExporter::~HeightmapExporter()
+{
+    stopTileWorkers();
+}
+
+void HeightmapExporter::startTileWorkers()
+{
+    //the exporting thread fills rows too
+    size_t nWorkers = std::max<size_t>(1, std::thread::hardware_concurrency()) - 1;
+    if (vecTileWorkers.size() == nWorkers)
+        return;
+    stopTileWorkers();
+    bStopWorkers = false;
+    //started with the current tile so they wait for the next one
+    for (size_t t = 0; t < nWorkers; t++)
+        vecTileWorkers.emplace_back(&HeightmapExporter::runTileWorker, this, nTile);
+}
+
+void HeightmapExporter::stopTileWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexTile);
+        bStopWorkers = true;
+    }
+    cvTileStart.notify_all();
+    for (auto& thread : vecTileWorkers)
+        thread.join();
+    vecTileWorkers.clear();
+}
+
+void HeightmapExporter::runTileWorker(uint64_t nJob)
+{
+    std::unique_lock<std::mutex> lock(mutexTile);
+    while (true)
+    {
+        cvTileStart.wait(lock, [this, nJob]() { return bStopWorkers || nTile != nJob; });
+        if (bStopWorkers)
+            return;
+        nJob = nTile;
+        lock.unlock();
+        fillRows();
+        lock.lock();
+        if (--nWorkersBusy == 0)
+            cvTileDone.notify_one();
+    }
+}
+
+void HeightmapExporter::fillRows()
+{
+    //every thread has its own copy of the noise since sampling it isnt const
+    FastNoiseLite noise = this->noise, domainWarp = this->domainWarp;
+    for (size_t row = nNextRow++; row < nTileRows; row = nNextRow++)
+        fillRow(noise, domainWarp, row);
+}
+
+template<typename Direction>
+void HeightmapExporter::fillTile(std::vector<uint16_t>& vecTile, const size_t nWidth, const size_t row0, const size_t nRows, const Direction& direction)
+{
+    //rows are handed out one at a time to the workers and this thread
+    fillRow = [&](FastNoiseLite& noise, FastNoiseLite& domainWarp, const size_t row)
+    {
+        for (size_t col = 0; col < nWidth; col++)
+        {
+            Ogre::Vector3 v = direction(col, row0 + row) * fRadius;
+            //same flattening below the minimum depth as the mesh
+            float e = std::max(Planet::sampleElevation(noise, bDomainWarp ? &domainWarp : nullptr, v), eMinDepth);
+            vecTile[row * nWidth + col] = static_cast<uint16_t>(std::lround((e + 1.f) * 0.5f * 65535.f));
+        }
+    };
+    nTileRows = nRows;
+    nNextRow = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutexTile);
+        nTile++;
+        nWorkersBusy = vecTileWorkers.size();
+    }
+    cvTileStart.notify_all();
+    fillRows();
+    {
+        std::unique_lock<std::mutex> lock(mutexTile);
+        cvTileDone.wait(lock, [this]() { return nWorkersBusy == 0; });
+    }
+}
+
+template<typename Direction>
+bool HeightmapExporter::exportImage(HeightmapFile& file, const size_t nWidth, const size_t nHeight, const Direction& direction, const float fProgressStart, const float fProgressRange)
+{
+    std::vector<uint16_t> vecTile(nWidth * HeightmapTileRows);
+    for (size_t row = 0; row < nHeight; row += HeightmapTileRows)
+    {
+        size_t nRows = std::min(HeightmapTileRows, nHeight - row);
+        fillTile(vecTile, nWidth, row, nRows, direction);
+        if (!file.writeRows(vecTile.data(), nRows))
+            return false;
+        fProgress = fProgressStart + fProgressRange * static_cast<float>(row + nRows) / static_cast<float>(nHeight);
+    }
+    return file.close();
+}
+
+bool HeightmapExporter::exportHeightmap(const std::string& strPath, const HeightmapLayout layout, const HeightmapFormat format, const size_t nWidth, const size_t nHeight)
+{
+    fProgress = 0.f;
+    if (nWidth == 0 || (layout == HeightmapLayout::Equirectangular && nHeight == 0))
+        return false;
+
+    //the workers last for the whole export, idle threads arent left behind once it is done
+    startTileWorkers();
+    struct StopTileWorkers { HeightmapExporter& exporter; ~StopTileWorkers() { exporter.stopTileWorkers(); } } workers{ *this };
+
+    const char* strExtension = format == HeightmapFormat::Raw16 ? ".raw" : format == HeightmapFormat::PGM16 ? ".pgm" : ".png";
+    if (layout == HeightmapLayout::Equirectangular)
+    {
+        HeightmapFile file;
+        return file.open(strPath + strExtension, format, nWidth, nHeight) && exportEquirectangular(file, nWidth, nHeight);
+    }
+
+    //pixels follow the vertex grid of the faces, columns along x and rows along z of the default plane
+    const std::pair<Ogre::Vector3, const char*> faces[6] = {
+        { Ogre::Vector3::UNIT_X, "_px" }, { Ogre::Vector3::NEGATIVE_UNIT_X, "_nx" },
+        { Ogre::Vector3::UNIT_Y, "_py" }, { Ogre::Vector3::NEGATIVE_UNIT_Y, "_ny" },
+        { Ogre::Vector3::UNIT_Z, "_pz" }, { Ogre::Vector3::NEGATIVE_UNIT_Z, "_nz" } };
+    for (size_t i = 0; i < 6; i++)
+    {
+        Ogre::Quaternion vertexRot = Planet::getFaceRotation(faces[i].first);
+        auto direction = [vertexRot, nWidth](const size_t col, const size_t row)
+        {
+            float x = (static_cast<float>(col) + 0.5f) / static_cast<float>(nWidth) * 2.f - 1.f;
+            float z = (static_cast<float>(row) + 0.5f) / static_cast<float>(nWidth) * 2.f - 1.f;
+            return (vertexRot * Ogre::Vector3(x, -1.f, z)).normalisedCopy();
+        };
+        HeightmapFile file;
+        if (!file.open(strPath + faces[i].second + strExtension, format, nWidth, nWidth) || !exportImage(file, nWidth, nWidth, direction, i / 6.f, 1.f / 6.f))
+            return false;
+    }
+    return true;
+}
+
+bool HeightmapExporter::exportHeightmap(FILE* file, const HeightmapFormat format, const size_t nWidth, const size_t nHeight)
+{
+    fProgress = 0.f;
+    if (nWidth == 0 || nHeight == 0)
+        return false;
+
+    startTileWorkers();
+    struct StopTileWorkers { HeightmapExporter& exporter; ~StopTileWorkers() { exporter.stopTileWorkers(); } } workers{ *this };
+    HeightmapFile heightmapFile;
+    return heightmapFile.open(file, format, nWidth, nHeight) && exportEquirectangular(heightmapFile, nWidth, nHeight);
+}
+
+bool HeightmapExporter::exportEquirectangular(HeightmapFile& file, const size_t nWidth, const size_t nHeight)
+{
+    //y is up, longitude 0 faces +z
+    auto direction = [nWidth, nHeight](const size_t col, const size_t row)
+    {
+        float fLongitude = (static_cast<float>(col) + 0.5f) / static_cast<float>(nWidth) * Ogre::Math::TWO_PI - Ogre::Math::PI;
+        float fLatitude = Ogre::Math::HALF_PI - (static_cast<float>(row) + 0.5f) / static_cast<float>(nHeight) * Ogre::Math::PI;
+        return Ogre::Vector3(std::cos(fLatitude) * std::sin(fLongitude), std::sin(fLatitude), std::cos(fLatitude) * std::cos(fLongitude));
+    };
+    return exportImage(file, nWidth, nHeight, direction, 0.f, 1.f);
+}
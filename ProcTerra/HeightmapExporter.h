@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "Planet.h"
+#include "PNGWriter.h"
+
+constexpr size_t HeightmapTileRows = 128;									//rows generated and written at a time, bounds the memory of an export
+
+enum class HeightmapLayout
+{
+	CubeFaces,														//6 square images, one per face of the planet mesh
+	Equirectangular													//longitude along x, latitude along y, should be twice as wide as high
+};
+
+enum class HeightmapFormat
+{
+	Raw16,															//little endian, no header
+	PGM16,
+	PNG16															//see PNGWriter
+};
+
+//writes a 16 bit greyscale image a few rows at a time
+class HeightmapFile
+{
+	FILE* file;
+	bool bOwned;													//opened from a path, closed with it
+	HeightmapFormat format;
+	size_t nWidth;
+	PNGWriter png;
+	std::vector<unsigned char> vecRow;
+
+public:
+	HeightmapFile();
+	~HeightmapFile();
+	HeightmapFile(const HeightmapFile&) = delete;
+	HeightmapFile& operator=(const HeightmapFile&) = delete;
+
+	bool open(const std::string& strPath, const HeightmapFormat format, const size_t nWidth, const size_t nHeight);
+	//an already open stream, close() leaves it open
+	bool open(FILE* file, const HeightmapFormat format, const size_t nWidth, const size_t nHeight);
+	bool writeRows(const uint16_t* pRows, const size_t nRows);
+	bool close();
+};
+
+//exports the elevation of a planet at any resolution, independent of the mesh sections
+//takes a copy of the noise so it can run on a background thread while the planet keeps changing
+class HeightmapExporter
+{
+	FastNoiseLite noise, domainWarp;
+	bool bDomainWarp;
+	float fRadius;
+	float eMinDepth;
+	std::atomic<float> fProgress;
+
+	//started once per export, every tile hands its rows to them and the exporting thread
+	std::vector<std::thread> vecTileWorkers;
+	std::mutex mutexTile;
+	std::condition_variable cvTileStart, cvTileDone;
+	uint64_t nTile;																//bumped for every tile, workers wait for it to change
+	size_t nWorkersBusy;
+	bool bStopWorkers;
+	std::function<void(FastNoiseLite&, FastNoiseLite&, const size_t)> fillRow;	//of the current tile, with the noise copies of the thread filling it
+	size_t nTileRows;
+	std::atomic<size_t> nNextRow;
+
+	void startTileWorkers();
+	void stopTileWorkers();
+	void runTileWorker(uint64_t nJob);
+	void fillRows();
+	//fills rows [row0, row0 + nRows) of an image, direction() maps a pixel to a point on the unit sphere
+	template<typename Direction>
+	void fillTile(std::vector<uint16_t>& vecTile, const size_t nWidth, const size_t row0, const size_t nRows, const Direction& direction);
+	//writes and closes the opened file
+	template<typename Direction>
+	bool exportImage(HeightmapFile& file, const size_t nWidth, const size_t nHeight, const Direction& direction, const float fProgressStart, const float fProgressRange);
+	bool exportEquirectangular(HeightmapFile& file, const size_t nWidth, const size_t nHeight);
+
+public:
+	HeightmapExporter(Planet& planet);
+	~HeightmapExporter();
+	HeightmapExporter(const HeightmapExporter&) = delete;
+	HeightmapExporter& operator=(const HeightmapExporter&) = delete;
+	//strPath is without extension, cube faces get _px, _nx, _py, _ny, _pz, _nz appended
+	//nHeight is ignored for cube faces which are nWidth square
+	bool exportHeightmap(const std::string& strPath, const HeightmapLayout layout, const HeightmapFormat format, const size_t nWidth, const size_t nHeight);
+	//an equirectangular image into any open stream, the caller closes it
+	bool exportHeightmap(FILE* file, const HeightmapFormat format, const size_t nWidth, const size_t nHeight);
+	float getProgress() const { return fProgress; }					//0 to 1
+};
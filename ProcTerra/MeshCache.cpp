@@ -0,0 +1,83 @@
+#include "MeshCache.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+MeshCache::MeshCache(const std::string& strDirectory, const uintmax_t nBudget) :
+    strDirectory(strDirectory),
+    nBudget(nBudget)
+{
+    strPath.reserve(strDirectory.size() + 24);
+}
+
+const std::string& MeshCache::getPath(const uint64_t hash) const
+{
+    char strName[24];
+    std::snprintf(strName, sizeof(strName), "/%016llx.bin", static_cast<unsigned long long>(hash));
+    strPath.assign(strDirectory).append(strName);
+    return strPath;
+}
+
+bool MeshCache::open(const uint64_t hash, PlanetFile& file) const
+{
+    const std::string& strEntry = getPath(hash);
+    if (!file.open(strEntry))
+        return false;
+
+    //the c runtime touches the file without the path conversions of std::filesystem
+#ifdef _WIN32
+    _utime(strEntry.c_str(), nullptr);
+#else
+    ::utime(strEntry.c_str(), nullptr);
+#endif
+    return true;
+}
+
+bool MeshCache::store(const uint64_t hash, const PlanetFileWriter& writer) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(strDirectory, error);
+    if (!writer.write(getPath(hash)))
+        return false;
+
+    evict();
+    return true;
+}
+
+void MeshCache::evict() const
+{
+    struct Entry
+    {
+        std::filesystem::path path;
+        uintmax_t nSize;
+        std::filesystem::file_time_type time;
+    };
+    std::vector<Entry> vecEntries;
+    uintmax_t nTotal = 0;
+
+    std::error_code error;
+    for (auto& file : std::filesystem::directory_iterator(strDirectory, error))
+    {
+        if (!file.is_regular_file(error) || file.path().extension() != ".bin")
+            continue;
+        Entry entry{ file.path(), file.file_size(error), file.last_write_time(error) };
+        if (error)
+            continue;
+        nTotal += entry.nSize;
+        vecEntries.emplace_back(std::move(entry));
+    }
+
+    //least recently used first, the newest entry is always kept even if it alone is over the budget
+    std::sort(vecEntries.begin(), vecEntries.end(), [](const Entry& a, const Entry& b) { return a.time < b.time; });
+    for (size_t i = 0; i + 1 < vecEntries.size() && nTotal > nBudget; i++)
+    {
+        if (std::filesystem::remove(vecEntries[i].path, error))
+            nTotal -= vecEntries[i].nSize;
+    }
+}
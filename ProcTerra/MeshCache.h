@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "PlanetFile.h"
+
+constexpr uintmax_t MeshCacheBudget = 512ull * 1024 * 1024;				//bytes on disk before the least recently used entries are removed
+
+//directory of planet files holding generated face buffers, one file per parameter hash
+//an entries modification time is its last use, so eviction needs no index file and survives restarts
+class MeshCache
+{
+	std::string strDirectory;
+	uintmax_t nBudget;
+	mutable std::string strPath;												//reused so a lookup on every generate() doesnt allocate, a cache belongs to one thread
+
+	const std::string& getPath(const uint64_t hash) const;						//valid until the next call
+	void evict() const;
+
+public:
+	MeshCache(const std::string& strDirectory = "./cache", const uintmax_t nBudget = MeshCacheBudget);
+
+	bool open(const uint64_t hash, PlanetFile& file) const;				//maps the entry and marks it as just used, false on a miss
+	bool store(const uint64_t hash, const PlanetFileWriter& writer) const;	//writes the entry and then trims the cache down to the budget
+};
@@ -0,0 +1,363 @@
+#include "MeshExporter.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+//same order as the faces of the planet
+static const Ogre::Vector3 FaceDirections[6] = {
+    Ogre::Vector3::UNIT_Y, Ogre::Vector3::UNIT_X, Ogre::Vector3::UNIT_Z,
+    Ogre::Vector3::NEGATIVE_UNIT_Y, Ogre::Vector3::NEGATIVE_UNIT_X, Ogre::Vector3::NEGATIVE_UNIT_Z };
+
+//same triangles as Planet::createDefaultFaceVerticesAndIndices() but 32 bit
+template<typename Emit>
+static void forEachFaceTriangle(const size_t nSections, const Emit& emit)
+{
+    uint32_t nSegments = static_cast<uint32_t>(nSections + 1);
+    for (uint32_t row = 0; row < nSections; row++)
+    {
+        for (uint32_t col = 0; col < nSections; col++)
+        {
+            uint32_t index = row * nSegments + col;
+            emit(index, index + nSegments + 1, index + nSegments);         //lower
+            emit(index, index + 1, index + 1 + nSegments);                  //upper
+        }
+    }
+}
+
+MeshExporter::MeshExporter(Planet& planet) :
+    planet(planet),
+    noise(planet.getNoise()),
+    domainWarp(planet.getDomainWarp()),
+    bDomainWarp(planet.bDomainWarp),
+    nFacesDone(0),
+    fProgress(0.f)
+{
+}
+
+template<typename Task>
+void MeshExporter::forEachFace(const size_t nSections, const Task& task)
+{
+    //the planet buffers are only valid for its own resolution
+    size_t nVertices = (nSections + 1) * (nSections + 1);
+    const std::vector<FaceBuffers>& vecPlanetBuffers = planet.getFaceBuffers();
+    bool bReuse = vecPlanetBuffers.size() == 6 && vecPlanetBuffers[0].vecVertices.size() == nVertices * 6;
+
+    size_t nThreads = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), 6));
+    std::vector<std::thread> vecThreads;
+    vecThreads.reserve(nThreads);
+    for (size_t t = 0; t < nThreads; t++)
+    {
+        vecThreads.emplace_back([&, t]()
+        {
+            FastNoiseLite noise = this->noise, domainWarp = this->domainWarp;
+            FaceBuffers face;
+            for (size_t i = t; i < 6; i += nThreads)
+            {
+                if (bReuse)
+                    task(i, vecPlanetBuffers[i]);
+                else
+                {
+                    planet.buildFace(face, FaceDirections[i], nSections, noise, bDomainWarp ? &domainWarp : nullptr, nullptr);
+                    task(i, std::move(face));
+                }
+                fProgress = 0.9f * ++nFacesDone / 6.f;
+            }
+        });
+    }
+    for (auto& thread : vecThreads)
+        thread.join();
+}
+
+void MeshExporter::buildRings()
+{
+    vecRingBuffers.clear();
+    vecRingOrientations.clear();
+    for (auto& ring : planet.vecRings)
+    {
+        if (!ring.bVisible)
+            continue;
+        for (auto& vFace : { Ogre::Vector3::UNIT_Y, Ogre::Vector3::NEGATIVE_UNIT_Y })
+        {
+            vecRingBuffers.emplace_back();
+            planet.buildRing(vecRingBuffers.back(), ring, vFace);
+            vecRingOrientations.emplace_back(Planet::getRingOrientation(ring));
+        }
+    }
+}
+
+bool MeshExporter::exportMesh(const std::string& strPath, const MeshFormat format, const size_t nSections)
+{
+    if (nSections < 1)
+        return false;
+
+    FILE* file = std::fopen((strPath + (format == MeshFormat::PLY ? ".ply" : ".glb")).c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    std::setvbuf(file, nullptr, _IOFBF, MeshExportBufferSize);
+
+    bool bWritten = exportMesh(file, format, nSections);
+    return std::fclose(file) == 0 && bWritten;
+}
+
+bool MeshExporter::exportMesh(FILE* file, const MeshFormat format, const size_t nSections)
+{
+    if (nSections < 1)
+        return false;
+
+    nFacesDone = 0;
+    fProgress = 0.f;
+    buildRings();
+    bool bWritten = format == MeshFormat::PLY ? exportPLY(file, nSections) : exportGLB(file, nSections);
+    bWritten = std::fflush(file) == 0 && std::ferror(file) == 0 && bWritten;
+    vecRingBuffers.clear();
+    fProgress = 1.f;
+    return bWritten;
+}
+
+bool MeshExporter::exportPLY(FILE* file, const size_t nSections)
+{
+    //every vertex is position, normal and rgba, every triangle a count byte and 3 indices
+    constexpr size_t nVertexSize = 6 * sizeof(float) + 4;
+    constexpr size_t nTriangleSize = 1 + 3 * sizeof(uint32_t);
+    size_t nFaceVertices = (nSections + 1) * (nSections + 1);
+    size_t nFaceTriangles = nSections * nSections * 2;
+    size_t nRingIndices = planet.getRingIndices().size();
+
+    size_t nVertices = nFaceVertices * 6, nTriangles = nFaceTriangles * 6;
+    for (auto& ring : vecRingBuffers)
+    {
+        nVertices += ring.vecColours.size();
+        nTriangles += nRingIndices / 3;
+    }
+    if (nVertices > std::numeric_limits<uint32_t>::max())
+        return false;
+
+    std::fprintf(file,
+        "ply\nformat binary_little_endian 1.0\ncomment ProcTerra\n"
+        "element vertex %zu\nproperty float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n"
+        "property uchar red\nproperty uchar green\nproperty uchar blue\nproperty uchar alpha\n"
+        "element face %zu\nproperty list uchar uint vertex_indices\nend_header\n", nVertices, nTriangles);
+
+    auto writeVertices = [](unsigned char* p, const FaceBuffers& buffers, const Ogre::Quaternion& rotation)
+    {
+        for (size_t j = 0; j < buffers.vecColours.size(); j++, p += nVertexSize)
+        {
+            const float* pVertex = &buffers.vecVertices[j * 6];
+            Ogre::Vector3 vPosition = rotation * Ogre::Vector3(pVertex[0], pVertex[1], pVertex[2]);
+            Ogre::Vector3 vNormal = rotation * Ogre::Vector3(pVertex[3], pVertex[4], pVertex[5]);
+            std::memcpy(p, vPosition.ptr(), 3 * sizeof(float));
+            std::memcpy(p + 3 * sizeof(float), vNormal.ptr(), 3 * sizeof(float));
+            std::memcpy(p + 6 * sizeof(float), &buffers.vecColours[j], 4);             //RGBA is already in byte order
+        }
+    };
+    auto writeTriangle = [](unsigned char*& p, const uint32_t a, const uint32_t b, const uint32_t c)
+    {
+        const uint32_t indices[3] = { a, b, c };
+        *p++ = 3;
+        std::memcpy(p, indices, sizeof(indices));
+        p += sizeof(indices);
+    };
+
+    //the faces are serialised in parallel into vertex blocks, each is written and freed as soon as it and the ones before it are done
+    //so only the blocks that finished out of order are held and never the whole file
+    std::vector<std::vector<unsigned char>> vecVertexBlocks(6);
+    bool bFaceDone[6] = {};
+    std::mutex mutexBlocks;
+    std::condition_variable cvBlocks;
+    std::thread builder([&]()
+    {
+        forEachFace(nSections, [&](const size_t i, const FaceBuffers& face)
+        {
+            std::vector<unsigned char> vecBlock(nFaceVertices * nVertexSize);
+            writeVertices(vecBlock.data(), face, Ogre::Quaternion::IDENTITY);
+            {
+                std::lock_guard<std::mutex> lock(mutexBlocks);
+                vecVertexBlocks[i] = std::move(vecBlock);
+                bFaceDone[i] = true;
+            }
+            cvBlocks.notify_one();
+        });
+    });
+    for (size_t i = 0; i < 6; i++)
+    {
+        std::vector<unsigned char> vecBlock;
+        {
+            std::unique_lock<std::mutex> lock(mutexBlocks);
+            cvBlocks.wait(lock, [&]() { return bFaceDone[i]; });
+            vecBlock = std::move(vecVertexBlocks[i]);
+        }
+        std::fwrite(vecBlock.data(), 1, vecBlock.size(), file);
+    }
+    builder.join();
+
+    //rings are small, their vertices follow the faces and their triangles follow the face triangles
+    std::vector<unsigned char> vecRingVertices, vecRingTriangles;
+    uint32_t nBase = static_cast<uint32_t>(nFaceVertices * 6);
+    for (size_t i = 0; i < vecRingBuffers.size(); i++)
+    {
+        size_t nRingVertices = vecRingBuffers[i].vecColours.size();
+        size_t nOffset = vecRingVertices.size();
+        vecRingVertices.resize(nOffset + nRingVertices * nVertexSize);
+        writeVertices(vecRingVertices.data() + nOffset, vecRingBuffers[i], vecRingOrientations[i]);
+
+        nOffset = vecRingTriangles.size();
+        vecRingTriangles.resize(nOffset + nRingIndices / 3 * nTriangleSize);
+        unsigned char* p = vecRingTriangles.data() + nOffset;
+        const std::vector<unsigned short>& vecRingIndices = planet.getRingIndices();
+        for (size_t j = 0; j + 2 < nRingIndices; j += 3)
+            writeTriangle(p, nBase + vecRingIndices[j], nBase + vecRingIndices[j + 1], nBase + vecRingIndices[j + 2]);
+        nBase += static_cast<uint32_t>(nRingVertices);
+    }
+    std::fwrite(vecRingVertices.data(), 1, vecRingVertices.size(), file);
+
+    //face triangles only depend on the grid, they are streamed through one buffer instead of being kept per face
+    std::vector<unsigned char> vecTriangles(MeshExportBufferSize / nTriangleSize * nTriangleSize);
+    unsigned char* p = vecTriangles.data();
+    for (size_t i = 0; i < 6; i++)
+    {
+        uint32_t nFaceBase = static_cast<uint32_t>(i * nFaceVertices);
+        forEachFaceTriangle(nSections, [&](const uint32_t a, const uint32_t b, const uint32_t c)
+        {
+            writeTriangle(p, nFaceBase + a, nFaceBase + b, nFaceBase + c);
+            if (p == vecTriangles.data() + vecTriangles.size())
+            {
+                std::fwrite(vecTriangles.data(), 1, vecTriangles.size(), file);
+                p = vecTriangles.data();
+            }
+        });
+    }
+    std::fwrite(vecTriangles.data(), 1, p - vecTriangles.data(), file);
+    std::fwrite(vecRingTriangles.data(), 1, vecRingTriangles.size(), file);
+    return std::ferror(file) == 0;
+}
+
+bool MeshExporter::exportGLB(FILE* file, const size_t nSections)
+{
+    //faces are kept until written since the json needs the bounds of every face before the binary chunk
+    size_t nFaceVertices = (nSections + 1) * (nSections + 1);
+    std::vector<FaceBuffers> vecBuffers(6);
+    std::vector<const FaceBuffers*> vecMeshes(6);
+    forEachFace(nSections, [&](const size_t i, auto&& face)
+    {
+        //the planet's own buffers are const, built ones are moved out of the thread
+        if constexpr (std::is_const_v<std::remove_reference_t<decltype(face)>>)
+            vecMeshes[i] = &face;
+        else
+        {
+            vecBuffers[i] = std::move(face);
+            vecMeshes[i] = &vecBuffers[i];
+        }
+    });
+    for (auto& ring : vecRingBuffers)
+        vecMeshes.push_back(&ring);
+
+    //binary chunk - the face indices shared by all faces, the ring indices, then the vertices and colours of each mesh
+    std::vector<uint32_t> vecFaceIndices;
+    vecFaceIndices.reserve(nSections * nSections * 6);
+    forEachFaceTriangle(nSections, [&](const uint32_t a, const uint32_t b, const uint32_t c) { vecFaceIndices.insert(vecFaceIndices.end(), { a, b, c }); });
+    const std::vector<unsigned short>& vecRingIndices = planet.getRingIndices();
+    bool bRings = !vecRingBuffers.empty();
+    size_t nRingIndexSize = bRings ? (vecRingIndices.size() * sizeof(unsigned short) + 3) & ~size_t(3) : 0;
+
+    std::string strJson = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"ProcTerra\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+    for (size_t i = 0; i < vecMeshes.size(); i++)
+        strJson += (i ? "," : "") + std::to_string(i);
+    strJson += "]}],\"nodes\":[";
+    char strBuffer[256];
+    for (size_t i = 0; i < vecMeshes.size(); i++)
+    {
+        std::snprintf(strBuffer, sizeof(strBuffer), "%s{\"mesh\":%zu", i ? "," : "", i);
+        strJson += strBuffer;
+        if (i >= 6)
+        {
+            const Ogre::Quaternion& q = vecRingOrientations[i - 6];
+            std::snprintf(strBuffer, sizeof(strBuffer), ",\"rotation\":[%.9g,%.9g,%.9g,%.9g]", q.x, q.y, q.z, q.w);
+            strJson += strBuffer;
+        }
+        strJson += "}";
+    }
+
+    //accessor 0 is the face indices, 1 the ring indices, then position, normal and colour of each mesh
+    size_t nFirstAccessor = bRings ? 2 : 1;
+    strJson += "],\"meshes\":[";
+    for (size_t i = 0; i < vecMeshes.size(); i++)
+    {
+        size_t nAccessor = nFirstAccessor + i * 3;
+        std::snprintf(strBuffer, sizeof(strBuffer), "%s{\"primitives\":[{\"attributes\":{\"POSITION\":%zu,\"NORMAL\":%zu,\"COLOR_0\":%zu},\"indices\":%d}]}",
+            i ? "," : "", nAccessor, nAccessor + 1, nAccessor + 2, i < 6 ? 0 : 1);
+        strJson += strBuffer;
+    }
+
+    //buffer view 0 and 1 are the indices, then the interleaved position and normal and the colours of each mesh
+    size_t nOffset = 0;
+    std::snprintf(strBuffer, sizeof(strBuffer), "],\"bufferViews\":[{\"buffer\":0,\"byteOffset\":0,\"byteLength\":%zu,\"target\":34963}", vecFaceIndices.size() * sizeof(uint32_t));
+    strJson += strBuffer;
+    nOffset += vecFaceIndices.size() * sizeof(uint32_t);
+    if (bRings)
+    {
+        std::snprintf(strBuffer, sizeof(strBuffer), ",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}", nOffset, vecRingIndices.size() * sizeof(unsigned short));
+        strJson += strBuffer;
+        nOffset += nRingIndexSize;
+    }
+    for (auto mesh : vecMeshes)
+    {
+        size_t nVertices = mesh->vecColours.size();
+        std::snprintf(strBuffer, sizeof(strBuffer), ",{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"byteStride\":24,\"target\":34962},{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34962}",
+            nOffset, nVertices * 6 * sizeof(float), nOffset + nVertices * 6 * sizeof(float), nVertices * 4);
+        strJson += strBuffer;
+        nOffset += nVertices * (6 * sizeof(float) + 4);
+    }
+    size_t nBinarySize = nOffset;
+
+    std::snprintf(strBuffer, sizeof(strBuffer), "],\"accessors\":[{\"bufferView\":0,\"componentType\":5125,\"count\":%zu,\"type\":\"SCALAR\"}", vecFaceIndices.size());
+    strJson += strBuffer;
+    if (bRings)
+    {
+        std::snprintf(strBuffer, sizeof(strBuffer), ",{\"bufferView\":1,\"componentType\":5123,\"count\":%zu,\"type\":\"SCALAR\"}", vecRingIndices.size());
+        strJson += strBuffer;
+    }
+    for (size_t i = 0; i < vecMeshes.size(); i++)
+    {
+        size_t nView = nFirstAccessor + i * 2, nVertices = vecMeshes[i]->vecColours.size();
+        const Ogre::Vector3& vMin = vecMeshes[i]->box.getMinimum(), &vMax = vecMeshes[i]->box.getMaximum();
+        std::snprintf(strBuffer, sizeof(strBuffer), ",{\"bufferView\":%zu,\"byteOffset\":0,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\",\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]}",
+            nView, nVertices, vMin.x, vMin.y, vMin.z, vMax.x, vMax.y, vMax.z);
+        strJson += strBuffer;
+        std::snprintf(strBuffer, sizeof(strBuffer), ",{\"bufferView\":%zu,\"byteOffset\":12,\"componentType\":5126,\"count\":%zu,\"type\":\"VEC3\"}", nView, nVertices);
+        strJson += strBuffer;
+        std::snprintf(strBuffer, sizeof(strBuffer), ",{\"bufferView\":%zu,\"componentType\":5121,\"normalized\":true,\"count\":%zu,\"type\":\"VEC4\"}", nView + 1, nVertices);
+        strJson += strBuffer;
+    }
+    std::snprintf(strBuffer, sizeof(strBuffer), "],\"buffers\":[{\"byteLength\":%zu}]}", nBinarySize);
+    strJson += strBuffer;
+    strJson.resize((strJson.size() + 3) & ~size_t(3), ' ');
+
+    //the whole file length is 32 bit
+    size_t nFileSize = 12 + 8 + strJson.size() + 8 + nBinarySize;
+    if (nFileSize > std::numeric_limits<uint32_t>::max())
+        return false;
+
+    const uint32_t header[5] = { 0x46546C67, 2, static_cast<uint32_t>(nFileSize), static_cast<uint32_t>(strJson.size()), 0x4E4F534A };      //glTF, JSON
+    std::fwrite(header, sizeof(uint32_t), 5, file);
+    std::fwrite(strJson.data(), 1, strJson.size(), file);
+    const uint32_t binaryHeader[2] = { static_cast<uint32_t>(nBinarySize), 0x004E4942 };                                                //BIN
+    std::fwrite(binaryHeader, sizeof(uint32_t), 2, file);
+
+    std::fwrite(vecFaceIndices.data(), sizeof(uint32_t), vecFaceIndices.size(), file);
+    if (bRings)
+    {
+        std::fwrite(vecRingIndices.data(), sizeof(unsigned short), vecRingIndices.size(), file);
+        static const unsigned char padding[4] = {};
+        std::fwrite(padding, 1, nRingIndexSize - vecRingIndices.size() * sizeof(unsigned short), file);
+    }
+    for (auto mesh : vecMeshes)
+    {
+        std::fwrite(mesh->vecVertices.data(), sizeof(float), mesh->vecVertices.size(), file);
+        std::fwrite(mesh->vecColours.data(), sizeof(Ogre::RGBA), mesh->vecColours.size(), file);
+    }
+    return std::ferror(file) == 0;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Planet.h"
+
+constexpr size_t MeshExportBufferSize = 1 << 22;								//stdio buffer of the output file, blocks larger than this are written straight through
+
+enum class MeshFormat
+{
+	PLY,															//binary little endian, one vertex list for the whole planet with the ring rotation applied
+	GLB																//binary gltf 2.0, one node per face and ring
+};
+
+//exports the planet mesh at any number of sections from the cpu side buffers, nothing is read back from the card
+//the 6 faces are built and serialised on separate threads, each with its own copy of the noise
+//uses 32 bit indices so nSections can go past MaxSections
+class MeshExporter
+{
+	const Planet& planet;
+	FastNoiseLite noise, domainWarp;
+	bool bDomainWarp;
+	std::vector<FaceBuffers> vecRingBuffers;										//UNIT_Y then NEGATIVE_UNIT_Y of every visible ring
+	std::vector<Ogre::Quaternion> vecRingOrientations;
+	std::atomic<size_t> nFacesDone;
+	std::atomic<float> fProgress;
+
+	//runs task(i, face) for all 6 faces spread over the hardware threads, face is the planet's own buffer when the sections match
+	template<typename Task>
+	void forEachFace(const size_t nSections, const Task& task);
+	void buildRings();
+	bool exportPLY(FILE* file, const size_t nSections);
+	bool exportGLB(FILE* file, const size_t nSections);
+
+public:
+	MeshExporter(Planet& planet);
+	//strPath is without extension
+	bool exportMesh(const std::string& strPath, const MeshFormat format, const size_t nSections);
+	//into any open stream, the caller closes it
+	bool exportMesh(FILE* file, const MeshFormat format, const size_t nSections);
+	float getProgress() const { return fProgress; }					//0 to 1, the faces are most of the work
+};
@@ -0,0 +1,164 @@
+//microbenchmark of the FastNoiseLite kernels the planet faces are built from
+//every noise type, fractal type and octave count through the 3D GetNoise path, then every domain warp type
+//prints one json object per configuration so runs can be diffed and tracked
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "FastNoiseLite.h"
+
+constexpr size_t NoiseBenchPoints = 1 << 16;								//samples per pass, spread over the sphere like face vertices
+constexpr float NoiseBenchRadius = 900.f;									//fSideLength / 2 of the default planet, the noise is sampled at world positions
+constexpr double NoiseBenchMinMs = 50.0;									//passes are repeated for at least this long, the fastest one is reported
+
+static const char* NoiseTypeNames[] = { "OpenSimplex2", "OpenSimplex2S", "Cellular", "Perlin", "ValueCubic", "Value" };
+static const char* FractalTypeNames[] = { "None", "FBm", "Ridged", "PingPong", "DomainWarpProgressive", "DomainWarpIndependent" };
+static const char* DomainWarpTypeNames[] = { "OpenSimplex2", "OpenSimplex2Reduced", "BasicGrid" };
+
+static void printUsage()
+{
+    std::printf(
+        "usage: ProcTerraNoiseBench [options]\n"
+        "  --out <file>                write the results there instead of stdout, one json object per line\n"
+        "  --max-octaves <n>           default 8\n"
+        "  --min-ms <ms>               time spent on each configuration, default 50\n");
+}
+
+//the same default values as Planet::resetToDefaultNoiseValues()
+static FastNoiseLite makeNoise()
+{
+    FastNoiseLite noise(428);
+    noise.SetFrequency(0.00095f);
+    noise.SetFractalGain(.215f);
+    noise.SetFractalLacunarity(5.f);
+    noise.SetFractalPingPongStrength(2.1f);
+    noise.SetCellularDistanceFunction(FastNoiseLite::CellularDistanceFunction_EuclideanSq);
+    noise.SetCellularReturnType(FastNoiseLite::CellularReturnType_Distance);
+    noise.SetDomainWarpAmp(30.f);
+    return noise;
+}
+
+//fastest pass over all the points in ns per sample, sample() is called with every point and returns something to keep it from being optimised out
+template<typename Sample>
+static double measure(const std::vector<float>& vecPoints, const double fMinMs, const Sample& sample)
+{
+    volatile float fSink = 0.f;
+    double fBestNs = 1e30, fTotalMs = 0.0;
+    size_t nPoints = vecPoints.size() / 3;
+    for (size_t pass = 0; pass < 3 || fTotalMs < fMinMs; pass++)
+    {
+        auto timeStart = std::chrono::steady_clock::now();
+        float fSum = 0.f;
+        for (size_t i = 0; i < nPoints; i++)
+            fSum += sample(vecPoints[i * 3], vecPoints[i * 3 + 1], vecPoints[i * 3 + 2]);
+        double fMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+        fSink = fSink + fSum;
+        fTotalMs += fMs;
+        fBestNs = std::min(fBestNs, fMs * 1e6 / nPoints);
+    }
+    return fBestNs;
+}
+
+int main(int argc, char** argv)
+{
+    std::string strOut;
+    int iMaxOctaves = 8;
+    double fMinMs = NoiseBenchMinMs;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string strArg = argv[i];
+        if (strArg == "--help" || strArg == "-h" || i + 1 >= argc)
+        {
+            printUsage();
+            return strArg == "--help" || strArg == "-h" ? 0 : 1;
+        }
+        const char* strValue = argv[++i];
+        if (strArg == "--out")
+            strOut = strValue;
+        else if (strArg == "--max-octaves")
+            iMaxOctaves = std::max(1, std::atoi(strValue));
+        else if (strArg == "--min-ms")
+            fMinMs = std::atof(strValue);
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    FILE* file = strOut.empty() ? stdout : std::fopen(strOut.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "cannot open '%s'\n", strOut.c_str());
+        return 1;
+    }
+
+    //fibonacci sphere, evenly spread without the clustering of a cube face grid at the corners
+    std::vector<float> vecPoints(NoiseBenchPoints * 3);
+    const float fGoldenAngle = 2.39996323f;
+    for (size_t i = 0; i < NoiseBenchPoints; i++)
+    {
+        float y = 1.f - 2.f * (i + 0.5f) / NoiseBenchPoints;
+        float r = std::sqrt(1.f - y * y);
+        vecPoints[i * 3] = std::cos(fGoldenAngle * i) * r * NoiseBenchRadius;
+        vecPoints[i * 3 + 1] = y * NoiseBenchRadius;
+        vecPoints[i * 3 + 2] = std::sin(fGoldenAngle * i) * r * NoiseBenchRadius;
+    }
+
+    auto print = [file](const std::string& strConfig, const double fNs)
+    {
+        std::fprintf(file, "{%s,\"nsPerSample\":%.3f,\"samplesPerSec\":%.0f}\n", strConfig.c_str(), fNs, 1e9 / fNs);
+        std::fflush(file);
+    };
+
+    //octaves only matter with a fractal, the domain warp fractal types arent for GetNoise
+    for (int noiseType = FastNoiseLite::NoiseType_OpenSimplex2; noiseType <= FastNoiseLite::NoiseType_Value; noiseType++)
+    {
+        for (int fractalType = FastNoiseLite::FractalType_None; fractalType <= FastNoiseLite::FractalType_PingPong; fractalType++)
+        {
+            for (int iOctaves = 1; iOctaves <= (fractalType == FastNoiseLite::FractalType_None ? 1 : iMaxOctaves); iOctaves++)
+            {
+                FastNoiseLite noise = makeNoise();
+                noise.SetNoiseType(static_cast<FastNoiseLite::NoiseType>(noiseType));
+                noise.SetFractalType(static_cast<FastNoiseLite::FractalType>(fractalType));
+                noise.SetFractalOctaves(iOctaves);
+                double fNs = measure(vecPoints, fMinMs, [&noise](float x, float y, float z) { return noise.GetNoise(x, y, z); });
+                print(std::string("\"kernel\":\"GetNoise\",\"noiseType\":\"") + NoiseTypeNames[noiseType] + "\",\"fractalType\":\"" + FractalTypeNames[fractalType] +
+                    "\",\"octaves\":" + std::to_string(iOctaves), fNs);
+            }
+        }
+    }
+
+    //the warp alone, the noise sampled at the warped point costs what it does above
+    for (int domainWarpType = FastNoiseLite::DomainWarpType_OpenSimplex2; domainWarpType <= FastNoiseLite::DomainWarpType_BasicGrid; domainWarpType++)
+    {
+        for (int fractalType : { FastNoiseLite::FractalType_None, FastNoiseLite::FractalType_DomainWarpProgressive, FastNoiseLite::FractalType_DomainWarpIndependent })
+        {
+            for (int iOctaves = 1; iOctaves <= (fractalType == FastNoiseLite::FractalType_None ? 1 : iMaxOctaves); iOctaves++)
+            {
+                FastNoiseLite domainWarp(428);
+                domainWarp.SetDomainWarpType(static_cast<FastNoiseLite::DomainWarpType>(domainWarpType));
+                domainWarp.SetDomainWarpAmp(30.f);
+                domainWarp.SetFrequency(0.005f);
+                domainWarp.SetFractalType(static_cast<FastNoiseLite::FractalType>(fractalType));
+                domainWarp.SetFractalOctaves(iOctaves);
+                domainWarp.SetFractalLacunarity(2.f);
+                domainWarp.SetFractalGain(.5f);
+                double fNs = measure(vecPoints, fMinMs, [&domainWarp](float x, float y, float z)
+                {
+                    domainWarp.DomainWarp(x, y, z);
+                    return x + y + z;
+                });
+                print(std::string("\"kernel\":\"DomainWarp\",\"domainWarpType\":\"") + DomainWarpTypeNames[domainWarpType] + "\",\"fractalType\":\"" + FractalTypeNames[fractalType] +
+                    "\",\"octaves\":" + std::to_string(iOctaves), fNs);
+            }
+        }
+    }
+
+    if (file != stdout && std::fclose(file) != 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "PNGWriter.h"
+#include <algorithm>
+#include "PlanetFile.h"
+
+PNGWriter::PNGWriter() :
+    file(nullptr),
+    nRowSize(0),
+    adler(1)
+{
+}
+
+void PNGWriter::writeChunk(const char* strType, const unsigned char* pData, const size_t nSize)
+{
+    unsigned char length[4] = { static_cast<unsigned char>(nSize >> 24), static_cast<unsigned char>(nSize >> 16), static_cast<unsigned char>(nSize >> 8), static_cast<unsigned char>(nSize) };
+    uint32_t crc = crc32(pData, nSize, crc32(strType, 4));
+    unsigned char crcBytes[4] = { static_cast<unsigned char>(crc >> 24), static_cast<unsigned char>(crc >> 16), static_cast<unsigned char>(crc >> 8), static_cast<unsigned char>(crc) };
+    std::fwrite(length, 1, 4, file);
+    std::fwrite(strType, 1, 4, file);
+    std::fwrite(pData, 1, nSize, file);
+    std::fwrite(crcBytes, 1, 4, file);
+}
+
+void PNGWriter::begin(FILE* file, const size_t nWidth, const size_t nHeight, const uint8_t nBitDepth, const PNGColourType colourType)
+{
+    this->file = file;
+    nRowSize = nWidth * (colourType == PNGColourType::RGB ? 3 : 1) * nBitDepth / 8;
+    adler = 1;
+
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::fwrite(signature, 1, sizeof(signature), file);
+    //no interlacing
+    unsigned char header[13] = {
+        static_cast<unsigned char>(nWidth >> 24), static_cast<unsigned char>(nWidth >> 16), static_cast<unsigned char>(nWidth >> 8), static_cast<unsigned char>(nWidth),
+        static_cast<unsigned char>(nHeight >> 24), static_cast<unsigned char>(nHeight >> 16), static_cast<unsigned char>(nHeight >> 8), static_cast<unsigned char>(nHeight),
+        nBitDepth, static_cast<unsigned char>(colourType), 0, 0, 0 };
+    writeChunk("IHDR", header, sizeof(header));
+    //zlib header, no compression
+    static const unsigned char zlibHeader[2] = { 0x78, 0x01 };
+    writeChunk("IDAT", zlibHeader, sizeof(zlibHeader));
+}
+
+void PNGWriter::writeRows(const unsigned char* pRows, const size_t nRows)
+{
+    //every row is a filter byte and the samples, the rows are then split into stored deflate blocks of at most 65535 bytes
+    size_t nDataSize = (1 + nRowSize) * nRows;
+    size_t nBlocks = (nDataSize + 65534) / 65535;
+    vecData.resize(nDataSize);
+    vecChunk.resize(nDataSize + nBlocks * 5);
+
+    for (size_t row = 0; row < nRows; row++)
+    {
+        unsigned char* p = vecData.data() + row * (1 + nRowSize);
+        *p = 0;
+        std::copy(pRows + row * nRowSize, pRows + (row + 1) * nRowSize, p + 1);
+    }
+
+    //adler32 of the uncompressed stream, reduced before the sums can overflow
+    uint32_t s1 = adler & 0xFFFF, s2 = adler >> 16;
+    for (size_t i = 0; i < nDataSize; )
+    {
+        size_t nEnd = std::min(nDataSize, i + 5552);
+        for (; i < nEnd; i++)
+        {
+            s1 += vecData[i];
+            s2 += s1;
+        }
+        s1 %= 65521;
+        s2 %= 65521;
+    }
+    adler = s2 << 16 | s1;
+
+    unsigned char* p = vecChunk.data();
+    for (size_t offset = 0; offset < nDataSize; offset += 65535)
+    {
+        uint16_t nLength = static_cast<uint16_t>(std::min<size_t>(65535, nDataSize - offset));
+        *p++ = 0;                                                      //not the final block
+        *p++ = static_cast<unsigned char>(nLength);
+        *p++ = static_cast<unsigned char>(nLength >> 8);
+        *p++ = static_cast<unsigned char>(~nLength);
+        *p++ = static_cast<unsigned char>(~nLength >> 8);
+        std::copy(vecData.begin() + offset, vecData.begin() + offset + nLength, p);
+        p += nLength;
+    }
+    writeChunk("IDAT", vecChunk.data(), vecChunk.size());
+}
+
+void PNGWriter::end()
+{
+    //empty final block then the adler32 of the whole stream
+    unsigned char end[9] = { 1, 0, 0, 0xFF, 0xFF,
+        static_cast<unsigned char>(adler >> 24), static_cast<unsigned char>(adler >> 16), static_cast<unsigned char>(adler >> 8), static_cast<unsigned char>(adler) };
+    writeChunk("IDAT", end, sizeof(end));
+    writeChunk("IEND", nullptr, 0);
+    vecData.clear();
+    vecData.shrink_to_fit();
+    vecChunk.clear();
+    vecChunk.shrink_to_fit();
+}
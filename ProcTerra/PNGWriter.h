@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+enum class PNGColourType : uint8_t
+{
+	Grey = 0,
+	RGB = 2
+};
+
+//streams a png a few rows at a time into an open file
+//the deflate blocks are stored uncompressed so rows can be written as they are generated without a zlib dependency
+class PNGWriter
+{
+	FILE* file;
+	size_t nRowSize;												//bytes of a row without the filter byte
+	uint32_t adler;													//running checksum of the zlib stream
+	std::vector<unsigned char> vecData, vecChunk;
+
+	void writeChunk(const char* strType, const unsigned char* pData, const size_t nSize);
+
+public:
+	PNGWriter();
+	void begin(FILE* file, const size_t nWidth, const size_t nHeight, const uint8_t nBitDepth, const PNGColourType colourType);
+	void writeRows(const unsigned char* pRows, const size_t nRows);		//packed rows, samples wider than 8 bits big endian
+	void end();
+};
@@ -1,6 +1,18 @@
 #include "Planet.h"
-#include <OgreMeshLodGenerator.h>
-#include <OgreLodConfig.h>
+#include "Trace.h"
+#include <RTShaderSystem/OgreRTShaderSystem.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+//ms between two points in time, for the generate() timings
+static double getMs(const std::chrono::steady_clock::time_point timeStart, const std::chrono::steady_clock::time_point timeEnd)
+{
+    return std::chrono::duration<double, std::milli>(timeEnd - timeStart).count();
+}
 
 Planet::Planet(Ogre::SceneManager* mSceneMgr, MeshType meshType, std::string strName, Ogre::uint32 visibilityMask) :
     mSceneMgr(mSceneMgr),
@@ -17,8 +29,33 @@ Planet::Planet(Ogre::SceneManager* mSceneMgr, MeshType meshType, std::string str
     lightType(LightType::AMBIENT),
     bRenderElevation(true),
     visibilityMask(visibilityMask),
-    bAutoLodGeneration(false)
+    bAutoLodGeneration(false),
+    bLodStitchEdges(true),
+    bBakeElevation(true),
+    bMeshCache(true),
+    nGenerateThreads(0),
+    elevationHash(0),
+    meshCacheHash(0),
+    nGenerateCount(0),
+    nUploadCount(0),
+    pBakedElevation(nullptr),
+    entityRings(nullptr),
+    sceneNodeRings(nullptr),
+    ringsHash(0),
+    ringDebrisHash(0),
+    bRingDebris(false),
+    nRingDebris(DefaultRingDebrisPerRing),
+    nGenerateJob(0),
+    nWorkersBusy(0),
+    bStopWorkers(false),
+    nNextFace(0)
+{
+}
+
+Planet::~Planet()
 {
+    waitMeshCacheStore();
+    stopGenerateWorkers();
 }
 
 void Planet::update(const float& fDeltaTime)
@@ -32,35 +69,27 @@ void Planet::update(const float& fDeltaTime)
         if(bRoll)
             e->roll(Ogre::Radian(fDeltaTime * fRoll), Ogre::Node::TS_WORLD);
     }
+
+    //faces the values stayed at for a moment go in the mesh cache on another thread, the next generate() waits for it
+    if (futureMeshCacheStore.valid() && futureMeshCacheStore.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        futureMeshCacheStore.get();
+    if (bMeshCache && meshCacheHash != 0 && !futureMeshCacheStore.valid() &&
+        std::chrono::duration<float>(std::chrono::steady_clock::now() - timeGenerated).count() > MeshCacheStoreDelay)
+    {
+        futureMeshCacheStore = std::async(std::launch::async, [this, hash = meshCacheHash]() { writeMeshCache(hash); });
+        meshCacheHash = 0;
+    }
 }
 
 void Planet::init()
 {
-    //first read from .dat file
-    if (!readDATFile())
-    {
-        resetToDefaultNoiseValues();
-        resetToDefaultBiomeValues();
-
-        //resize to initialize 3 ring objects
-        vecRings.resize(3);
-        resetToDefaultRingValues();
-    }
+    //first read from planet.bin
+    if (!readPlanetFile())
+        resetToDefaultValues();
     initMeshValues();
 
     //generate the mesh first time
-    //create a generic material so that it may set the diffuse color
-    material = Ogre::MaterialManager::getSingleton().create(strName + "DiffuseMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
-    //use if directional lighting is disabled and only ambient light is used
-    if (lightType == LightType::AMBIENT)                                              //gradient mesh will always have ambient light
-    {
-        material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_AMBIENT);
-    }
-    else
-    {
-        material->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_DIFFUSE);
-        material->getTechnique(0)->getPass(0)->setLightingEnabled(true);
-    }
+    createMaterials();
 
     createDefaultFaceVerticesAndIndices();
 
@@ -74,206 +103,604 @@ void Planet::init()
     vecFaces.emplace_back(createNormalisedFace(Ogre::Vector3::NEGATIVE_UNIT_Y, strName + "PlaneNY", strName + "FaceNY"));
     vecFaces.emplace_back(createNormalisedFace(Ogre::Vector3::NEGATIVE_UNIT_X, strName + "PlaneNX", strName + "FaceNX"));
     vecFaces.emplace_back(createNormalisedFace(Ogre::Vector3::NEGATIVE_UNIT_Z, strName + "PlaneNZ", strName + "FaceNZ"));
+    reserveBuffers();
+
+    if (bAutoLodGeneration)
+        createLodLevels();
 
     //create ring mesh, not for gradient planet
     if (meshType == MeshType::NORMAL_BIOMES)
+        createRings();
+
+    //generate mesh with noise for first time, also update rings
+    generate();
+
+}
+
+void Planet::initHeadless()
+{
+    //only the cpu side buffers, the values are set beforehand with resetToDefaultValues(), readPlanetFile() or setParam()
+    initMeshValues();
+    createDefaultFaceVerticesAndIndices();
+    reserveBuffers();
+}
+
+void Planet::reserveBuffers()
+{
+    //only grows, so going back to a lower resolution and up again doesnt allocate either
+    vecFaceBuffers.resize(6);
+    for (auto& face : vecFaceBuffers)
     {
-        //init all 3 rings
-        short i = 0;
-        for (auto& ring : vecRings)
+        face.vecVertices.reserve(vBufCount);
+        face.vecColours.reserve(nVertices);
+        face.vecElevations.reserve(nVertices);
+    }
+    scratchBuffers.vecVertices.reserve(std::max(vBufCount, vecRings.size() * 4 * RingVertexFloats));
+    scratchBuffers.vecColours.reserve(std::max<size_t>(nVertices, vecRings.size() * 4));
+    vecRingBatchIndices.reserve(vecRings.size() * 6);
+}
+
+
+void Planet::createMaterials()
+{
+    //create a generic material so that it may set the diffuse color
+    //use if directional lighting is disabled and only ambient light is used
+    materialAmbient = Ogre::MaterialManager::getSingleton().create(strName + "DiffuseMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    materialAmbient->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_AMBIENT);
+
+    //use if directional light is enabled
+    materialSunlight = Ogre::MaterialManager::getSingleton().create(strName + "SunlightMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    materialSunlight->getTechnique(0)->getPass(0)->setVertexColourTracking(Ogre::TVC_DIFFUSE);
+    materialSunlight->getTechnique(0)->getPass(0)->setLightingEnabled(true);
+
+    //generate and compile the shaders of both variants now instead of the first frame they are used
+    Ogre::RTShader::ShaderGenerator* shadergen = Ogre::RTShader::ShaderGenerator::getSingletonPtr();
+    for (auto& material : { materialAmbient, materialSunlight })
+    {
+        if (shadergen)
         {
-            ring.mshY = createRing(Ogre::Vector3::UNIT_Y, &ring.entityY, &ring.sceneNodeY, ring.colorInner, ring.colorOuter, strName + "PlaneRingY" + std::to_string(i), strName + "RingFaceY" + std::to_string(i));
-            ring.mshNY = createRing(Ogre::Vector3::NEGATIVE_UNIT_Y, &ring.entityNY, &ring.sceneNodeNY, ring.colorInner, ring.colorOuter, strName + "PlaneRingNY" + std::to_string(i), strName + "RingFaceNY" + std::to_string(i++));
-            ring.entityY->setVisible(ring.bVisible);
-            ring.entityNY->setVisible(ring.bVisible);
-            ring.sceneNodeY->pitch(Ogre::Radian(ring.fPitch), Ogre::Node::TS_WORLD);
-            ring.sceneNodeY->yaw(Ogre::Radian(ring.fYaw), Ogre::Node::TS_WORLD);
-            ring.sceneNodeY->roll(Ogre::Radian(ring.fRoll), Ogre::Node::TS_WORLD);
-            ring.sceneNodeNY->pitch(Ogre::Radian(ring.fPitch), Ogre::Node::TS_WORLD);
-            ring.sceneNodeNY->yaw(Ogre::Radian(ring.fYaw), Ogre::Node::TS_WORLD);
-            ring.sceneNodeNY->roll(Ogre::Radian(ring.fRoll), Ogre::Node::TS_WORLD);
+            shadergen->createShaderBasedTechnique(*material, Ogre::MaterialManager::DEFAULT_SCHEME_NAME, Ogre::RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME);
+            shadergen->validateMaterial(Ogre::RTShader::ShaderGenerator::DEFAULT_SCHEME_NAME, *material);
+        }
+        material->load();
+    }
 
+    //rings have their own programs in Media/materials/programs, a quad seen from both sides
+    if (meshType == MeshType::NORMAL_BIOMES)
+    {
+        materialRingAmbient = Ogre::MaterialManager::getSingleton().create(strName + "RingAmbientMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+        materialRingSunlight = Ogre::MaterialManager::getSingleton().create(strName + "RingSunlightMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+        for (auto& material : { materialRingAmbient, materialRingSunlight })
+        {
+            Ogre::Pass* pass = material->getTechnique(0)->getPass(0);
+            pass->setCullingMode(Ogre::CULL_NONE);
+            pass->setVertexProgram("ProcTerra/RingVP");
+            pass->setFragmentProgram("ProcTerra/RingFP");
+            const Ogre::GpuProgramParametersSharedPtr& params = pass->getFragmentProgramParameters();
+            params->setNamedConstant("lighting", material == materialRingSunlight ? 1.f : 0.f);
+            params->setNamedConstant("bandStrength", RingBandStrength);
+            params->setNamedConstant("bandFrequency", RingBandFrequency);
+            material->load();
         }
     }
+}
 
+void Planet::setLightType(const LightType lightType)
+{
+    this->lightType = lightType;
 
-    //generate mesh with noise for first time, also update rings
-    generate();
+    //not initialised yet, init() picks the material
+    if (!materialAmbient)
+        return;
 
+    for (auto entity : vecFaceEntities)
+        entity->setMaterial(getMaterial());
+    if (entityRings != nullptr)
+        entityRings->setMaterial(getRingMaterial());
+    ringDebris.setLightType(lightType == LightType::DIRECTIONAL);
 }
 
-
 void Planet::generate()
 {
+    TRACE_SCOPE("Planet::generate");
+    nGenerateCount++;
+    auto timeStart = std::chrono::steady_clock::now();
+    generateTimings = GenerateTimings();
+    //a store still running reads the face buffers about to be rebuilt
+    waitMeshCacheStore();
+    timeGenerated = timeStart;
+
     //update noise object with values from gui
     setValuesToNoiseObject();
 
-    //update each face mesh by applying noise algo into each of thier vertices at world position
-    updateMesh(vecFaces[0].get(), Ogre::Vector3::UNIT_Y);
-    updateMesh(vecFaces[1].get(), Ogre::Vector3::UNIT_X);
-    updateMesh(vecFaces[2].get(), Ogre::Vector3::UNIT_Z);
-    updateMesh(vecFaces[3].get(), Ogre::Vector3::NEGATIVE_UNIT_Y);
-    updateMesh(vecFaces[4].get(), Ogre::Vector3::NEGATIVE_UNIT_X);
-    updateMesh(vecFaces[5].get(), Ogre::Vector3::NEGATIVE_UNIT_Z);
+    //faces generated before with exactly these values come straight from the mesh cache
+    //they are uploaded from the mapping and only copied to the face buffers afterwards
+    uint64_t meshHash = getMeshHash();
+    PlanetFile cacheFile;
+    CachedFace cachedFaces[6];
+    generateTimings.bMeshCache = bMeshCache && readMeshCache(meshHash, cacheFile, cachedFaces);
+    if (!generateTimings.bMeshCache)
+    {
+        //update each face by applying noise algo into each of thier vertices at world position
+        //or with the elevation baked into planet.bin the first time, which was generated from these same values
+        //faces only read the planet and write their own buffers so the result doesnt depend on how many are built at once
+        //the workers are kept from the last generate() unless the thread count changed
+        size_t nThreads = std::clamp<size_t>(nGenerateThreads ? nGenerateThreads : std::thread::hardware_concurrency(), 1, 6);
+        startGenerateWorkers(nThreads - 1);
+        for (auto& timings : faceTimings)
+            timings = GenerateTimings();
+        nNextFace = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutexGenerate);
+            nGenerateJob++;
+            nWorkersBusy = vecGenerateWorkers.size();
+        }
+        cvGenerateStart.notify_all();
+        buildFaces();
+        {
+            std::unique_lock<std::mutex> lock(mutexGenerate);
+            cvGenerateDone.wait(lock, [this]() { return nWorkersBusy == 0; });
+        }
+        for (const auto& timings : faceTimings)
+        {
+            generateTimings.fNormalsMs += timings.fNormalsMs;
+            generateTimings.fNoiseMs += timings.fNoiseMs;
+            generateTimings.fDisplacementMs += timings.fDisplacementMs;
+            generateTimings.fColouringMs += timings.fColouringMs;
+        }
+        //written by update() once the values have settled or storeMeshCache() on exit, not on every regenerate
+        meshCacheHash = meshHash;
+    }
+    else
+        meshCacheHash = 0;
+    elevationHash = getElevationHash();
+    //any later generate() comes from changed values
+    pBakedElevation = nullptr;
+    planetFile.close();
+    auto timeFaces = std::chrono::steady_clock::now();
+    generateTimings.fFacesMs = getMs(timeStart, timeFaces);
+
+    //headless planets have nothing to upload
+    if (mSceneMgr == nullptr)
+    {
+        if (generateTimings.bMeshCache)
+            copyCachedFaces(cachedFaces);
+        generateTimings.fFacesMs = getMs(timeStart, std::chrono::steady_clock::now());
+        generateTimings.fTotalMs = generateTimings.fFacesMs;
+        return;
+    }
 
-    //gradient planets dont have rings
-    if (meshType == MeshType::NORMAL_BIOMES)
+    for (size_t i = 0; i < vecFaces.size(); i++)
     {
-        for (auto& ring : vecRings)
+        if (generateTimings.bMeshCache)
+            uploadMesh(vecFaces[i].get(), cachedFaces[i].pVertices, cachedFaces[i].pColours, nVertices, cachedFaces[i].box);
+        else
+            uploadMesh(vecFaces[i].get(), vecFaceBuffers[i]);
+    }
+    auto timeUpload = std::chrono::steady_clock::now();
+    generateTimings.fUploadMs = getMs(timeFaces, timeUpload);
+
+    //the lod distances, stats, exporters and planet.bin still read the faces from the cpu side
+    if (generateTimings.bMeshCache)
+    {
+        copyCachedFaces(cachedFaces);
+        cacheFile.close();
+        auto timeCopy = std::chrono::steady_clock::now();
+        generateTimings.fFacesMs += getMs(timeUpload, timeCopy);
+        timeUpload = timeCopy;
+    }
+
+    //lod index buffers only depend on the grid, but how far each level holds up depends on the new vertices
+    if (bAutoLodGeneration)
+        updateLodDistances();
+    auto timeLod = std::chrono::steady_clock::now();
+    generateTimings.fLodMs = getMs(timeUpload, timeLod);
+
+    //gradient planets dont have rings, the ring quads only change with the rings or the planet size and not with the noise
+    if (mshRings && getRingsHash() != ringsHash)
+    {
+        buildRings();
+        auto timeRingUpload = std::chrono::steady_clock::now();
+        uploadRings();
+        generateTimings.fRingsMs = getMs(timeLod, timeRingUpload);
+        generateTimings.fUploadMs += getMs(timeRingUpload, std::chrono::steady_clock::now());
+    }
+    //the debris also changes with the seed, its build and upload both count as rings
+    auto timeDebris = std::chrono::steady_clock::now();
+    updateRingDebris();
+    generateTimings.fRingsMs += getMs(timeDebris, std::chrono::steady_clock::now());
+    generateTimings.fTotalMs = getMs(timeStart, std::chrono::steady_clock::now());
+}
+
+void Planet::buildFaces()
+{
+    //every thread has its own copy of the noise since FastNoiseLite isnt const
+    static const Ogre::Vector3 faces[6] = {
+        Ogre::Vector3::UNIT_Y, Ogre::Vector3::UNIT_X, Ogre::Vector3::UNIT_Z,
+        Ogre::Vector3::NEGATIVE_UNIT_Y, Ogre::Vector3::NEGATIVE_UNIT_X, Ogre::Vector3::NEGATIVE_UNIT_Z };
+    FastNoiseLite noise = this->noise, domainWarp = this->domainWarp;
+    for (size_t i = nNextFace++; i < 6; i = nNextFace++)
+        buildFace(vecFaceBuffers[i], faces[i], nSections, noise, bDomainWarp ? &domainWarp : nullptr, pBakedElevation ? pBakedElevation + i * nVertices : nullptr, &faceTimings[i]);
+}
+
+void Planet::startGenerateWorkers(const size_t nWorkers)
+{
+    if (vecGenerateWorkers.size() == nWorkers)
+        return;
+    stopGenerateWorkers();
+    bStopWorkers = false;
+    //started with the current job so they wait for the next one
+    for (size_t t = 0; t < nWorkers; t++)
+        vecGenerateWorkers.emplace_back(&Planet::runGenerateWorker, this, nGenerateJob);
+}
+
+void Planet::stopGenerateWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexGenerate);
+        bStopWorkers = true;
+    }
+    cvGenerateStart.notify_all();
+    for (auto& thread : vecGenerateWorkers)
+        thread.join();
+    vecGenerateWorkers.clear();
+}
+
+void Planet::runGenerateWorker(uint64_t nJob)
+{
+    TRACE_THREAD_NAME("generate worker");
+    std::unique_lock<std::mutex> lock(mutexGenerate);
+    while (true)
+    {
+        cvGenerateStart.wait(lock, [this, nJob]() { return bStopWorkers || nGenerateJob != nJob; });
+        if (bStopWorkers)
+            return;
+        nJob = nGenerateJob;
+        lock.unlock();
+        buildFaces();
+        lock.lock();
+        if (--nWorkersBusy == 0)
+            cvGenerateDone.notify_one();
+    }
+}
+
+PlanetMemory Planet::getMemoryUsage() const
+{
+    PlanetMemory memory = {};
+    memory.nGridBytes = vecVertices.capacity() * sizeof(Ogre::Vector3) + vecIndices.capacity() * sizeof(unsigned short);
+    memory.nRingGridBytes = vecRingVertices.capacity() * sizeof(Ogre::Vector3) + vecRingIndices.capacity() * sizeof(unsigned short);
+    for (const auto& face : vecFaceBuffers)
+        memory.nFaceBufferBytes += face.vecVertices.capacity() * sizeof(float) + face.vecColours.capacity() * sizeof(Ogre::RGBA) + face.vecElevations.capacity() * sizeof(float);
+    memory.nRingBufferBytes = scratchBuffers.vecVertices.capacity() * sizeof(float) + scratchBuffers.vecColours.capacity() * sizeof(Ogre::RGBA) + scratchBuffers.vecElevations.capacity() * sizeof(float) +
+        vecRingBatchIndices.capacity() * sizeof(unsigned short);
+    memory.nLodBytes = lodBuilder.getMemoryBytes();
+    memory.nRingDebrisBytes = ringDebris.getCpuBytes();
+
+    //what init() would create, 6 floats and a colour per vertex and 16 bit indices
+    memory.bGpuEstimated = vecFaces.empty();
+    if (memory.bGpuEstimated)
+    {
+        memory.nGpuFaceVertexBytes = 6 * nVertices * (6 * sizeof(float) + sizeof(Ogre::RGBA));
+        memory.nGpuFaceIndexBytes = 6 * iBufCount * sizeof(unsigned short);
+        if (meshType == MeshType::NORMAL_BIOMES)
+        {
+            //all rings visible
+            memory.nGpuRingVertexBytes = vecRings.size() * 4 * (RingVertexFloats * sizeof(float) + sizeof(Ogre::RGBA));
+            memory.nGpuRingIndexBytes = vecRings.size() * 6 * sizeof(unsigned short);
+            if (bRingDebris)
+                memory.nGpuRingDebrisBytes = memory.nRingDebrisBytes = vecRings.size() * nRingDebris * sizeof(RingDebrisInstance);
+        }
+        if (bAutoLodGeneration)
+        {
+            GridLodBuilder builder;
+            builder.build(nSections, bLodStitchEdges);
+            for (size_t level = 1; level <= builder.getNumLevels(); level++)
+                memory.nGpuLodIndexBytes += builder.getIndices(level).size() * sizeof(unsigned short);
+        }
+        return memory;
+    }
+
+    //pooled buffers can be larger than the current resolution needs
+    auto getMeshBytes = [](const Ogre::MeshPtr& mesh, size_t& nVertexBytes, size_t& nIndexBytes)
+    {
+        if (!mesh)
+            return;
+        for (const auto& binding : mesh->sharedVertexData->vertexBufferBinding->getBindings())
+            nVertexBytes += binding.second->getSizeInBytes();
+        if (mesh->getSubMesh(0)->indexData->indexBuffer)
+            nIndexBytes += mesh->getSubMesh(0)->indexData->indexBuffer->getSizeInBytes();
+    };
+    for (const auto& face : vecFaces)
+        getMeshBytes(face, memory.nGpuFaceVertexBytes, memory.nGpuFaceIndexBytes);
+    getMeshBytes(mshRings, memory.nGpuRingVertexBytes, memory.nGpuRingIndexBytes);
+    for (const auto& ibuf : vecLodIndexBuffers)
+        memory.nGpuLodIndexBytes += ibuf->getSizeInBytes();
+    memory.nGpuRingDebrisBytes = ringDebris.getGpuBytes();
+    return memory;
+}
+
+void Planet::setAutoLodGeneration(const bool bAutoLodGeneration)
+{
+    this->bAutoLodGeneration = bAutoLodGeneration;
+    if (bAutoLodGeneration)
+    {
+        createLodLevels();
+        updateLodDistances();
+    }
+    else
+        removeLodLevels();
+}
+
+void Planet::setLodStitchEdges(const bool bLodStitchEdges)
+{
+    this->bLodStitchEdges = bLodStitchEdges;
+    if (bAutoLodGeneration)
+        setAutoLodGeneration(true);
+}
+
+void Planet::setResolution(const size_t nSections, const int iDiaMultiplier)
+{
+    this->nSections = std::clamp(nSections, MinSections, MaxSections);
+    this->iDiaMultiplier = std::clamp(iDiaMultiplier, MinDiaMultiplier, MaxDiaMultiplier);
+    //the new resolution resizes the face buffers a store may still be reading
+    waitMeshCacheStore();
+    initMeshValues();
+    createDefaultFaceVerticesAndIndices();
+    reserveBuffers();
+
+    //same meshes, entities and nodes, only the buffer contents change
+    fillFaceBuffers(vecFaces[0].get(), Ogre::Vector3::UNIT_Y);
+    fillFaceBuffers(vecFaces[1].get(), Ogre::Vector3::UNIT_X);
+    fillFaceBuffers(vecFaces[2].get(), Ogre::Vector3::UNIT_Z);
+    fillFaceBuffers(vecFaces[3].get(), Ogre::Vector3::NEGATIVE_UNIT_Y);
+    fillFaceBuffers(vecFaces[4].get(), Ogre::Vector3::NEGATIVE_UNIT_X);
+    fillFaceBuffers(vecFaces[5].get(), Ogre::Vector3::NEGATIVE_UNIT_Z);
+
+    //lod levels index the old grid
+    if (bAutoLodGeneration)
+        createLodLevels();
+
+    generate();
+}
+
+void Planet::createLodLevels()
+{
+    TRACE_SCOPE("Planet::createLodLevels");
+    removeLodLevels();
+    lodBuilder.build(nSections, bLodStitchEdges);
+
+    //one index buffer per level, shared by all faces. the vertex buffers stay as they are
+    vecLodIndexBuffers.clear();
+    for (size_t level = 1; level <= lodBuilder.getNumLevels(); level++)
+    {
+        const std::vector<unsigned short>& vecLevelIndices = lodBuilder.getIndices(level);
+        Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
+            createIndexBuffer(
+                Ogre::HardwareIndexBuffer::IT_16BIT,
+                vecLevelIndices.size(),
+                Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+        ibuf->writeData(0, ibuf->getSizeInBytes(), static_cast<const void*>(vecLevelIndices.data()), true);
+        vecLodIndexBuffers.emplace_back(ibuf);
+    }
+
+    for (auto& face : vecFaces)
+    {
+        face->_setLodInfo(static_cast<unsigned short>(vecLodIndexBuffers.size() + 1));
+        for (unsigned short level = 1; level <= vecLodIndexBuffers.size(); level++)
+        {
+            //owned and deleted by the submesh
+            Ogre::IndexData* indexData = OGRE_NEW Ogre::IndexData();
+            indexData->indexBuffer = vecLodIndexBuffers[level - 1];
+            indexData->indexStart = 0;
+            indexData->indexCount = vecLodIndexBuffers[level - 1]->getNumIndexes();
+            face->_setSubMeshLodFaceList(0, level, indexData);
+        }
+    }
+}
+
+void Planet::updateLodDistances()
+{
+    TRACE_SCOPE("Planet::updateLodDistances");
+    for (size_t i = 0; i < vecFaces.size(); i++)
+    {
+        if (vecFaceBuffers[i].vecVertices.empty())
+            continue;
+
+        //each level is used from the distance where its error shrinks to about a pixel
+        Ogre::Mesh* face = vecFaces[i].get();
+        float fDistance = 0.f;
+        for (unsigned short level = 1; level < face->getNumLodLevels(); level++)
         {
-            updateRing(ring.mshY.get(), Ogre::Vector3::UNIT_Y, ring.fOuterRingDia, ring.fInnerThickness, ring.colorInner, ring.colorOuter);
-            updateRing(ring.mshNY.get(), Ogre::Vector3::NEGATIVE_UNIT_Y, ring.fOuterRingDia, ring.fInnerThickness, ring.colorInner, ring.colorOuter);
+            float fError = lodBuilder.computeError(level, vecFaceBuffers[i].vecVertices.data(), 6);
+            //distances have to increase with the level
+            fDistance = std::max(fError * LodDistancePerUnitError, fDistance + 1.f);
+
+            Ogre::MeshLodUsage usage;
+            usage.userValue = fDistance;
+            usage.value = face->getLodStrategy()->transformUserValue(fDistance);
+            usage.edgeData = nullptr;
+            face->_setLodUsage(level, usage);
         }
     }
 }
 
+void Planet::removeLodLevels()
+{
+    for (auto& face : vecFaces)
+        face->removeLodLevels();
+    vecLodIndexBuffers.clear();
+    lodBuilder.clear();
+}
 
 
 
-void Planet::updateMesh(const Ogre::Mesh* const mesh, const Ogre::Vector3 vFace)
+void Planet::buildFace(FaceBuffers& face, const Ogre::Vector3 vFace, const size_t nSections, FastNoiseLite& noise, FastNoiseLite* pDomainWarp, const float* pBakedElevation, GenerateTimings* pTimings) const
 {
+    TRACE_SCOPE("Planet::buildFace");
     //how planet generation will work -
     // create a new sphere using the default mesh plane values createDefaultFaceVerticesAndIndices() 6 times just the way it was created in init()
     // only difference is the values for vertices once they are rotated to thier appropriate face position, and then normalized to form a sphere,
     // are then sent to the noise generation algo to create peaks and valleys for the planet where the vertex will set its distance from center according to its range
     // the world position values for the mesh are retrieved when the mesh can be recreated into its default sphere coordinates, to form a planet with peaks and valleys, fresh from the ground up
-    //default for Ogre::Vector3::NEGATIVE_UNIT_Y
-    Ogre::Quaternion vertexRot(Ogre::Degree(0), Ogre::Vector3::UNIT_X);
-    //rotate the plane so it may face the correct direction according to its face
-    if (vFace == Ogre::Vector3::UNIT_Y)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(180), Ogre::Vector3::UNIT_X);     //pitch 180
-    else if (vFace == Ogre::Vector3::UNIT_X)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(90), Ogre::Vector3::UNIT_Z);     //roll 90
-    else if (vFace == Ogre::Vector3::UNIT_Z)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(-90), Ogre::Vector3::UNIT_X);     //pitch 90
-    else if (vFace == Ogre::Vector3::NEGATIVE_UNIT_X)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(-90), Ogre::Vector3::UNIT_Z);     //roll 90
-    else if (vFace == Ogre::Vector3::NEGATIVE_UNIT_Z)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(90), Ogre::Vector3::UNIT_X);     //pitch 90
-
-    bool added_shared = false;
-    size_t current_offset = 0;
-    size_t shared_offset = 0;
-    size_t next_offset = 0;
-    size_t index_offset = 0;
+    //each stage is its own pass over the face so it can be timed without a clock read per vertex
+    auto timeStart = std::chrono::steady_clock::now();
+    Ogre::Quaternion vertexRot = getFaceRotation(vFace);
+
+    //same grid as createDefaultFaceVerticesAndIndices() but for any number of sections, border vertices land exactly on the cube edge
+    size_t nSegments = nSections + 1;
+    size_t nVertices = nSegments * nSegments;
+    face.vecVertices.resize(nVertices * 6);
+    face.vecColours.resize(nVertices);
+    face.vecElevations.resize(nVertices);
+    face.box.setNull();
+
+    //NORMALS
+    //the vertex on the unit sphere, normals stay the ones of the sphere and the position is moved along it
+    Ogre::Vector3 v;
+    for (size_t j = 0; j < nVertices; ++j)
+    {
+        float x = static_cast<float>(j % nSegments) / static_cast<float>(nSections) * 2.f - 1.f;
+        float z = static_cast<float>(j / nSegments) / static_cast<float>(nSections) * 2.f - 1.f;
+        v = vertexRot * Ogre::Vector3(x, -1.f, z);
+        v.normalise();
+        float* pNormal = &face.vecVertices[j * 6 + 3];
+        pNormal[0] = v.x;
+        pNormal[1] = v.y;
+        pNormal[2] = v.z;
+    }
+    auto timeNormals = std::chrono::steady_clock::now();
 
-    int vertex_count = 0, index_count = 0;
-    Ogre::SubMesh* submesh = mesh->getSubMesh(0);
-    // We only need to add the shared vertices once
-    if (submesh->useSharedVertices)
+    //NOISE
+    float fRadius = fSideLength / 2.f;
+    if (pBakedElevation)
+        std::memcpy(face.vecElevations.data(), pBakedElevation, nVertices * sizeof(float));
+    else
     {
-        if (!added_shared)
+        for (size_t j = 0; j < nVertices; ++j)
         {
-            vertex_count += mesh->sharedVertexData->vertexCount;
-            added_shared = true;
+            const float* pNormal = &face.vecVertices[j * 6 + 3];
+            face.vecElevations[j] = sampleElevation(noise, pDomainWarp, Ogre::Vector3(pNormal[0] * fRadius, pNormal[1] * fRadius, pNormal[2] * fRadius));
         }
     }
-    else
+    auto timeNoise = std::chrono::steady_clock::now();
+
+    //DISPLACEMENT
+    float fNoiseDist = fPerFrequencyHeight * fRadius;
+    float eMinDepth = getMinDepth();
+    float fMinBiomeDistFromCenter = fRadius + fNoiseDist * eMinDepth;
+    for (size_t j = 0; j < nVertices; ++j)
     {
-        vertex_count += submesh->vertexData->vertexCount;
+        float e = face.vecElevations[j];
+        float fDistFromCenter = e < eMinDepth ? fMinBiomeDistFromCenter : fRadius + e * fNoiseDist;
+        float* pVertex = &face.vecVertices[j * 6];
+        pVertex[0] = pVertex[3] * fDistFromCenter;
+        pVertex[1] = pVertex[4] * fDistFromCenter;
+        pVertex[2] = pVertex[5] * fDistFromCenter;
+        face.box.merge(Ogre::Vector3(pVertex[0], pVertex[1], pVertex[2]));
     }
-    // Add the indices
-    index_count += submesh->indexData->indexCount;
+    auto timeDisplacement = std::chrono::steady_clock::now();
 
-    // Allocate space for the vertices and indices
-    auto vertices = new Ogre::Vector3[vertex_count];
-    auto indices = new unsigned long[index_count];
-    added_shared = false;
+    //COLOUR
+    for (size_t j = 0; j < nVertices; ++j)
+        face.vecColours[j] = getColour(face.vecElevations[j]).getAsBYTE();
 
-    Ogre::VertexData* vertex_data = submesh->useSharedVertices ? mesh->sharedVertexData : submesh->vertexData;
-    Ogre::VertexData* color_data = vertex_data;
-    if ((!submesh->useSharedVertices) || (submesh->useSharedVertices && !added_shared))
+    if (pTimings)
     {
-        if (submesh->useSharedVertices)
-        {
-            added_shared = true;
-            shared_offset = current_offset;
-        }
+        pTimings->fNormalsMs += getMs(timeStart, timeNormals);
+        pTimings->fNoiseMs += getMs(timeNormals, timeNoise);
+        pTimings->fDisplacementMs += getMs(timeNoise, timeDisplacement);
+        pTimings->fColouringMs += getMs(timeDisplacement, std::chrono::steady_clock::now());
+    }
+}
 
-        //vertex position
-        float* pVertexPosition;
-        Ogre::Vector3 v, vMesh;
-        const Ogre::VertexElement* posElem = vertex_data->vertexDeclaration->findElementBySemantic(Ogre::VES_POSITION);
-        Ogre::HardwareVertexBufferSharedPtr vbufPos = vertex_data->vertexBufferBinding->getBuffer(posElem->getSource());
-        unsigned char* vertex = static_cast<unsigned char*>(vbufPos->lock(Ogre::HardwareBuffer::HBL_WRITE_ONLY));
-
-        //diffuse
-        Ogre::RGBA* pColorValue;
-        const Ogre::VertexElement* colorElem = color_data->vertexDeclaration->findElementBySemantic(Ogre::VES_COLOUR);
-        Ogre::HardwareVertexBufferSharedPtr vbufColor = color_data->vertexBufferBinding->getBuffer(colorElem->getSource());
-        unsigned char* color = static_cast<unsigned char*>(vbufColor->lock(Ogre::HardwareBuffer::HBL_WRITE_ONLY));
-
-        //update mesh
-        float e = 0.f;
-        float fDistFromCenter = fSideLength / 2.f;
-        float fNoiseDist = fPerFrequencyHeight * fDistFromCenter;
-        float eMinDepth = -1.f;
-        if (meshType == MeshType::NORMAL_BIOMES)
-            eMinDepth = indexMinBiomeDepth ? vecBiomes[indexMinBiomeDepth - 1].e : -1.0f;
-        else if (meshType == MeshType::GRADIENT && bRenderElevation == false)
-            eMinDepth = 1.f;
-        float fMinBiomeDistFromCenter = fDistFromCenter + fNoiseDist * eMinDepth;
-        for (size_t j = 0; j < vertex_data->vertexCount; ++j, vertex += vbufPos->getVertexSize(), color += vbufColor->getVertexSize())
+Ogre::ColourValue Planet::getColour(const float e) const
+{
+    if (meshType == MeshType::NORMAL_BIOMES)
+    {
+        //set the color according the the biome, for primary planet only
+        for (auto iter = vecBiomes.begin(); iter != vecBiomes.end(); iter++)
         {
-            //VERTEX
-             //gets the pointer to the vertex !!!!
-            posElem->baseVertexPointerToElement(vertex, &pVertexPosition);
-
-            v = vertexRot * vecVertices[j];
-            v.normalise();
-            vMesh = Ogre::Vector3(v.x * fDistFromCenter, v.y * fDistFromCenter, v.z * fDistFromCenter);
-            if (bDomainWarp)
-                domainWarp.DomainWarp(vMesh.x, vMesh.y, vMesh.z);
-            e = (noise.GetNoise(vMesh.x, vMesh.y, vMesh.z) +
-                0.5f * noise.GetNoise(2.0f * vMesh.x, 2.0f * vMesh.y, 2.0f * vMesh.z) +
-                0.25f * noise.GetNoise(4.0f * vMesh.x, 4.0f * vMesh.y, 4.f * vMesh.z)) / 1.75f;
-            //clamp 
-            e = std::clamp(e, -1.f, 1.f);
-
-            //now set the position after applying e
-            if (e < eMinDepth)
-                fDistFromCenter = fMinBiomeDistFromCenter;
-            else
-                fDistFromCenter = fDistFromCenter + e * fNoiseDist;
-            pVertexPosition[0] = v.x * fDistFromCenter;
-            pVertexPosition[1] = v.y * fDistFromCenter;
-            pVertexPosition[2] = v.z * fDistFromCenter;
-            fDistFromCenter = fSideLength / 2.f;
-
-            //COLOUR
-            //now pointer to the color value
-            colorElem->baseVertexPointerToElement(color, &pColorValue);
-            if (meshType == MeshType::NORMAL_BIOMES)
-            {
-                //set the color according the the biome, for primary planet only
-                for (auto iter = vecBiomes.begin(); iter != vecBiomes.end(); iter++)
-                {
-                    if (e < iter->e)
-                    {
-                        if (iter != vecBiomes.begin() && iter + 1 != vecBiomes.end() && interpolationType != InterpolationType::Sharp)
-                            *pColorValue = biomeColorInterpolation(e, iter).getAsBYTE();
-                        else
-                            *pColorValue = iter->color.getAsBYTE();
-                        break;
-                    }
-                }
-            }
-            else
+            if (e < iter->e)
             {
-                //black n white for gradient
-                *pColorValue = Ogre::ColourValue(0.5f + e * 0.5f, 0.5f + e * 0.5f, 0.5f + e * 0.5f).getAsBYTE();
+                if (iter != vecBiomes.begin() && iter + 1 != vecBiomes.end() && interpolationType != InterpolationType::Sharp)
+                    return biomeColorInterpolation(e, iter);
+                return iter->color;
             }
         }
-
-        vbufPos->unlock();
-        vbufColor->unlock();
+        //above the top biome
+        return vecBiomes.empty() ? Ogre::ColourValue::White : vecBiomes.back().color;
     }
 
-    delete vertices;
-    delete indices;
+    //black n white for gradient
+    return Ogre::ColourValue(0.5f + e * 0.5f, 0.5f + e * 0.5f, 0.5f + e * 0.5f);
+}
+
+float Planet::getMinDepth() const
+{
+    if (meshType == MeshType::NORMAL_BIOMES)
+        return indexMinBiomeDepth ? vecBiomes[indexMinBiomeDepth - 1].e : -1.0f;
+    else if (meshType == MeshType::GRADIENT && bRenderElevation == false)
+        return 1.f;
+    return -1.f;
+}
+
+Ogre::Quaternion Planet::getFaceRotation(const Ogre::Vector3 vFace)
+{
+    //default for Ogre::Vector3::NEGATIVE_UNIT_Y
+    Ogre::Quaternion vertexRot(Ogre::Degree(0), Ogre::Vector3::UNIT_X);
+    //rotate the plane so it may face the correct direction according to its face
+    if (vFace == Ogre::Vector3::UNIT_Y)
+        vertexRot = Ogre::Quaternion(Ogre::Degree(180), Ogre::Vector3::UNIT_X);     //pitch 180
+    else if (vFace == Ogre::Vector3::UNIT_X)
+        vertexRot = Ogre::Quaternion(Ogre::Degree(90), Ogre::Vector3::UNIT_Z);     //roll 90
+    else if (vFace == Ogre::Vector3::UNIT_Z)
+        vertexRot = Ogre::Quaternion(Ogre::Degree(-90), Ogre::Vector3::UNIT_X);     //pitch 90
+    else if (vFace == Ogre::Vector3::NEGATIVE_UNIT_X)
+        vertexRot = Ogre::Quaternion(Ogre::Degree(-90), Ogre::Vector3::UNIT_Z);     //roll 90
+    else if (vFace == Ogre::Vector3::NEGATIVE_UNIT_Z)
+        vertexRot = Ogre::Quaternion(Ogre::Degree(90), Ogre::Vector3::UNIT_X);     //pitch 90
+    return vertexRot;
+}
+
+float Planet::sampleElevation(FastNoiseLite& noise, FastNoiseLite* pDomainWarp, Ogre::Vector3 vPosition)
+{
+    if (pDomainWarp)
+        pDomainWarp->DomainWarp(vPosition.x, vPosition.y, vPosition.z);
+    float e = (noise.GetNoise(vPosition.x, vPosition.y, vPosition.z) +
+        0.5f * noise.GetNoise(2.0f * vPosition.x, 2.0f * vPosition.y, 2.0f * vPosition.z) +
+        0.25f * noise.GetNoise(4.0f * vPosition.x, 4.0f * vPosition.y, 4.f * vPosition.z)) / 1.75f;
+    //clamp 
+    return std::clamp(e, -1.f, 1.f);
+}
+
+void Planet::uploadMesh(Ogre::Mesh* const mesh, const FaceBuffers& buffers)
+{
+    TRACE_SCOPE("Planet::uploadMesh");
+    uploadMesh(mesh, buffers.vecVertices.data(), buffers.vecColours.data(), buffers.vecColours.size(), buffers.box);
+}
+
+void Planet::uploadMesh(Ogre::Mesh* const mesh, const float* pVertices, const Ogre::RGBA* pColours, const size_t nVertexCount, const Ogre::AxisAlignedBox& box)
+{
+    nUploadCount++;
+    /// Upload the vertex data to the card, both buffers are replaced completely
+    Ogre::VertexBufferBinding* bind = mesh->sharedVertexData->vertexBufferBinding;
+    bind->getBuffer(0)->writeData(0, nVertexCount * 6 * sizeof(float), pVertices, true);
+    bind->getBuffer(1)->writeData(0, nVertexCount * sizeof(Ogre::RGBA), pColours, true);
+
+    //tight bounds so the lod distance is measured to the face itself and not the whole planet
+    mesh->_setBounds(box);
+    mesh->_setBoundingSphereRadius(std::max(box.getMinimum().length(), box.getMaximum().length()));
+}
+
+Ogre::Quaternion Planet::getRingOrientation(const Ring& ring)
+{
+    //pitch, yaw then roll in world space
+    return Ogre::Quaternion(Ogre::Radian(ring.fRoll), Ogre::Vector3::UNIT_Z) *
+        Ogre::Quaternion(Ogre::Radian(ring.fYaw), Ogre::Vector3::UNIT_Y) *
+        Ogre::Quaternion(Ogre::Radian(ring.fPitch), Ogre::Vector3::UNIT_X);
 }
 
-Ogre::ColourValue Planet::biomeColorInterpolation(const float& e, std::vector<Biome>::iterator& iter)
+Ogre::ColourValue Planet::biomeColorInterpolation(const float& e, std::vector<Biome>::const_iterator& iter) const
 {
     float eBiome = iter->e;
     Ogre::ColourValue colorBiome = iter->color;
@@ -307,59 +734,13 @@ Ogre::ColourValue Planet::biomeColorInterpolation(const float& e, std::vector<Bi
 
 Ogre::MeshPtr Planet::createNormalisedFace(const Ogre::Vector3 vFace, const std::string strItem, const std::string strEntity)
 {
-    //default for Ogre::Vector3::NEGATIVE_UNIT_Y
-    Ogre::Quaternion vertexRot(Ogre::Degree(0), Ogre::Vector3::UNIT_X);
-
-    //rotate the plane so it may face the correct direction according to its face
-    if (vFace == Ogre::Vector3::UNIT_Y)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(180), Ogre::Vector3::UNIT_X);     //pitch 180
-    else if (vFace == Ogre::Vector3::UNIT_X)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(90), Ogre::Vector3::UNIT_Z);     //roll 90
-    else if (vFace == Ogre::Vector3::UNIT_Z)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(-90), Ogre::Vector3::UNIT_X);     //pitch 90
-    else if (vFace == Ogre::Vector3::NEGATIVE_UNIT_X)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(-90), Ogre::Vector3::UNIT_Z);     //roll 90
-    else if (vFace == Ogre::Vector3::NEGATIVE_UNIT_Z)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(90), Ogre::Vector3::UNIT_X);     //pitch 90
-
-
     /// Create the mesh via the MeshManager
     Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual(strItem, "General");
     /// Create one submesh
     Ogre::SubMesh* sub = msh->createSubMesh();
 
-    //v buffer
-    std::vector<float> vertices;
-    vertices.reserve(vBufCount);
-    //convert the plane coordinates to sphere right now during mesh initialization
-    //apply rotation to each vertex according to the direction of the face
-    //index order for mesh triangles dont change
-    //https://forums.ogre3d.org/viewtopic.php?t=77080
-    float fDistFromCenter = fSideLength / 2.f;
-    Ogre::Vector3 vertex;
-    for (auto defVertex : vecVertices)
-    {
-        vertex = vertexRot * defVertex;
-        vertex.normalise();
-        vertices.emplace_back(vertex.x * fDistFromCenter);
-        vertices.emplace_back(vertex.y * fDistFromCenter);
-        vertices.emplace_back(vertex.z * fDistFromCenter);
-
-        //normals
-        vertices.emplace_back(vertex.x);
-        vertices.emplace_back(vertex.y);
-        vertices.emplace_back(vertex.z);
-    }
-
-    // convert to RGBA
-    std::vector<Ogre::RGBA> colours;
-    colours.reserve(nVertices);
-    for (int i = 0; i < nVertices; i++)
-        colours[i] = Ogre::ColourValue(1.0, 0.0, 0.0).getAsBYTE(); //0 colour
-
     /// Create vertex data structure for 8 vertices shared between submeshes
     msh->sharedVertexData = new Ogre::VertexData();
-    msh->sharedVertexData->vertexCount = nVertices;
 
     /// Create declaration (memory format) of vertex data
     Ogre::VertexDeclaration* decl = msh->sharedVertexData->vertexDeclaration;
@@ -369,301 +750,360 @@ Ogre::MeshPtr Planet::createNormalisedFace(const Ogre::Vector3 vFace, const std:
     offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
     decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
     offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf =
-        Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-            offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), static_cast<void*>(vertices.data()), true);
-
-    /// Set vertex buffer binding so buffer 0 is bound to our vertex buffer
-    Ogre::VertexBufferBinding* bind = msh->sharedVertexData->vertexBufferBinding;
-    bind->setBinding(0, vbuf);
 
     // 2nd buffer   VET_UBYTE4_NORM
     offset = 0;
     decl->addElement(1, offset, Ogre::VET_UBYTE4_NORM, Ogre::VES_COLOUR);
     offset += Ogre::VertexElement::getTypeSize(Ogre::VET_UBYTE4_NORM);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-        offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), static_cast<void*>(colours.data()), true);
-
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    bind->setBinding(1, vbuf);
-
-    /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
-        createIndexBuffer(
-            Ogre::HardwareIndexBuffer::IT_16BIT,
-            iBufCount,
-            Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), static_cast<void*>(vecIndices.data()), true);
 
     /// Set parameters of the submesh
     sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = iBufCount;
     sub->indexData->indexStart = 0;
 
-    /// Set bounding information (for culling)
-    msh->_setBounds(Ogre::AxisAlignedBox(-fSideLength, -fSideLength, -fSideLength, fSideLength, fSideLength, fSideLength));
-    msh->_setBoundingSphereRadius(Ogre::Math::Sqrt(3 * fSideLength * fSideLength));
+    /// Allocate and upload the vertex and index buffers for the current resolution
+    fillFaceBuffers(msh.get(), vFace);
 
     /// Notify -Mesh object that it has been loaded
     msh->load();
 
     //now spawn it 
     Ogre::Entity* entity = mSceneMgr->createEntity(strEntity, strItem);
-    entity->setMaterialName(strName + "DiffuseMtr");
+    entity->setMaterial(getMaterial());
     entity->setVisibilityFlags(visibilityMask);
     Ogre::SceneNode* node = mSceneMgr->getRootSceneNode()->createChildSceneNode();
     node->attachObject(entity);
     vecFaceNodes.emplace_back(node);
-
-    //auto lod on mesh
-    if (bAutoLodGeneration)
-    {
-        if (!Ogre::MeshLodGenerator::getSingletonPtr())
-            new Ogre::MeshLodGenerator();
-        Ogre::MeshLodGenerator::getSingletonPtr()->generateAutoconfiguredLodLevels(msh);
-    }
-  
+    vecFaceEntities.emplace_back(entity);
 
     return msh;
-}
-
-
-Ogre::MeshPtr Planet::createRing(const Ogre::Vector3 vFace, Ogre::Entity** entity, Ogre::SceneNode** node, const Ogre::ColourValue colorInner, const Ogre::ColourValue colorOuter, const std::string strItem, const std::string strEntity)
-{
-    //rotate the plane so it may face the correct direction according to its face
-    //default for Ogre::Vector3::NEGATIVE_UNIT_Y
-    Ogre::Quaternion vertexRot(Ogre::Degree(0), Ogre::Vector3::UNIT_X);
-    if (vFace == Ogre::Vector3::UNIT_Y)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(180), Ogre::Vector3::UNIT_X);     //pitch 180
-
+}
 
-    /// Create the mesh via the MeshManager
-    Ogre::MeshPtr msh = Ogre::MeshManager::getSingleton().createManual(strItem, "General");
-    /// Create one submesh
-    Ogre::SubMesh* sub = msh->createSubMesh();
+void Planet::fillFaceBuffers(Ogre::Mesh* const msh, const Ogre::Vector3 vFace)
+{
+    TRACE_SCOPE("Planet::fillFaceBuffers");
+    nUploadCount++;
+    Ogre::Quaternion vertexRot = getFaceRotation(vFace);
 
-    //v buffer
-    std::vector<float> vertices;
-    vertices.reserve(vRingBufCount);
+    //the default sphere goes through the scratch buffers, generate() overwrites it right after
     //convert the plane coordinates to sphere right now during mesh initialization
     //apply rotation to each vertex according to the direction of the face
     //index order for mesh triangles dont change
     //https://forums.ogre3d.org/viewtopic.php?t=77080
+    std::vector<float>& vertices = scratchBuffers.vecVertices;
+    vertices.resize(vBufCount);
     float fDistFromCenter = fSideLength / 2.f;
     Ogre::Vector3 vertex;
-    for (auto defVertex : vecRingVertices)
+    for (size_t j = 0; j < nVertices; j++)
     {
-        vertex = vertexRot * defVertex;
+        vertex = vertexRot * vecVertices[j];
         vertex.normalise();
-        vertices.emplace_back(vertex.x * fDistFromCenter);
-        vertices.emplace_back(vertex.y * fDistFromCenter);
-        vertices.emplace_back(vertex.z * fDistFromCenter);
+        float* pVertex = &vertices[j * 6];
+        pVertex[0] = vertex.x * fDistFromCenter;
+        pVertex[1] = vertex.y * fDistFromCenter;
+        pVertex[2] = vertex.z * fDistFromCenter;
 
         //normals
-        vertices.emplace_back(vertex.x);
-        vertices.emplace_back(vertex.y);
-        vertices.emplace_back(vertex.z);
+        pVertex[3] = vertex.x;
+        pVertex[4] = vertex.y;
+        pVertex[5] = vertex.z;
     }
 
     // convert to RGBA
-    std::vector<Ogre::RGBA> colours;
-    colours.reserve(nRingVertices);
-    for (int i = 0; i < nRingVertices; i++)
-    {
-        if(i >= nRingVertices / 2.f)
-            colours[i] = colorInner.getAsBYTE(); //0 colour
-        else
-            colours[i] = colorOuter.getAsBYTE(); //0 colour
-    }
-
-    /// Create vertex data structure for 8 vertices shared between submeshes
-    msh->sharedVertexData = new Ogre::VertexData();
-    msh->sharedVertexData->vertexCount = nRingVertices;
+    std::vector<Ogre::RGBA>& colours = scratchBuffers.vecColours;
+    colours.assign(nVertices, Ogre::ColourValue(1.0, 0.0, 0.0).getAsBYTE());     //0 colour
 
-    /// Create declaration (memory format) of vertex data
-    Ogre::VertexDeclaration* decl = msh->sharedVertexData->vertexDeclaration;
-    size_t offset = 0;
-    // 1st buffer
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
-    /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
-    /// and bytes per vertex (offset)
-    Ogre::HardwareVertexBufferSharedPtr vbuf =
-        Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-            offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+    msh->sharedVertexData->vertexCount = nVertices;
     /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), static_cast<void*>(vertices.data()), true);
+    Ogre::HardwareVertexBufferSharedPtr vbuf = getVertexBuffer(msh->sharedVertexData, 0, nVertices);
+    vbuf->writeData(0, nVertices * vbuf->getVertexSize(), static_cast<void*>(vertices.data()), true);
+    vbuf = getVertexBuffer(msh->sharedVertexData, 1, nVertices);
+    vbuf->writeData(0, nVertices * vbuf->getVertexSize(), static_cast<void*>(colours.data()), true);
 
-    /// Set vertex buffer binding so buffer 0 is bound to our vertex buffer
-    Ogre::VertexBufferBinding* bind = msh->sharedVertexData->vertexBufferBinding;
-    bind->setBinding(0, vbuf);
+    /// Upload the index data to the card
+    Ogre::SubMesh* sub = msh->getSubMesh(0);
+    Ogre::HardwareIndexBufferSharedPtr ibuf = getIndexBuffer(sub->indexData, iBufCount);
+    ibuf->writeData(0, iBufCount * ibuf->getIndexSize(), static_cast<void*>(vecIndices.data()), true);
+    sub->indexData->indexCount = iBufCount;
+
+    /// Set bounding information (for culling)
+    msh->_setBounds(Ogre::AxisAlignedBox(-fSideLength, -fSideLength, -fSideLength, fSideLength, fSideLength, fSideLength));
+    msh->_setBoundingSphereRadius(Ogre::Math::Sqrt(3 * fSideLength * fSideLength));
+}
+
+Ogre::HardwareVertexBufferSharedPtr Planet::getVertexBuffer(Ogre::VertexData* const vertexData, const unsigned short source, const size_t nVertexCount)
+{
+    TRACE_SCOPE("Planet::getVertexBuffer");
+    //keep the buffer already bound if it is large enough, only grow it
+    //so switching back and forth between resolutions reuses the same gpu memory
+    Ogre::VertexBufferBinding* bind = vertexData->vertexBufferBinding;
+    if (bind->isBufferBound(source) && bind->getBuffer(source)->getNumVertices() >= nVertexCount)
+        return bind->getBuffer(source);
 
-    // 2nd buffer   VET_UBYTE4_NORM
-    offset = 0;
-    decl->addElement(1, offset, Ogre::VET_UBYTE4_NORM, Ogre::VES_COLOUR);
-    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_UBYTE4_NORM);
     /// Allocate vertex buffer of the requested number of vertices (vertexCount) 
     /// and bytes per vertex (offset)
-    vbuf = Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
-        offset, msh->sharedVertexData->vertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
-    /// Upload the vertex data to the card
-    vbuf->writeData(0, vbuf->getSizeInBytes(), static_cast<void*>(colours.data()), true);
+    Ogre::HardwareVertexBufferSharedPtr vbuf =
+        Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+            vertexData->vertexDeclaration->getVertexSize(source), nVertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+    /// Set vertex buffer binding so buffer source is bound to the new buffer, the old one is released
+    bind->setBinding(source, vbuf);
+    return vbuf;
+}
 
-    /// Set vertex buffer binding so buffer 1 is bound to our colour buffer
-    bind->setBinding(1, vbuf);
+Ogre::HardwareIndexBufferSharedPtr Planet::getIndexBuffer(Ogre::IndexData* const indexData, const size_t nIndexCount)
+{
+    TRACE_SCOPE("Planet::getIndexBuffer");
+    if (indexData->indexBuffer && indexData->indexBuffer->getNumIndexes() >= nIndexCount)
+        return indexData->indexBuffer;
 
     /// Allocate index buffer of the requested number of vertices (ibufCount) 
-    Ogre::HardwareIndexBufferSharedPtr ibuf = Ogre::HardwareBufferManager::getSingleton().
+    indexData->indexBuffer = Ogre::HardwareBufferManager::getSingleton().
         createIndexBuffer(
             Ogre::HardwareIndexBuffer::IT_16BIT,
-            iRingBufCount,
+            nIndexCount,
             Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+    return indexData->indexBuffer;
+}
 
-    /// Upload the index data to the card
-    ibuf->writeData(0, ibuf->getSizeInBytes(), static_cast<void*>(vecRingIndices.data()), true);
-
-    /// Set parameters of the submesh
-    sub->useSharedVertices = true;
-    sub->indexData->indexBuffer = ibuf;
-    sub->indexData->indexCount = iRingBufCount;
-    sub->indexData->indexStart = 0;
 
-    /// Set bounding information (for culling)
-    msh->_setBounds(Ogre::AxisAlignedBox(-fSideLength, -fSideLength, -fSideLength, fSideLength, fSideLength, fSideLength));
-    msh->_setBoundingSphereRadius(Ogre::Math::Sqrt(3 * fSideLength * fSideLength));
+void Planet::createRings()
+{
+    /// Create the mesh via the MeshManager
+    mshRings = Ogre::MeshManager::getSingleton().createManual(strName + "Rings", "General");
+    /// Create one submesh
+    Ogre::SubMesh* sub = mshRings->createSubMesh();
 
-    /// Notify -Mesh object that it has been loaded
-    msh->load();
+    /// Create vertex data structure for the quads of all rings
+    mshRings->sharedVertexData = new Ogre::VertexData();
 
+    /// Create declaration (memory format) of vertex data
+    Ogre::VertexDeclaration* decl = mshRings->sharedVertexData->vertexDeclaration;
+    size_t offset = 0;
+    // 1st buffer
+    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+    decl->addElement(0, offset, Ogre::VET_FLOAT2, Ogre::VES_TEXTURE_COORDINATES, 0);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT2);
+    decl->addElement(0, offset, Ogre::VET_FLOAT4, Ogre::VES_TEXTURE_COORDINATES, 1);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT4);
 
-    //now spawn it 
-    Ogre::Entity* entityR = mSceneMgr->createEntity(strEntity, strItem);
-    entityR->setMaterialName(strName + "DiffuseMtr");
-    entityR->setVisibilityFlags(visibilityMask);
-    Ogre::SceneNode* nodeR = mSceneMgr->getRootSceneNode()->createChildSceneNode();
-    nodeR->attachObject(entityR);
+    // 2nd buffer   VET_UBYTE4_NORM, the outer colour
+    offset = 0;
+    decl->addElement(1, offset, Ogre::VET_UBYTE4_NORM, Ogre::VES_COLOUR);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_UBYTE4_NORM);
 
-    *entity = entityR;
-    *node = nodeR;
+    /// Set parameters of the submesh
+    sub->useSharedVertices = true;
+    sub->indexData->indexStart = 0;
 
-    return msh;
+    //now spawn it, the buffers are filled before load() like the faces
+    buildRings();
+    uploadRings();
+    mshRings->load();
+    entityRings = mSceneMgr->createEntity(strName + "Rings", strName + "Rings");
+    entityRings->setMaterial(getRingMaterial());
+    entityRings->setVisibilityFlags(visibilityMask);
+    sceneNodeRings = mSceneMgr->getRootSceneNode()->createChildSceneNode();
+    sceneNodeRings->attachObject(entityRings);
+    entityRings->setVisible(!vecRingBatchIndices.empty());
+
+    //generate() builds the debris if it is on
+    if (ringDebris.init(mSceneMgr, strName, sceneNodeRings, visibilityMask))
+        ringDebris.setLightType(lightType == LightType::DIRECTIONAL);
 }
 
-
-void Planet::updateRing(const Ogre::Mesh* const mesh, const Ogre::Vector3 vFace, const float fOuterRingDia, const float fInnerThickness, const Ogre::ColourValue colorInner, const Ogre::ColourValue colorOuter)
+void Planet::buildRings()
 {
-    //default for Ogre::Vector3::NEGATIVE_UNIT_Y
-    Ogre::Quaternion vertexRot(Ogre::Degree(0), Ogre::Vector3::UNIT_X);
-    //rotate the plane so it may face the correct direction according to its face
-    if (vFace == Ogre::Vector3::UNIT_Y)
-        vertexRot = Ogre::Quaternion(Ogre::Degree(180), Ogre::Vector3::UNIT_X);     //pitch 180
-
-    bool added_shared = false;
-    size_t current_offset = 0;
-    size_t shared_offset = 0;
-    size_t next_offset = 0;
-    size_t index_offset = 0;
-
-    int vertex_count = 0, index_count = 0;
-    Ogre::SubMesh* submesh = mesh->getSubMesh(0);
-    // We only need to add the shared vertices once
-    if (submesh->useSharedVertices)
+    TRACE_SCOPE("Planet::buildRings");
+    size_t nVisible = 0;
+    for (const auto& ring : vecRings)
+        nVisible += ring.bVisible;
+    scratchBuffers.vecVertices.resize(nVisible * 4 * RingVertexFloats);
+    scratchBuffers.vecColours.resize(nVisible * 4);
+    scratchBuffers.vecElevations.clear();
+    scratchBuffers.box.setNull();
+    vecRingBatchIndices.clear();
+    ringsHash = getRingsHash();
+
+    //corners of the quad in the ring plane, the uv is the same position over the outer radius
+    static const float corners[4][2] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f } };
+    size_t nRing = 0;
+    for (const auto& ring : vecRings)
     {
-        if (!added_shared)
+        if (!ring.bVisible)
+            continue;
+        Ogre::Quaternion orientation = getRingOrientation(ring);
+        Ogre::Vector3 vNormal = orientation * Ogre::Vector3::UNIT_Y;
+        float fOuter = ring.fOuterRingDia * fSideLength / 2.f;
+        for (size_t c = 0; c < 4; c++)
         {
-            vertex_count += mesh->sharedVertexData->vertexCount;
-            added_shared = true;
+            Ogre::Vector3 v = orientation * Ogre::Vector3(corners[c][0] * fOuter, 0.f, corners[c][1] * fOuter);
+            float* pVertex = &scratchBuffers.vecVertices[(nRing * 4 + c) * RingVertexFloats];
+            pVertex[0] = v.x;
+            pVertex[1] = v.y;
+            pVertex[2] = v.z;
+            pVertex[3] = vNormal.x;
+            pVertex[4] = vNormal.y;
+            pVertex[5] = vNormal.z;
+            pVertex[6] = corners[c][0];
+            pVertex[7] = corners[c][1];
+            pVertex[8] = ring.colorInner.r;
+            pVertex[9] = ring.colorInner.g;
+            pVertex[10] = ring.colorInner.b;
+            pVertex[11] = 1.f - ring.fInnerThickness;
+            scratchBuffers.vecColours[nRing * 4 + c] = ring.colorOuter.getAsBYTE();
+            scratchBuffers.box.merge(v);
         }
+        unsigned short nOffset = static_cast<unsigned short>(nRing * 4);
+        for (unsigned short index : { 0, 1, 2, 0, 2, 3 })
+            vecRingBatchIndices.emplace_back(index + nOffset);
+        nRing++;
     }
-    else
-    {
-        vertex_count += submesh->vertexData->vertexCount;
-    }
-    // Add the indices
-    index_count += submesh->indexData->indexCount;
-
-    // Allocate space for the vertices and indices
-    auto vertices = new Ogre::Vector3[vertex_count];
-    auto indices = new unsigned long[index_count];
-    added_shared = false;
-
-    Ogre::VertexData* vertex_data = submesh->useSharedVertices ? mesh->sharedVertexData : submesh->vertexData;
-    Ogre::VertexData* color_data = vertex_data;
-    if ((!submesh->useSharedVertices) || (submesh->useSharedVertices && !added_shared))
-    {
-        if (submesh->useSharedVertices)
-        {
-            added_shared = true;
-            shared_offset = current_offset;
-        }
+}
 
-        //vertex position
-        float* pVertexPosition;
-        Ogre::Vector3 v, vMesh;
-        const Ogre::VertexElement* posElem = vertex_data->vertexDeclaration->findElementBySemantic(Ogre::VES_POSITION);
-        Ogre::HardwareVertexBufferSharedPtr vbufPos = vertex_data->vertexBufferBinding->getBuffer(posElem->getSource());
-        unsigned char* vertex = static_cast<unsigned char*>(vbufPos->lock(Ogre::HardwareBuffer::HBL_WRITE_ONLY));
-
-        //diffuse
-        Ogre::RGBA* pColorValue;
-        const Ogre::VertexElement* colorElem = color_data->vertexDeclaration->findElementBySemantic(Ogre::VES_COLOUR);
-        Ogre::HardwareVertexBufferSharedPtr vbufColor = color_data->vertexBufferBinding->getBuffer(colorElem->getSource());
-        unsigned char* color = static_cast<unsigned char*>(vbufColor->lock(Ogre::HardwareBuffer::HBL_WRITE_ONLY));
-           
-        float fDistFromCenter = fOuterRingDia * fSideLength / 2.f;
-        float fInnerRingDist = fDistFromCenter * (1.f - fInnerThickness);
-        for (size_t j = 0; j < vertex_data->vertexCount; ++j, vertex += vbufPos->getVertexSize(), color += vbufColor->getVertexSize())
-        {
-            //VERTEX
-             //gets the pointer to the vertex !!!!
-            posElem->baseVertexPointerToElement(vertex, &pVertexPosition);
+void Planet::uploadRings()
+{
+    TRACE_SCOPE("Planet::uploadRings");
+    nUploadCount++;
+    size_t nVertexCount = scratchBuffers.vecColours.size();
+    mshRings->sharedVertexData->vertexCount = nVertexCount;
+    Ogre::SubMesh* sub = mshRings->getSubMesh(0);
+    sub->indexData->indexCount = vecRingBatchIndices.size();
+    if (entityRings != nullptr)
+        entityRings->setVisible(nVertexCount != 0);
+    //nothing to draw, the buffers keep whatever they had
+    if (nVertexCount == 0)
+        return;
+
+    //the shadow of the planet on the rings
+    for (auto& material : { materialRingAmbient, materialRingSunlight })
+        material->getTechnique(0)->getPass(0)->getFragmentProgramParameters()->setNamedConstant("planetRadius", fSideLength / 2.f);
+
+    /// Upload the vertex data to the card, pooled so showing fewer rings keeps the buffers
+    Ogre::HardwareVertexBufferSharedPtr vbuf = getVertexBuffer(mshRings->sharedVertexData, 0, nVertexCount);
+    vbuf->writeData(0, nVertexCount * vbuf->getVertexSize(), static_cast<const void*>(scratchBuffers.vecVertices.data()), true);
+    vbuf = getVertexBuffer(mshRings->sharedVertexData, 1, nVertexCount);
+    vbuf->writeData(0, nVertexCount * vbuf->getVertexSize(), static_cast<const void*>(scratchBuffers.vecColours.data()), true);
 
-            v = vertexRot * vecRingVertices[j];
-            v.normalise();
+    /// Upload the index data to the card
+    Ogre::HardwareIndexBufferSharedPtr ibuf = getIndexBuffer(sub->indexData, vecRingBatchIndices.size());
+    ibuf->writeData(0, vecRingBatchIndices.size() * ibuf->getIndexSize(), static_cast<const void*>(vecRingBatchIndices.data()), true);
 
-            //check if position is for inner ring or outer
-            if (j >= nRingVertices / 2)
-                fDistFromCenter = fInnerRingDist;
+    mshRings->_setBounds(scratchBuffers.box);
+    mshRings->_setBoundingSphereRadius(std::max(scratchBuffers.box.getMinimum().length(), scratchBuffers.box.getMaximum().length()));
+}
 
-            pVertexPosition[0] = v.x * fDistFromCenter;
-            pVertexPosition[1] = v.y * fDistFromCenter;
-            pVertexPosition[2] = v.z * fDistFromCenter;
+void Planet::updateRings()
+{
+    //headless and gradient planets have no ring mesh
+    if (!mshRings)
+        return;
+    buildRings();
+    uploadRings();
+    updateRingDebris();
+}
 
-            //COLOUR
-            //now pointer to the color value
-            colorElem->baseVertexPointerToElement(color, &pColorValue);
-            if (j >= nRingVertices / 2)
-                *pColorValue = colorInner.getAsBYTE();
-            else
-                *pColorValue = colorOuter.getAsBYTE();
+void Planet::updateRingDebris()
+{
+    //needs the ring node and hardware instancing
+    if (!ringDebris.isInitialised())
+        return;
+    if (!bRingDebris)
+    {
+        ringDebris.hide();
+        ringDebrisHash = 0;
+        return;
+    }
+    uint64_t hash = getRingsHash();
+    hash = fnv1a(&iSeed, sizeof(iSeed), hash);
+    hash = fnv1a(&nRingDebris, sizeof(nRingDebris), hash);
+    if (hash == ringDebrisHash)
+        return;
+    ringDebrisHash = hash;
+    nUploadCount++;
+    ringDebris.build(vecRings, iSeed, fSideLength, nRingDebris);
+    ringDebris.upload(fSideLength);
+}
 
-        }
+void Planet::destroyRingDebris()
+{
+    ringDebris.destroy();
+    ringDebrisHash = 0;
+}
 
-        vbufPos->unlock();
-        vbufColor->unlock();
+uint64_t Planet::getRingsHash() const
+{
+    uint64_t hash = fnv1a(&fSideLength, sizeof(fSideLength));
+    auto add = [&hash](const auto value) { hash = fnv1a(&value, sizeof(value), hash); };
+    for (const auto& ring : vecRings)
+    {
+        add(static_cast<uint32_t>(ring.bVisible));
+        add(ring.fOuterRingDia);
+        add(ring.fInnerThickness);
+        add(ring.fYaw);
+        add(ring.fPitch);
+        add(ring.fRoll);
+        add(ring.colorInner.getAsBYTE());
+        add(ring.colorOuter.getAsBYTE());
     }
-
-    delete vertices;
-    delete indices;
+    return hash;
 }
 
+float Planet::getRingShade(const float t)
+{
+    return 1.f - RingBandStrength * (0.5f + 0.5f * std::sin(t * RingBandFrequency + 3.f * std::sin(t * RingBandFrequency * 0.37f)));
+}
 
+void Planet::buildRing(FaceBuffers& buffers, const Ring& ring, const Ogre::Vector3 vFace) const
+{
+    TRACE_SCOPE("Planet::buildRing");
+    //rings only use the +y and -y faces
+    Ogre::Quaternion vertexRot = getFaceRotation(vFace);
+
+    buffers.vecVertices.resize(nRingVertices * 6);
+    buffers.vecColours.resize(nRingVertices);
+    buffers.vecElevations.clear();
+    buffers.box.setNull();
+
+    Ogre::Vector3 v;
+    float fDistFromCenter = ring.fOuterRingDia * fSideLength / 2.f;
+    float fInnerRingDist = fDistFromCenter * (1.f - ring.fInnerThickness);
+    for (size_t j = 0; j < nRingVertices; ++j)
+    {
+        //VERTEX
+        v = vertexRot * vecRingVertices[j];
+        v.normalise();
+
+        //check if position is for inner ring or outer
+        if (j >= nRingVertices / 2)
+            fDistFromCenter = fInnerRingDist;
+
+        float* pVertex = &buffers.vecVertices[j * 6];
+        pVertex[0] = v.x * fDistFromCenter;
+        pVertex[1] = v.y * fDistFromCenter;
+        pVertex[2] = v.z * fDistFromCenter;
+        //normals
+        pVertex[3] = v.x;
+        pVertex[4] = v.y;
+        pVertex[5] = v.z;
+        buffers.box.merge(Ogre::Vector3(pVertex[0], pVertex[1], pVertex[2]));
+
+        //COLOUR
+        if (j >= nRingVertices / 2)
+            buffers.vecColours[j] = ring.colorInner.getAsBYTE();
+        else
+            buffers.vecColours[j] = ring.colorOuter.getAsBYTE();
+    }
+}
 
 void Planet::createDefaultFaceVerticesAndIndices()
 {
+    //called again when the resolution changes
+    vecVertices.clear();
+    vecIndices.clear();
+    vecRingVertices.clear();
+    vecRingIndices.clear();
     vecVertices.reserve(vBufCount);
     vecIndices.reserve(iBufCount);
     //standard vertex positions at default NEGATIVE_UNIT_Y direction starting from -x, -y, -z
@@ -791,6 +1231,12 @@ void Planet::createDefaultFaceVerticesAndIndices()
 }
 
 
+const char* Planet::getPresetName(const Preset preset)
+{
+    static const char* PresetNames[PresetCount] = { "Swift_Planet", "Evening_Star", "Rocky_Moon", "Blue_Marble", "Ringed_Giant", "Ice_Giant", "Rusty_Planet" };
+    return PresetNames[static_cast<size_t>(preset)];
+}
+
 void Planet::setPreset(const Preset preset)
 {
     switch (preset)
@@ -825,15 +1271,7 @@ void Planet::setPreset(const Preset preset)
             face->resetOrientation();
 
         for (auto& ring : vecRings)
-        {
             ring.bVisible = false;
-            //cause gradient planets dont generate rings
-            if (ring.entityY != nullptr)
-            {
-                ring.entityY->setVisible(false);
-                ring.entityNY->setVisible(false);
-            }
-        }
 
 
         break;
@@ -873,15 +1311,7 @@ void Planet::setPreset(const Preset preset)
             face->resetOrientation();
 
         for (auto& ring : vecRings)
-        {
             ring.bVisible = false;
-            //cause gradient planets dont generate rings
-            if (ring.entityY != nullptr)
-            {
-                ring.entityY->setVisible(false);
-                ring.entityNY->setVisible(false);
-            }
-        }
 
         break;
 
@@ -916,15 +1346,7 @@ void Planet::setPreset(const Preset preset)
             face->resetOrientation();
         
         for (auto& ring : vecRings)
-        {
             ring.bVisible = false;
-            //cause gradient planets dont generate rings
-            if (ring.entityY != nullptr)
-            {
-                ring.entityY->setVisible(false);
-                ring.entityNY->setVisible(false);
-            }
-        }
 
 
         break;
@@ -966,15 +1388,7 @@ void Planet::setPreset(const Preset preset)
             face->resetOrientation();
 
         for (auto& ring : vecRings)
-        {
             ring.bVisible = false;
-            //cause gradient planets dont generate rings
-            if (ring.entityY != nullptr)
-            {
-                ring.entityY->setVisible(false);
-                ring.entityNY->setVisible(false);
-            }
-        }
 
         break;
 
@@ -1025,17 +1439,9 @@ void Planet::setPreset(const Preset preset)
             for (auto& ring : vecRings)
             {
                 ring.bVisible = ring.bVisible = ring.bVisible = true;
-                ring.entityY->setVisible(true);
-                ring.entityY->setVisible(true);
-                ring.entityY->setVisible(true);
-                ring.entityNY->setVisible(true);
-                ring.entityNY->setVisible(true);
-                ring.entityNY->setVisible(true);
                 ring.fYaw = 0.f;
                 ring.fRoll = 0.f;
                 ring.fPitch = 0.f;
-                ring.sceneNodeNY->resetOrientation();
-                ring.sceneNodeY->resetOrientation();
             }
 
         }
@@ -1078,24 +1484,9 @@ void Planet::setPreset(const Preset preset)
             for (auto& ring : vecRings)
             {
                 ring.bVisible = ring.bVisible = ring.bVisible = true;
-                ring.entityY->setVisible(true);
-                ring.entityY->setVisible(true);
-                ring.entityY->setVisible(true);
-                ring.entityNY->setVisible(true);
-                ring.entityNY->setVisible(true);
-                ring.entityNY->setVisible(true);
                 ring.fYaw = 0.f;
                 ring.fRoll = -1.f;
                 ring.fPitch = -0.955f;
-                ring.sceneNodeNY->resetOrientation();
-                ring.sceneNodeY->resetOrientation();
-
-                ring.sceneNodeY->yaw(Ogre::Radian(ring.fYaw), Ogre::Node::TS_WORLD);
-                ring.sceneNodeY->roll(Ogre::Radian(ring.fRoll), Ogre::Node::TS_WORLD);
-                ring.sceneNodeY->pitch(Ogre::Radian(ring.fPitch), Ogre::Node::TS_WORLD);
-                ring.sceneNodeNY->yaw(Ogre::Radian(ring.fYaw), Ogre::Node::TS_WORLD);
-                ring.sceneNodeNY->roll(Ogre::Radian(ring.fRoll), Ogre::Node::TS_WORLD);
-                ring.sceneNodeNY->pitch(Ogre::Radian(ring.fPitch), Ogre::Node::TS_WORLD);
             }
 
         }
@@ -1142,15 +1533,7 @@ void Planet::setPreset(const Preset preset)
             face->resetOrientation();
 
         for (auto& ring : vecRings)
-        {
             ring.bVisible = false;
-            //cause gradient planets dont generate rings
-            if (ring.entityY != nullptr)
-            {
-                ring.entityY->setVisible(false);
-                ring.entityNY->setVisible(false);
-            }
-        }
 
         break;
 
@@ -1210,6 +1593,16 @@ void Planet::setValuesToNoiseObject()
 
 }
 
+void Planet::resetToDefaultValues()
+{
+    resetToDefaultNoiseValues();
+    resetToDefaultBiomeValues();
+
+    //resize to initialize 3 ring objects
+    vecRings.resize(3);
+    resetToDefaultRingValues();
+}
+
 void Planet::resetToDefaultNoiseValues()
 {
     bDomainWarp = false;
@@ -1276,206 +1669,589 @@ void Planet::resetToDefaultRingValues()
         ring.colorInner = Ogre::ColourValue(0.076f, 0.076f, 0.076f);
         ring.colorOuter = Ogre::ColourValue(0.55f, 0.55f, 0.55f);
         ring.fRoll = ring.fYaw = ring.fPitch = 0.f;
-        if (ring.sceneNodeY != nullptr)
-        {
-            ring.sceneNodeY->resetOrientation();
-            ring.sceneNodeNY->resetOrientation();
-        }
     }
+    updateRings();
 }
 
-bool Planet::readDATFile()
+struct BiomeRecord
+{
+    float e;
+    float color[3];
+};
+
+struct RingRecord
 {
-    FILE* fileDat;
-    if (fopen_s(&fileDat, "./mesh.dat", "r") == 0)
+    uint32_t bVisible;
+    float fOuterRingDia, fInnerThickness;
+    float fPitch, fYaw, fRoll;
+    float colorOuter[3], colorInner[3];
+};
+
+struct ElevationHeader
+{
+    uint32_t nSections;
+    uint32_t nFaces;
+    uint64_t hash;                                                      //getElevationHash() of the parameters the elevation was generated with
+};
+
+//one chunk of a mesh cache entry, followed by the vertices, colours and elevations of the face
+struct FaceCacheHeader
+{
+    uint32_t nVertices;
+    uint32_t reserved;
+    float min[3], max[3];
+};
+
+constexpr uint32_t MeshCacheVersion = 1;                               //bump when buildFace() output changes so old entries miss
+
+constexpr uint32_t ChunkParams = makeChunkId('P', 'A', 'R', 'M');
+constexpr uint32_t ChunkBiomes = makeChunkId('B', 'I', 'O', 'M');
+constexpr uint32_t ChunkRings = makeChunkId('R', 'I', 'N', 'G');
+constexpr uint32_t ChunkElevation = makeChunkId('E', 'L', 'E', 'V');
+
+uint64_t Planet::getElevationHash() const
+{
+    //everything the raw elevation of a vertex depends on, colours and biomes are applied on top of it
+    uint64_t hash = fnv1a(nullptr, 0);
+    auto add = [&hash](const auto value) { hash = fnv1a(&value, sizeof(value), hash); };
+    add(static_cast<uint32_t>(nSections));
+    add(iDiaMultiplier);
+    add(noiseType);
+    add(rotationType3D);
+    add(iSeed);
+    add(fFrequency);
+    add(fractalType);
+    add(iOctaves);
+    add(fFractalGain);
+    add(fFractalWeightedStrength);
+    add(fFractalLacunarity);
+    add(fPingPongStrength);
+    add(cellularDistanceFunction);
+    add(cellularReturnType);
+    add(fJitter);
+    add(static_cast<uint32_t>(bDomainWarp));
+    if (bDomainWarp)
     {
-        fscanf_s(fileDat, "%d", &bAutoLodGeneration);
-        fscanf_s(fileDat, "%d", &lightType);
-
-        int iType = 0;
-        fscanf_s(fileDat, "%d", &iType);
-        nSections = std::clamp(static_cast<size_t>(iType), MinSections, MaxSections);
-        fscanf_s(fileDat, "%d", &iDiaMultiplier);
-        iDiaMultiplier = std::clamp(iDiaMultiplier, MinDiaMultiplier, MaxDiaMultiplier);
-        
-        fscanf_s(fileDat, "%f", &fPerFrequencyHeight);
-        fPerFrequencyHeight = std::clamp(fPerFrequencyHeight, 0.01f, 0.5f);
-        fscanf_s(fileDat, "%d", &indexMinBiomeDepth);
-        indexMinBiomeDepth = std::clamp(indexMinBiomeDepth, 0, MaxBiomesIndex);
-
-        fscanf_s(fileDat, "%d", &bDomainWarp);
-
-        //noise
-        fscanf_s(fileDat, "%d", &iType);
-        noiseType = static_cast<FastNoiseLite::NoiseType>(iType);
-        noiseType = noiseType > FastNoiseLite::NoiseType_Value ? FastNoiseLite::NoiseType_Value : noiseType;
-        fscanf_s(fileDat, "%d", &iType);
-        rotationType3D = static_cast<FastNoiseLite::RotationType3D>(iType);
-        rotationType3D = rotationType3D > FastNoiseLite::RotationType3D_ImproveXZPlanes ? FastNoiseLite::RotationType3D_ImproveXZPlanes : rotationType3D;
-        fscanf_s(fileDat, "%d", &iSeed);
-        fscanf_s(fileDat, "%f", &fFrequency);
-        
-        fscanf_s(fileDat, "%d", &iType);
-        fractalType = static_cast<FastNoiseLite::FractalType>(iType);
-        fractalType = fractalType > FastNoiseLite::FractalType_PingPong ? FastNoiseLite::FractalType_PingPong : fractalType;
-        fscanf_s(fileDat, "%d", &iOctaves);
-        fscanf_s(fileDat, "%f", &fFractalGain);
-        fscanf_s(fileDat, "%f", &fFractalWeightedStrength);
-        fscanf_s(fileDat, "%f", &fFractalLacunarity);
-        fscanf_s(fileDat, "%f", &fPingPongStrength);
-
-        fscanf_s(fileDat, "%d", &iType);
-        cellularDistanceFunction = static_cast<FastNoiseLite::CellularDistanceFunction> (iType);
-        cellularDistanceFunction = cellularDistanceFunction > FastNoiseLite::CellularDistanceFunction_Hybrid ? FastNoiseLite::CellularDistanceFunction_Hybrid : cellularDistanceFunction;
-        fscanf_s(fileDat, "%d", &iType);
-        cellularReturnType = static_cast<FastNoiseLite::CellularReturnType> (iType);
-        cellularReturnType = cellularReturnType > FastNoiseLite::CellularReturnType_Distance2Div ? FastNoiseLite::CellularReturnType_Distance2Div : cellularReturnType;
-        fscanf_s(fileDat, "%f", &fJitter);
-
-        fscanf_s(fileDat, "%d", &iType);
-        domainWarpType = static_cast<FastNoiseLite::DomainWarpType>(iType);
-        domainWarpType = domainWarpType > FastNoiseLite::DomainWarpType_BasicGrid ? FastNoiseLite::DomainWarpType_BasicGrid : domainWarpType;
-        fscanf_s(fileDat, "%d", &iType);
-        domainWarpRotationType3D = static_cast<FastNoiseLite::RotationType3D>(iType);
-        domainWarpRotationType3D = domainWarpRotationType3D > FastNoiseLite::RotationType3D_ImproveXZPlanes ? FastNoiseLite::RotationType3D_ImproveXZPlanes : domainWarpRotationType3D;
-        fscanf_s(fileDat, "%f", &fDomainWarpAmplitude);
-        fscanf_s(fileDat, "%f", &fDomainWarpFrequency);
-
-        fscanf_s(fileDat, "%d", &iType);
-        domainWarpFractalType = static_cast<FastNoiseLite::FractalType>(iType);
-        domainWarpFractalType = domainWarpFractalType > FastNoiseLite::FractalType_DomainWarpIndependent ? FastNoiseLite::FractalType_DomainWarpIndependent : domainWarpFractalType;
-        fscanf_s(fileDat, "%d", &iDWFractalOctaves);
-        fscanf_s(fileDat, "%f", &fDWFractalLacunarity);
-        fscanf_s(fileDat, "%f", &fDWFractalGain);
-
-
-        //Biomes
-        Ogre::ColourValue color;
-        float e = 0.f;
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));                        //deep water
-
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+        add(domainWarpType);
+        add(domainWarpRotationType3D);
+        add(fDomainWarpAmplitude);
+        add(fDomainWarpFrequency);
+        add(domainWarpFractalType);
+        add(iDWFractalOctaves);
+        add(fDWFractalLacunarity);
+        add(fDWFractalGain);
+    }
+    return hash;
+}
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+uint64_t Planet::getMeshHash() const
+{
+    //the elevation plus everything that turns it into positions and colours
+    uint64_t hash = getElevationHash();
+    auto add = [&hash](const auto value) { hash = fnv1a(&value, sizeof(value), hash); };
+    add(MeshCacheVersion);
+    add(meshType);
+    add(static_cast<uint32_t>(bRenderElevation));
+    add(fPerFrequencyHeight);
+    add(indexMinBiomeDepth);
+    add(interpolationType);
+    for (auto& biome : vecBiomes)
+    {
+        add(biome.e);
+        add(biome.color.r);
+        add(biome.color.g);
+        add(biome.color.b);
+        add(biome.color.a);
+    }
+    return hash;
+}
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+uint64_t FaceBuffers::getContentHash() const
+{
+    //positions without the normals, which only depend on the grid
+    uint64_t hash = fnv1a(nullptr, 0);
+    for (size_t i = 0; i < vecColours.size() && i * 6 + 3 <= vecVertices.size(); i++)
+        hash = fnv1a(&vecVertices[i * 6], 3 * sizeof(float), hash);
+    return fnv1a(vecColours.data(), vecColours.size() * sizeof(Ogre::RGBA), hash);
+}
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+uint64_t Planet::getContentHash() const
+{
+    uint64_t hash = fnv1a(nullptr, 0);
+    for (auto& face : vecFaceBuffers)
+    {
+        uint64_t faceHash = face.getContentHash();
+        hash = fnv1a(&faceHash, sizeof(faceHash), hash);
+    }
+    return hash;
+}
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+bool Planet::readMeshCache(const uint64_t hash, PlanetFile& file, CachedFace* pFaces)
+{
+    TRACE_SCOPE("Planet::readMeshCache");
+    if (!meshCache.open(hash, file))
+        return false;
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+    for (size_t i = 0; i < vecFaceBuffers.size(); i++)
+    {
+        size_t nSize = 0;
+        auto header = static_cast<const FaceCacheHeader*>(file.getChunk(makeChunkId('F', 'A', 'C', static_cast<char>('0' + i)), &nSize));
+        if (header == nullptr || header->nVertices != nVertices || nSize != sizeof(FaceCacheHeader) + nVertices * (6 * sizeof(float) + sizeof(Ogre::RGBA) + sizeof(float)))
+        {
+            file.close();
+            return false;
+        }
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+        CachedFace& face = pFaces[i];
+        face.pVertices = reinterpret_cast<const float*>(header + 1);
+        face.pColours = reinterpret_cast<const Ogre::RGBA*>(face.pVertices + nVertices * 6);
+        face.pElevations = reinterpret_cast<const float*>(face.pColours + nVertices);
+        face.box.setExtents(header->min[0], header->min[1], header->min[2], header->max[0], header->max[1], header->max[2]);
+    }
+    return true;
+}
 
-        fscanf_s(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
-        vecBiomes.emplace_back(Biome(e, color));
+void Planet::copyCachedFaces(const CachedFace* pFaces)
+{
+    TRACE_SCOPE("Planet::copyCachedFaces");
+    for (size_t i = 0; i < vecFaceBuffers.size(); i++)
+    {
+        FaceBuffers& face = vecFaceBuffers[i];
+        face.vecVertices.assign(pFaces[i].pVertices, pFaces[i].pVertices + nVertices * 6);
+        face.vecColours.assign(pFaces[i].pColours, pFaces[i].pColours + nVertices);
+        face.vecElevations.assign(pFaces[i].pElevations, pFaces[i].pElevations + nVertices);
+        face.box = pFaces[i].box;
+    }
+}
 
-        //3 rings
-        Ring ring;
-        fscanf_s(fileDat, "%d", &ring.bVisible);
-        fscanf_s(fileDat, "%f", &ring.fOuterRingDia);
-        fscanf_s(fileDat, "%f", &ring.fInnerThickness);
-        fscanf_s(fileDat, "%f", &ring.fPitch);
-        fscanf_s(fileDat, "%f", &ring.fYaw);
-        fscanf_s(fileDat, "%f", &ring.fRoll);
-        fscanf_s(fileDat, "%f,%f,%f", &ring.colorOuter.r, &ring.colorOuter.g, &ring.colorOuter.b);
-        fscanf_s(fileDat, "%f,%f,%f", &ring.colorInner.r, &ring.colorInner.g, &ring.colorInner.b);
-        vecRings.emplace_back(ring);
+void Planet::storeMeshCache()
+{
+    waitMeshCacheStore();
+    if (bMeshCache && meshCacheHash != 0)
+        writeMeshCache(meshCacheHash);
+    meshCacheHash = 0;
+}
 
-        fscanf_s(fileDat, "%d", &ring.bVisible);
-        fscanf_s(fileDat, "%f", &ring.fOuterRingDia);
-        fscanf_s(fileDat, "%f", &ring.fInnerThickness);
-        fscanf_s(fileDat, "%f", &ring.fPitch);
-        fscanf_s(fileDat, "%f", &ring.fYaw);
-        fscanf_s(fileDat, "%f", &ring.fRoll);
-        fscanf_s(fileDat, "%f,%f,%f", &ring.colorOuter.r, &ring.colorOuter.g, &ring.colorOuter.b);
-        fscanf_s(fileDat, "%f,%f,%f", &ring.colorInner.r, &ring.colorInner.g, &ring.colorInner.b);
-        vecRings.emplace_back(ring);
+void Planet::waitMeshCacheStore()
+{
+    if (futureMeshCacheStore.valid())
+        futureMeshCacheStore.get();
+}
 
-        fscanf_s(fileDat, "%d", &ring.bVisible);
-        fscanf_s(fileDat, "%f", &ring.fOuterRingDia);
-        fscanf_s(fileDat, "%f", &ring.fInnerThickness);
-        fscanf_s(fileDat, "%f", &ring.fPitch);
-        fscanf_s(fileDat, "%f", &ring.fYaw);
-        fscanf_s(fileDat, "%f", &ring.fRoll);
-        fscanf_s(fileDat, "%f,%f,%f", &ring.colorOuter.r, &ring.colorOuter.g, &ring.colorOuter.b);
-        fscanf_s(fileDat, "%f,%f,%f", &ring.colorInner.r, &ring.colorInner.g, &ring.colorInner.b);
-        vecRings.emplace_back(ring);
+void Planet::writeMeshCache(const uint64_t hash)
+{
+    TRACE_SCOPE("Planet::writeMeshCache");
+    PlanetFileWriter writer;
+    std::vector<unsigned char> vecData;
+    for (size_t i = 0; i < vecFaceBuffers.size(); i++)
+    {
+        const FaceBuffers& face = vecFaceBuffers[i];
+        size_t nVerticesSize = face.vecVertices.size() * sizeof(float);
+        size_t nColoursSize = face.vecColours.size() * sizeof(Ogre::RGBA);
+        size_t nElevationsSize = face.vecElevations.size() * sizeof(float);
+        vecData.resize(sizeof(FaceCacheHeader) + nVerticesSize + nColoursSize + nElevationsSize);
+
+        const Ogre::Vector3& vMin = face.box.getMinimum();
+        const Ogre::Vector3& vMax = face.box.getMaximum();
+        FaceCacheHeader header{ static_cast<uint32_t>(nVertices), 0, { vMin.x, vMin.y, vMin.z }, { vMax.x, vMax.y, vMax.z } };
+        unsigned char* p = vecData.data();
+        std::memcpy(p, &header, sizeof(header));
+        std::memcpy(p += sizeof(header), face.vecVertices.data(), nVerticesSize);
+        std::memcpy(p += nVerticesSize, face.vecColours.data(), nColoursSize);
+        std::memcpy(p += nColoursSize, face.vecElevations.data(), nElevationsSize);
+        writer.addChunk(makeChunkId('F', 'A', 'C', static_cast<char>('0' + i)), 1, vecData.data(), vecData.size());
+    }
+    meshCache.store(hash, writer);
+}
 
-        fclose(fileDat);
+void Planet::setParam(const PlanetParam param, const uint32_t value)
+{
+    //value is an int or the bits of a float depending on the parameter
+    //the baked elevation was only valid for the values it was loaded with, readPlanetFile() sets it after the values
+    pBakedElevation = nullptr;
+    int iValue = static_cast<int>(value);
+    float fValue;
+    std::memcpy(&fValue, &value, sizeof(fValue));
+    switch (param)
+    {
+    case PlanetParam::AutoLodGeneration: bAutoLodGeneration = iValue != 0; break;
+    case PlanetParam::LightType: lightType = iValue ? LightType::DIRECTIONAL : LightType::AMBIENT; break;
+    case PlanetParam::Sections: nSections = std::clamp(static_cast<size_t>(value), MinSections, MaxSections); break;
+    case PlanetParam::DiaMultiplier: iDiaMultiplier = std::clamp(iValue, MinDiaMultiplier, MaxDiaMultiplier); break;
+    case PlanetParam::PerFrequencyHeight: fPerFrequencyHeight = std::clamp(fValue, 0.01f, 0.5f); break;
+    case PlanetParam::MinBiomeDepth: indexMinBiomeDepth = std::clamp(iValue, 0, MaxBiomesIndex); break;
+    case PlanetParam::DomainWarp: bDomainWarp = iValue != 0; break;
+    case PlanetParam::NoiseType: noiseType = static_cast<FastNoiseLite::NoiseType>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::NoiseType_Value))); break;
+    case PlanetParam::RotationType3D: rotationType3D = static_cast<FastNoiseLite::RotationType3D>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::RotationType3D_ImproveXZPlanes))); break;
+    case PlanetParam::Seed: iSeed = iValue; break;
+    case PlanetParam::Frequency: fFrequency = std::isfinite(fValue) ? fValue : fFrequency; break;
+    case PlanetParam::FractalType: fractalType = static_cast<FastNoiseLite::FractalType>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::FractalType_PingPong))); break;
+    case PlanetParam::Octaves: iOctaves = std::clamp(iValue, 1, MaxOctaves); break;
+    case PlanetParam::FractalGain: fFractalGain = fValue; break;
+    case PlanetParam::FractalWeightedStrength: fFractalWeightedStrength = fValue; break;
+    case PlanetParam::FractalLacunarity: fFractalLacunarity = fValue; break;
+    case PlanetParam::PingPongStrength: fPingPongStrength = fValue; break;
+    case PlanetParam::CellularDistanceFunction: cellularDistanceFunction = static_cast<FastNoiseLite::CellularDistanceFunction>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::CellularDistanceFunction_Hybrid))); break;
+    case PlanetParam::CellularReturnType: cellularReturnType = static_cast<FastNoiseLite::CellularReturnType>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::CellularReturnType_Distance2Div))); break;
+    case PlanetParam::Jitter: fJitter = fValue; break;
+    case PlanetParam::DomainWarpType: domainWarpType = static_cast<FastNoiseLite::DomainWarpType>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::DomainWarpType_BasicGrid))); break;
+    case PlanetParam::DomainWarpRotationType3D: domainWarpRotationType3D = static_cast<FastNoiseLite::RotationType3D>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::RotationType3D_ImproveXZPlanes))); break;
+    case PlanetParam::DomainWarpAmplitude: fDomainWarpAmplitude = fValue; break;
+    case PlanetParam::DomainWarpFrequency: fDomainWarpFrequency = std::isfinite(fValue) ? fValue : fDomainWarpFrequency; break;
+    case PlanetParam::DomainWarpFractalType: domainWarpFractalType = static_cast<FastNoiseLite::FractalType>(std::clamp(iValue, 0, static_cast<int>(FastNoiseLite::FractalType_DomainWarpIndependent))); break;
+    case PlanetParam::DWFractalOctaves: iDWFractalOctaves = std::clamp(iValue, 1, MaxOctaves); break;
+    case PlanetParam::DWFractalLacunarity: fDWFractalLacunarity = fValue; break;
+    case PlanetParam::DWFractalGain: fDWFractalGain = fValue; break;
+    case PlanetParam::LodStitchEdges: bLodStitchEdges = iValue != 0; break;
+    case PlanetParam::InterpolationType: interpolationType = static_cast<InterpolationType>(std::clamp(iValue, 0, static_cast<int>(InterpolationType::Sharp))); break;
+    case PlanetParam::BakeElevation: bBakeElevation = iValue != 0; break;
+    case PlanetParam::MeshCache: bMeshCache = iValue != 0; break;
+    case PlanetParam::RingDebris: bRingDebris = iValue != 0; break;
+    case PlanetParam::RingDebrisCount: nRingDebris = std::min(static_cast<size_t>(value), MaxRingDebrisPerRing); break;
+    default: break;                                                 //written by a newer version
     }
-    else
-        return false;
+}
+
+//names are the same as the PlanetParam ids, enums and bools are given as ints
+struct PlanetParamName
+{
+    const char* strName;
+    PlanetParam param;
+    bool bFloat;
+};
+
+static const PlanetParamName PlanetParamNames[] = {
+    { "AutoLodGeneration", PlanetParam::AutoLodGeneration, false },
+    { "LightType", PlanetParam::LightType, false },
+    { "Sections", PlanetParam::Sections, false },
+    { "DiaMultiplier", PlanetParam::DiaMultiplier, false },
+    { "PerFrequencyHeight", PlanetParam::PerFrequencyHeight, true },
+    { "MinBiomeDepth", PlanetParam::MinBiomeDepth, false },
+    { "DomainWarp", PlanetParam::DomainWarp, false },
+    { "NoiseType", PlanetParam::NoiseType, false },
+    { "RotationType3D", PlanetParam::RotationType3D, false },
+    { "Seed", PlanetParam::Seed, false },
+    { "Frequency", PlanetParam::Frequency, true },
+    { "FractalType", PlanetParam::FractalType, false },
+    { "Octaves", PlanetParam::Octaves, false },
+    { "FractalGain", PlanetParam::FractalGain, true },
+    { "FractalWeightedStrength", PlanetParam::FractalWeightedStrength, true },
+    { "FractalLacunarity", PlanetParam::FractalLacunarity, true },
+    { "PingPongStrength", PlanetParam::PingPongStrength, true },
+    { "CellularDistanceFunction", PlanetParam::CellularDistanceFunction, false },
+    { "CellularReturnType", PlanetParam::CellularReturnType, false },
+    { "Jitter", PlanetParam::Jitter, true },
+    { "DomainWarpType", PlanetParam::DomainWarpType, false },
+    { "DomainWarpRotationType3D", PlanetParam::DomainWarpRotationType3D, false },
+    { "DomainWarpAmplitude", PlanetParam::DomainWarpAmplitude, true },
+    { "DomainWarpFrequency", PlanetParam::DomainWarpFrequency, true },
+    { "DomainWarpFractalType", PlanetParam::DomainWarpFractalType, false },
+    { "DWFractalOctaves", PlanetParam::DWFractalOctaves, false },
+    { "DWFractalLacunarity", PlanetParam::DWFractalLacunarity, true },
+    { "DWFractalGain", PlanetParam::DWFractalGain, true },
+    { "LodStitchEdges", PlanetParam::LodStitchEdges, false },
+    { "InterpolationType", PlanetParam::InterpolationType, false },
+    { "BakeElevation", PlanetParam::BakeElevation, false },
+    { "MeshCache", PlanetParam::MeshCache, false },
+    { "RingDebris", PlanetParam::RingDebris, false },
+    { "RingDebrisCount", PlanetParam::RingDebrisCount, false } };
+
+bool Planet::parseParam(const std::string& strName, const std::string& strValue, PlanetParam& param, uint32_t& value, bool& bFloat)
+{
+    for (auto& name : PlanetParamNames)
+    {
+        if (strName != name.strName)
+            continue;
 
+        char* pEnd = nullptr;
+        if (name.bFloat)
+        {
+            float fValue = std::strtof(strValue.c_str(), &pEnd);
+            std::memcpy(&value, &fValue, sizeof(value));
+        }
+        else
+            value = static_cast<uint32_t>(std::strtol(strValue.c_str(), &pEnd, 10));
+        if (strValue.empty() || *pEnd != '\0')
+            return false;
+
+        param = name.param;
+        bFloat = name.bFloat;
+        return true;
+    }
+    return false;
+}
+
+bool Planet::setParam(const std::string& strName, const std::string& strValue)
+{
+    PlanetParam param;
+    uint32_t value;
+    bool bFloat;
+    if (!parseParam(strName, strValue, param, value, bFloat))
+        return false;
+    setParam(param, value);
     return true;
 }
 
-void Planet::writeDATFile()
+bool Planet::readPlanetFile(const std::string& strPath)
 {
-    FILE* fileDat;
-    fopen_s(&fileDat, "./mesh.dat", "w+");
+    //old text file from before planet.bin, converted the next time the app closes
+    if (!planetFile.open(strPath))
+        return strPath == PlanetFilePath && readLegacyDATFile();
+
+    size_t nSize = 0;
+    auto params = static_cast<const PlanetParamRecord*>(planetFile.getChunk(ChunkParams, &nSize));
+    if (params == nullptr)
+    {
+        planetFile.close();
+        return readLegacyDATFile();
+    }
+
+    //start from the defaults so values missing from older files still have something sensible
+    resetToDefaultValues();
+
+    for (size_t i = 0; i < nSize / sizeof(PlanetParamRecord); i++)
+        setParam(static_cast<PlanetParam>(params[i].key), params[i].value);
+
+    //Biomes
+    auto biomes = static_cast<const BiomeRecord*>(planetFile.getChunk(ChunkBiomes, &nSize));
+    if (biomes != nullptr)
+    {
+        for (size_t i = 0; i < std::min(nSize / sizeof(BiomeRecord), vecBiomes.size()); i++)
+            vecBiomes[i] = Biome(biomes[i].e, Ogre::ColourValue(biomes[i].color[0], biomes[i].color[1], biomes[i].color[2]));
+    }
+
+    //3 rings
+    auto rings = static_cast<const RingRecord*>(planetFile.getChunk(ChunkRings, &nSize));
+    if (rings != nullptr)
+    {
+        for (size_t i = 0; i < std::min(nSize / sizeof(RingRecord), vecRings.size()); i++)
+        {
+            Ring& ring = vecRings[i];
+            ring.bVisible = rings[i].bVisible != 0;
+            ring.fOuterRingDia = rings[i].fOuterRingDia;
+            ring.fInnerThickness = rings[i].fInnerThickness;
+            ring.fPitch = rings[i].fPitch;
+            ring.fYaw = rings[i].fYaw;
+            ring.fRoll = rings[i].fRoll;
+            ring.colorOuter = Ogre::ColourValue(rings[i].colorOuter[0], rings[i].colorOuter[1], rings[i].colorOuter[2]);
+            ring.colorInner = Ogre::ColourValue(rings[i].colorInner[0], rings[i].colorInner[1], rings[i].colorInner[2]);
+        }
+    }
 
-    fprintf_s(fileDat, "%d\n", bAutoLodGeneration);
-    fprintf_s(fileDat, "%d\n", lightType);
+    //baked elevation is used in place of the noise by the first generate(), straight from the mapping
+    //only if it was generated from exactly the parameters loaded above
+    auto elevation = static_cast<const ElevationHeader*>(planetFile.getChunk(ChunkElevation, &nSize));
+    initMeshValues();
+    if (elevation != nullptr && elevation->nSections == nSections && elevation->nFaces == 6 && elevation->hash == getElevationHash() &&
+        nSize == sizeof(ElevationHeader) + 6 * nVertices * sizeof(float))
+        pBakedElevation = reinterpret_cast<const float*>(elevation + 1);
+    else
+        planetFile.close();
 
-    fprintf_s(fileDat, "%d\n", nSections);
-    fprintf_s(fileDat, "%d\n", iDiaMultiplier);
+    return true;
+}
 
-    fprintf_s(fileDat, "%f\n", fPerFrequencyHeight);
-    fprintf_s(fileDat, "%d\n", indexMinBiomeDepth);
-  
-    fprintf_s(fileDat, "%d\n", bDomainWarp);
+bool Planet::readLegacyDATFile()
+{
+    FILE* fileDat = std::fopen("./mesh.dat", "r");
+    if (fileDat == nullptr)
+        return false;
 
-    fprintf_s(fileDat, "%d\n", noiseType);
-    fprintf_s(fileDat, "%d\n", rotationType3D);
-    fprintf_s(fileDat, "%d\n", iSeed);
-    fprintf_s(fileDat, "%f\n", fFrequency);
+    int iType = 0;
+    std::fscanf(fileDat, "%d", &iType);
+    bAutoLodGeneration = iType != 0;
+    std::fscanf(fileDat, "%d", &iType);
+    lightType = iType ? LightType::DIRECTIONAL : LightType::AMBIENT;
+
+    std::fscanf(fileDat, "%d", &iType);
+    nSections = std::clamp(static_cast<size_t>(iType), MinSections, MaxSections);
+    std::fscanf(fileDat, "%d", &iDiaMultiplier);
+    iDiaMultiplier = std::clamp(iDiaMultiplier, MinDiaMultiplier, MaxDiaMultiplier);
+
+    std::fscanf(fileDat, "%f", &fPerFrequencyHeight);
+    fPerFrequencyHeight = std::clamp(fPerFrequencyHeight, 0.01f, 0.5f);
+    std::fscanf(fileDat, "%d", &indexMinBiomeDepth);
+    indexMinBiomeDepth = std::clamp(indexMinBiomeDepth, 0, MaxBiomesIndex);
+
+    std::fscanf(fileDat, "%d", &iType);
+    bDomainWarp = iType != 0;
+
+    //noise
+    std::fscanf(fileDat, "%d", &iType);
+    noiseType = static_cast<FastNoiseLite::NoiseType>(iType);
+    noiseType = noiseType > FastNoiseLite::NoiseType_Value ? FastNoiseLite::NoiseType_Value : noiseType;
+    std::fscanf(fileDat, "%d", &iType);
+    rotationType3D = static_cast<FastNoiseLite::RotationType3D>(iType);
+    rotationType3D = rotationType3D > FastNoiseLite::RotationType3D_ImproveXZPlanes ? FastNoiseLite::RotationType3D_ImproveXZPlanes : rotationType3D;
+    std::fscanf(fileDat, "%d", &iSeed);
+    std::fscanf(fileDat, "%f", &fFrequency);
+
+    std::fscanf(fileDat, "%d", &iType);
+    fractalType = static_cast<FastNoiseLite::FractalType>(iType);
+    fractalType = fractalType > FastNoiseLite::FractalType_PingPong ? FastNoiseLite::FractalType_PingPong : fractalType;
+    std::fscanf(fileDat, "%d", &iOctaves);
+    std::fscanf(fileDat, "%f", &fFractalGain);
+    std::fscanf(fileDat, "%f", &fFractalWeightedStrength);
+    std::fscanf(fileDat, "%f", &fFractalLacunarity);
+    std::fscanf(fileDat, "%f", &fPingPongStrength);
+
+    std::fscanf(fileDat, "%d", &iType);
+    cellularDistanceFunction = static_cast<FastNoiseLite::CellularDistanceFunction> (iType);
+    cellularDistanceFunction = cellularDistanceFunction > FastNoiseLite::CellularDistanceFunction_Hybrid ? FastNoiseLite::CellularDistanceFunction_Hybrid : cellularDistanceFunction;
+    std::fscanf(fileDat, "%d", &iType);
+    cellularReturnType = static_cast<FastNoiseLite::CellularReturnType> (iType);
+    cellularReturnType = cellularReturnType > FastNoiseLite::CellularReturnType_Distance2Div ? FastNoiseLite::CellularReturnType_Distance2Div : cellularReturnType;
+    std::fscanf(fileDat, "%f", &fJitter);
+
+    std::fscanf(fileDat, "%d", &iType);
+    domainWarpType = static_cast<FastNoiseLite::DomainWarpType>(iType);
+    domainWarpType = domainWarpType > FastNoiseLite::DomainWarpType_BasicGrid ? FastNoiseLite::DomainWarpType_BasicGrid : domainWarpType;
+    std::fscanf(fileDat, "%d", &iType);
+    domainWarpRotationType3D = static_cast<FastNoiseLite::RotationType3D>(iType);
+    domainWarpRotationType3D = domainWarpRotationType3D > FastNoiseLite::RotationType3D_ImproveXZPlanes ? FastNoiseLite::RotationType3D_ImproveXZPlanes : domainWarpRotationType3D;
+    std::fscanf(fileDat, "%f", &fDomainWarpAmplitude);
+    std::fscanf(fileDat, "%f", &fDomainWarpFrequency);
+
+    std::fscanf(fileDat, "%d", &iType);
+    domainWarpFractalType = static_cast<FastNoiseLite::FractalType>(iType);
+    domainWarpFractalType = domainWarpFractalType > FastNoiseLite::FractalType_DomainWarpIndependent ? FastNoiseLite::FractalType_DomainWarpIndependent : domainWarpFractalType;
+    std::fscanf(fileDat, "%d", &iDWFractalOctaves);
+    std::fscanf(fileDat, "%f", &fDWFractalLacunarity);
+    std::fscanf(fileDat, "%f", &fDWFractalGain);
+
+    //Biomes
+    interpolationType = InterpolationType::Smooth;
+    Ogre::ColourValue color;
+    float e = 0.f;
+    //the file replaces whatever was loaded or reset before it
+    vecBiomes.clear();
+    for (int i = 0; i <= MaxBiomesIndex; i++)
+    {
+        std::fscanf(fileDat, "%f,%f,%f,%f", &color.r, &color.g, &color.b, &e);
+        vecBiomes.emplace_back(Biome(e, color));
+    }
 
-    fprintf_s(fileDat, "%d\n", fractalType);
-    fprintf_s(fileDat, "%d\n", iOctaves);
-    fprintf_s(fileDat, "%f\n", fFractalGain);
-    fprintf_s(fileDat, "%f\n", fFractalWeightedStrength);
-    fprintf_s(fileDat, "%f\n", fFractalLacunarity);
-    fprintf_s(fileDat, "%f\n", fPingPongStrength);
+    //3 rings
+    vecRings.clear();
+    for (int i = 0; i < 3; i++)
+    {
+        Ring ring;
+        std::fscanf(fileDat, "%d", &iType);
+        ring.bVisible = iType != 0;
+        std::fscanf(fileDat, "%f", &ring.fOuterRingDia);
+        std::fscanf(fileDat, "%f", &ring.fInnerThickness);
+        std::fscanf(fileDat, "%f", &ring.fPitch);
+        std::fscanf(fileDat, "%f", &ring.fYaw);
+        std::fscanf(fileDat, "%f", &ring.fRoll);
+        std::fscanf(fileDat, "%f,%f,%f", &ring.colorOuter.r, &ring.colorOuter.g, &ring.colorOuter.b);
+        std::fscanf(fileDat, "%f,%f,%f", &ring.colorInner.r, &ring.colorInner.g, &ring.colorInner.b);
+        vecRings.emplace_back(ring);
+    }
 
-    fprintf_s(fileDat, "%d\n", cellularDistanceFunction);
-    fprintf_s(fileDat, "%d\n", cellularReturnType);
-    fprintf_s(fileDat, "%f\n", fJitter);
+    std::fclose(fileDat);
+    return true;
+}
 
-    fprintf_s(fileDat, "%d\n", domainWarpType);
-    fprintf_s(fileDat, "%d\n", domainWarpRotationType3D);
-    fprintf_s(fileDat, "%f\n", fDomainWarpAmplitude);
-    fprintf_s(fileDat, "%f\n", fDomainWarpFrequency);
+std::vector<PlanetParamRecord> Planet::getParamRecords() const
+{
+    std::vector<PlanetParamRecord> vecParams;
+    auto addInt = [&vecParams](const PlanetParam key, const int iValue) { vecParams.emplace_back(PlanetParamRecord{ static_cast<uint32_t>(key), static_cast<uint32_t>(iValue) }); };
+    auto addFloat = [&vecParams](const PlanetParam key, const float fValue)
+    {
+        PlanetParamRecord record{ static_cast<uint32_t>(key), 0 };
+        std::memcpy(&record.value, &fValue, sizeof(fValue));
+        vecParams.emplace_back(record);
+    };
+
+    addInt(PlanetParam::AutoLodGeneration, bAutoLodGeneration);
+    addInt(PlanetParam::LodStitchEdges, bLodStitchEdges);
+    addInt(PlanetParam::LightType, static_cast<int>(lightType));
+    addInt(PlanetParam::BakeElevation, bBakeElevation);
+    addInt(PlanetParam::MeshCache, bMeshCache);
+    addInt(PlanetParam::RingDebris, bRingDebris);
+    addInt(PlanetParam::RingDebrisCount, static_cast<int>(nRingDebris));
+
+    addInt(PlanetParam::Sections, static_cast<int>(nSections));
+    addInt(PlanetParam::DiaMultiplier, iDiaMultiplier);
+
+    addFloat(PlanetParam::PerFrequencyHeight, fPerFrequencyHeight);
+    addInt(PlanetParam::MinBiomeDepth, indexMinBiomeDepth);
+    addInt(PlanetParam::InterpolationType, static_cast<int>(interpolationType));
+
+    addInt(PlanetParam::DomainWarp, bDomainWarp);
+
+    addInt(PlanetParam::NoiseType, noiseType);
+    addInt(PlanetParam::RotationType3D, rotationType3D);
+    addInt(PlanetParam::Seed, iSeed);
+    addFloat(PlanetParam::Frequency, fFrequency);
+
+    addInt(PlanetParam::FractalType, fractalType);
+    addInt(PlanetParam::Octaves, iOctaves);
+    addFloat(PlanetParam::FractalGain, fFractalGain);
+    addFloat(PlanetParam::FractalWeightedStrength, fFractalWeightedStrength);
+    addFloat(PlanetParam::FractalLacunarity, fFractalLacunarity);
+    addFloat(PlanetParam::PingPongStrength, fPingPongStrength);
+
+    addInt(PlanetParam::CellularDistanceFunction, cellularDistanceFunction);
+    addInt(PlanetParam::CellularReturnType, cellularReturnType);
+    addFloat(PlanetParam::Jitter, fJitter);
+
+    addInt(PlanetParam::DomainWarpType, domainWarpType);
+    addInt(PlanetParam::DomainWarpRotationType3D, domainWarpRotationType3D);
+    addFloat(PlanetParam::DomainWarpAmplitude, fDomainWarpAmplitude);
+    addFloat(PlanetParam::DomainWarpFrequency, fDomainWarpFrequency);
+
+    addInt(PlanetParam::DomainWarpFractalType, domainWarpFractalType);
+    addInt(PlanetParam::DWFractalOctaves, iDWFractalOctaves);
+    addFloat(PlanetParam::DWFractalLacunarity, fDWFractalLacunarity);
+    addFloat(PlanetParam::DWFractalGain, fDWFractalGain);
+    return vecParams;
+}
 
-    fprintf_s(fileDat, "%d\n", domainWarpFractalType);
-    fprintf_s(fileDat, "%d\n", iDWFractalOctaves);
-    fprintf_s(fileDat, "%f\n", fDWFractalLacunarity);
-    fprintf_s(fileDat, "%f\n", fDWFractalGain);
+void Planet::initHeadlessCopy(const Planet& planet)
+{
+    //the values go through the same records as planet.bin so a new one only has to be added there
+    for (auto& record : planet.getParamRecords())
+        setParam(static_cast<PlanetParam>(record.key), record.value);
+    vecBiomes = planet.vecBiomes;
+    vecRings = planet.vecRings;
+    initHeadless();
+    //the noise and the faces as they were last generated, not the values edited since
+    noise = planet.noise;
+    domainWarp = planet.domainWarp;
+    vecFaceBuffers = planet.vecFaceBuffers;
+    elevationHash = planet.elevationHash;
+}
 
+bool Planet::writePlanetFile()
+{
+    std::vector<PlanetParamRecord> vecParams = getParamRecords();
+    PlanetFileWriter writer;
+    writer.addChunk(ChunkParams, 1, vecParams.data(), vecParams.size() * sizeof(PlanetParamRecord));
 
+    std::vector<BiomeRecord> vecBiomeRecords;
     for (auto& biome : vecBiomes)
-        fprintf_s(fileDat, "%f,%f,%f,%f\n", biome.color.r, biome.color.g, biome.color.b, biome.e);
+        vecBiomeRecords.emplace_back(BiomeRecord{ biome.e, { biome.color.r, biome.color.g, biome.color.b } });
+    writer.addChunk(ChunkBiomes, 1, vecBiomeRecords.data(), vecBiomeRecords.size() * sizeof(BiomeRecord));
 
+    std::vector<RingRecord> vecRingRecords;
     for (auto& ring : vecRings)
     {
-        fprintf_s(fileDat, "%d\n", ring.bVisible);
-        fprintf_s(fileDat, "%f\n", ring.fOuterRingDia);
-        fprintf_s(fileDat, "%f\n", ring.fInnerThickness);
-        fprintf_s(fileDat, "%f\n", ring.fPitch);
-        fprintf_s(fileDat, "%f\n", ring.fYaw);
-        fprintf_s(fileDat, "%f\n", ring.fRoll);
-        fprintf_s(fileDat, "%f,%f,%f\n", ring.colorOuter.r, ring.colorOuter.g, ring.colorOuter.b);
-        fprintf_s(fileDat, "%f,%f,%f\n", ring.colorInner.r, ring.colorInner.g, ring.colorInner.b);
+        vecRingRecords.emplace_back(RingRecord{ ring.bVisible, ring.fOuterRingDia, ring.fInnerThickness, ring.fPitch, ring.fYaw, ring.fRoll,
+            { ring.colorOuter.r, ring.colorOuter.g, ring.colorOuter.b }, { ring.colorInner.r, ring.colorInner.g, ring.colorInner.b } });
     }
+    writer.addChunk(ChunkRings, 1, vecRingRecords.data(), vecRingRecords.size() * sizeof(RingRecord));
 
-    fclose(fileDat);
-}
\ No newline at end of file
+    //elevation of the last generate(), tagged with the parameters it came from so a stale bake is never used
+    if (bBakeElevation && vecFaceBuffers.size() == 6)
+    {
+        std::vector<unsigned char> vecElevation(sizeof(ElevationHeader) + 6 * nVertices * sizeof(float));
+        ElevationHeader header{ static_cast<uint32_t>(nSections), 6, elevationHash };
+        std::memcpy(vecElevation.data(), &header, sizeof(header));
+        for (size_t i = 0; i < 6; i++)
+            std::memcpy(vecElevation.data() + sizeof(header) + i * nVertices * sizeof(float), vecFaceBuffers[i].vecElevations.data(), nVertices * sizeof(float));
+        writer.addChunk(ChunkElevation, 1, vecElevation.data(), vecElevation.size());
+    }
+
+    return writer.write(PlanetFilePath);
+}
@@ -1,15 +1,32 @@
 #pragma once
 #include <Ogre.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "FastNoiseLite.h"
+#include "GridLodBuilder.h"
+#include "PlanetFile.h"
+#include "MeshCache.h"
+#include "RingDebris.h"
 
 constexpr int MaxDiaMultiplier = 50;
 constexpr int MinDiaMultiplier = 4;
 constexpr size_t MaxSections = 250;
 constexpr size_t MinSections = 20;
 constexpr int MaxBiomesIndex = 8;
+constexpr int MaxOctaves = 10;												//fractal octaves of the noise and the domain warp, past that the detail is below a vertex and the noise overflows
 constexpr float MinOuterRingDia = 1.f;
 constexpr float MaxOuterRingDia = 4.f;
+constexpr float RingBandStrength = 0.12f;									//how much darker the bands of a ring get, 0 for a plain gradient
+constexpr float RingBandFrequency = 60.f;									//radians of the band wave across the width of a ring
+constexpr size_t RingVertexFloats = 12;										//position, normal, uv and the inner colour with the inner radius
+constexpr float LodDistancePerUnitError = 1300.f;						//a deviation of 1 unit is about a pixel at this distance (1080p, 45 deg fov)
+constexpr const char* PlanetFilePath = "./planet.bin";
+constexpr float MeshCacheStoreDelay = 1.f;									//seconds the values have to stay after a generate() that missed the mesh cache before it is stored, not every step of a slider drag
 
 enum class Preset
 {
@@ -21,6 +38,7 @@ enum class Preset
 	Ice_Giant,										//uranus/neptune
 	Rusty_Planet									//mars
 };
+constexpr size_t PresetCount = 7;
 
 //biome color interpolation 
 enum class InterpolationType
@@ -53,23 +71,122 @@ struct Biome
 	}
 };
 
+//ids of the values in the parameter chunk, only ever append new ones so older files keep loading
+enum class PlanetParam : uint32_t
+{
+	AutoLodGeneration,
+	LightType,
+	Sections,
+	DiaMultiplier,
+	PerFrequencyHeight,
+	MinBiomeDepth,
+	DomainWarp,
+	NoiseType,
+	RotationType3D,
+	Seed,
+	Frequency,
+	FractalType,
+	Octaves,
+	FractalGain,
+	FractalWeightedStrength,
+	FractalLacunarity,
+	PingPongStrength,
+	CellularDistanceFunction,
+	CellularReturnType,
+	Jitter,
+	DomainWarpType,
+	DomainWarpRotationType3D,
+	DomainWarpAmplitude,
+	DomainWarpFrequency,
+	DomainWarpFractalType,
+	DWFractalOctaves,
+	DWFractalLacunarity,
+	DWFractalGain,
+	LodStitchEdges,
+	InterpolationType,
+	BakeElevation,
+	MeshCache,
+	RingDebris,
+	RingDebrisCount
+};
+
+//one value of the parameter chunk of planet.bin
+struct PlanetParamRecord
+{
+	uint32_t key;															//PlanetParam
+	uint32_t value;															//int or the bits of a float
+};
+
+//cpu side copy of a face after generate(), laid out like its gpu buffers so it can be uploaded or cached as is
+struct FaceBuffers
+{
+	std::vector<float> vecVertices;											//position and normal, 6 floats per vertex
+	std::vector<Ogre::RGBA> vecColours;
+	std::vector<float> vecElevations;										//noise value of every vertex
+	Ogre::AxisAlignedBox box;
+
+	uint64_t getContentHash() const;										//of the positions and colours, the same for any thread count given the same float math
+};
+
+//one face of a mesh cache entry, pointers into the mapped file
+struct CachedFace
+{
+	const float* pVertices;
+	const Ogre::RGBA* pColours;
+	const float* pElevations;
+	Ogre::AxisAlignedBox box;
+};
+
+//ms spent in each stage of the last generate()
+//the face stages are summed over the 6 faces, so with several threads they add up to more than fFacesMs
+struct GenerateTimings
+{
+	double fNormalsMs, fNoiseMs, fDisplacementMs, fColouringMs;
+	double fFacesMs;														//wall time of building or reading all the faces
+	double fRingsMs, fUploadMs, fLodMs;										//0 for headless planets
+	double fTotalMs;
+	bool bMeshCache;														//faces came from the mesh cache, the face stages are 0
+
+	GenerateTimings() :
+		fNormalsMs(0.0), fNoiseMs(0.0), fDisplacementMs(0.0), fColouringMs(0.0), fFacesMs(0.0),
+		fRingsMs(0.0), fUploadMs(0.0), fLodMs(0.0), fTotalMs(0.0), bMeshCache(false)
+	{}
+};
+
+//bytes held by a planet by what they are for
+//the gpu buffers are measured when the planet has meshes and worked out from the resolution when headless
+struct PlanetMemory
+{
+	//cpu
+	size_t nGridBytes;														//default face vertices and indices
+	size_t nRingGridBytes;													//default ring vertices and indices
+	size_t nFaceBufferBytes;												//cpu copy of the 6 faces after generate()
+	size_t nRingBufferBytes;												//scratch the rings are built in and the indices of the visible ones
+	size_t nLodBytes;														//index lists of the lod builder
+	size_t nRingDebrisBytes;												//instances of the debris field and its chunks
+	//gpu
+	size_t nGpuFaceVertexBytes, nGpuFaceIndexBytes;
+	size_t nGpuRingVertexBytes, nGpuRingIndexBytes;
+	size_t nGpuLodIndexBytes;												//shared by the 6 faces
+	size_t nGpuRingDebrisBytes;												//rock lods and the instance buffers of the chunks
+	bool bGpuEstimated;
+
+	size_t getCpuBytes() const { return nGridBytes + nRingGridBytes + nFaceBufferBytes + nRingBufferBytes + nLodBytes + nRingDebrisBytes; }
+	size_t getGpuBytes() const { return nGpuFaceVertexBytes + nGpuFaceIndexBytes + nGpuRingVertexBytes + nGpuRingIndexBytes + nGpuLodIndexBytes + nGpuRingDebrisBytes; }
+};
+
 struct Ring
 {
 	bool bVisible;											//only render if visible
 	float fOuterRingDia, fInnerThickness;												//ring diameter (outer ring) is from 1.f to 3.f wrt planet dia and thickness (inner ring) is 0.f to 1.0f wrt outer ring 
 	float fYaw, fPitch, fRoll;
 	Ogre::ColourValue colorInner, colorOuter;
-	Ogre::MeshPtr mshY, mshNY;								//UNIT_Y / NEGATIVE_UNIT_Y facing mesh faces
-	Ogre::Entity* entityY, *entityNY;
-	Ogre::SceneNode* sceneNodeY, *sceneNodeNY;
 	Ring() :
 		fOuterRingDia(1.f), fInnerThickness(0.15f),
 		colorInner(0.15f, 0.15f, 0.15f),
 		colorOuter(Ogre::ColourValue(0.7f, 0.7f, 0.7f)), 
 		bVisible(false),
-		fYaw(0.f), fPitch(0.f), fRoll(0.f),
-		entityY(nullptr), entityNY(nullptr),
-		sceneNodeY(nullptr), sceneNodeNY(nullptr)
+		fYaw(0.f), fPitch(0.f), fRoll(0.f)
 	{}
 };
 
@@ -78,7 +195,9 @@ class Planet
 	Ogre::SceneManager* mSceneMgr;
 	std::string strName;									//planet name also associated with names of meshes
 	MeshType meshType;										//normal_biome for the primary planet, gradient for the gradient one in the corner viewport, gradient also doesnt have rings
-	Ogre::MaterialPtr material;
+	//both lighting variants are built in init() so switching the light type only swaps the material of the entities
+	Ogre::MaterialPtr materialAmbient, materialSunlight;
+	Ogre::MaterialPtr materialRingAmbient, materialRingSunlight;			//ProcTerra/RingVP and RingFP, double sided
 
 	//sunlight / ambient light	
 	LightType lightType;								//0 is ambient 1 is sunlight, should always be ambient for gradient mesh
@@ -89,14 +208,51 @@ class Planet
 	std::vector<unsigned short> vecIndices;
 	std::vector<Ogre::MeshPtr> vecFaces;					//all 6 faces 
 	std::vector<Ogre::SceneNode*> vecFaceNodes;
+	std::vector<Ogre::Entity*> vecFaceEntities;
+	std::vector<FaceBuffers> vecFaceBuffers;									//all 6 faces after generate(), the elevations are what planet.bin bakes
+	FaceBuffers scratchBuffers;															//rings and the default sphere of a new resolution are uploaded from here
+	uint64_t elevationHash;																//getElevationHash() at the last generate()
+	uint64_t meshCacheHash;																//getMeshHash() of faces that were generated and arent in the mesh cache yet, else 0
+	std::chrono::steady_clock::time_point timeGenerated;								//of the last generate(), the mesh cache store waits for the values to settle
+	GenerateTimings generateTimings;
+	size_t nGenerateCount, nUploadCount;												//calls to generate() and gpu buffer writes so far, for tagging frames
+	MeshCache meshCache;
+	std::future<void> futureMeshCacheStore;												//writeMeshCache() on its own thread, the face buffers and the cache arent touched until it is done
+
+	//planet.bin stays mapped after loading only if it has usable baked elevation, which the first generate() reads in place of the noise
+	PlanetFile planetFile;
+	const float* pBakedElevation;
 
 	//2 faces for the ring meshes	+y and -y
 	size_t nRingVertices, vRingBufCount, iRingBufCount;
 	std::vector<Ogre::Vector3> vecRingVertices;										//starting from outer to inner ring
 	std::vector<unsigned short> vecRingIndices;										//starting from outer to inner ring
+	//a quad per visible ring in one mesh, the fragment program cuts the annulus out of it so all rings take a single draw
+	//vecRingVertices and vecRingIndices are only the tessellated ring of buildRing() for the exporters
+	Ogre::MeshPtr mshRings;
+	Ogre::Entity* entityRings;
+	Ogre::SceneNode* sceneNodeRings;
+	std::vector<unsigned short> vecRingBatchIndices;								//6 per visible ring
+	uint64_t ringsHash;																//getRingsHash() of the uploaded quads
+	RingDebris ringDebris;																//not for headless or gradient planets
+	uint64_t ringDebrisHash;															//of the rings, seed and count it was built from, 0 while off
 
 	FastNoiseLite noise, domainWarp;
 
+	//generate() workers stay alive between calls, they are only restarted when nGenerateThreads changes
+	std::vector<std::thread> vecGenerateWorkers;
+	std::mutex mutexGenerate;
+	std::condition_variable cvGenerateStart, cvGenerateDone;
+	uint64_t nGenerateJob;																//bumped for every generate(), workers wait for it to change
+	size_t nWorkersBusy;
+	bool bStopWorkers;
+	std::atomic<size_t> nNextFace;
+	GenerateTimings faceTimings[6];
+
+	//lod levels subsample the face grid, index buffers are shared by all 6 faces since they have the same grid
+	GridLodBuilder lodBuilder;
+	std::vector<Ogre::HardwareIndexBufferSharedPtr> vecLodIndexBuffers;
+
 public:
 	//Mesh properties
 	////dimensions, vertices and index order for each face of the cube
@@ -111,8 +267,12 @@ public:
 	std::vector<Biome> vecBiomes;
 	InterpolationType interpolationType;																//not for gradient type planet
 	int indexMinBiomeDepth;																				//the index of the biome from which minimum biome height is calculated
-	//auto lod
+	//auto lod, use setAutoLodGeneration() to toggle. lod distances are updated from the error of each level after every generate()
 	bool bAutoLodGeneration;
+	bool bLodStitchEdges;																				//coarse levels keep the full resolution face border so faces at different levels dont crack
+	bool bBakeElevation;																				//save the generated elevation to planet.bin so startup skips the noise
+	bool bMeshCache;																					//reuse faces from ./cache when the same values were stored before
+	size_t nGenerateThreads;																			//faces generate() builds at once, 0 for all cores, 1 when the caller already runs a planet per core
 	//rotation
 	bool bYaw, bPitch, bRoll;
 	float fYaw, fPitch, fRoll;
@@ -139,39 +299,105 @@ public:
 
 	//rings
 	std::vector<Ring> vecRings;
+	bool bRingDebris;																					//instanced rocks through the visible rings, use updateRings() after changing it
+	size_t nRingDebris;																					//rocks per visible ring
 
 	//MAX Sections allowed = 250 or else everything will be destroyed
 	Planet(Ogre::SceneManager* mSceneMgr, MeshType meshType, std::string strName, Ogre::uint32 visibilityMask);
+	~Planet();
 	void init();
-	void update(const float& fDeltaTime);																//planet rotation update etc.
+	void initHeadless();																				//no scene manager, generate() stops at the cpu side face buffers
+	void initHeadlessCopy(const Planet& planet);														//headless with the values and faces of planet, for exporting it on another thread
+	void update(const float& fDeltaTime);																//planet rotation update etc., stores the mesh cache once the values settle
 	void generate();																					//update the planet mesh and generate the planet
 
 	void initMeshValues();																				//set num of vertices, indices etc. 
+	void resetToDefaultValues();																		//noise, biomes and rings
 	void resetToDefaultNoiseValues();																	//reset to default noise values
 	void resetToDefaultBiomeValues();																	//reset to default biome colors
 	void resetToDefaultRingValues();
 
-	bool readDATFile();
-	void writeDATFile();
+	bool readPlanetFile(const std::string& strPath = PlanetFilePath);									//planet.bin, falls back to the old mesh.dat text file
+	bool readLegacyDATFile();
+	bool writePlanetFile();
+	std::vector<PlanetParamRecord> getParamRecords() const;											//every value planet.bin saves except the biomes and rings
+	void storeMeshCache();																				//puts the faces of the last generate() in ./cache if they didnt come from it and waits for it
+	void setParam(const PlanetParam param, const uint32_t value);										//value is an int or the bits of a float, clamped like the gui
+	bool setParam(const std::string& strName, const std::string& strValue);								//by the name of the PlanetParam, false if unknown or not a number
+	static bool parseParam(const std::string& strName, const std::string& strValue, PlanetParam& param, uint32_t& value, bool& bFloat);	//what setParam() reads, before it is clamped
+	uint64_t getElevationHash() const;																	//hash of every parameter the elevation depends on
+	uint64_t getMeshHash() const;																		//hash of every parameter the face buffers depend on, the mesh cache key
+	uint64_t getContentHash() const;																	//of the face buffers of the last generate()
+	const GenerateTimings& getGenerateTimings() const { return generateTimings; };
+	size_t getGenerateCount() const { return nGenerateCount; };
+	size_t getUploadCount() const { return nUploadCount; };
+	PlanetMemory getMemoryUsage() const;
 
 	LightType getLightType() const { return lightType; };
 	FastNoiseLite getNoise() { return noise; };
+	FastNoiseLite getDomainWarp() { return domainWarp; };
+	float getMinDepth() const;																			//elevation below which the surface is flattened, like the ocean floor
+	Ogre::ColourValue getColour(const float e) const;													//vertex colour of a raw elevation, from the biomes or the gradient
+	static Ogre::Quaternion getFaceRotation(const Ogre::Vector3 vFace);									//rotates the default NEGATIVE_UNIT_Y plane onto the face
+	//raw elevation -1 to 1 of a point on the sphere surface, pDomainWarp is null when domain warp is off
+	static float sampleElevation(FastNoiseLite& noise, FastNoiseLite* pDomainWarp, Ogre::Vector3 vPosition);
+	static Ogre::Quaternion getRingOrientation(const Ring& ring);										//applied to the ring vertices, pitch then yaw then roll
+
+	//cpu side mesh data, the planet itself is left untouched so faces can be built at any resolution on several threads
+	//nSections can go past MaxSections since the buffers arent limited to 16 bit indices
+	//pBakedElevation replaces the noise when not null, the time of each stage is added to pTimings when not null
+	void buildFace(FaceBuffers& face, const Ogre::Vector3 vFace, const size_t nSections, FastNoiseLite& noise, FastNoiseLite* pDomainWarp, const float* pBakedElevation, GenerateTimings* pTimings = nullptr) const;
+	void buildRing(FaceBuffers& buffers, const Ring& ring, const Ogre::Vector3 vFace) const;			//UNIT_Y / NEGATIVE_UNIT_Y side, without the ring orientation
+	const std::vector<FaceBuffers>& getFaceBuffers() const { return vecFaceBuffers; };					//UNIT_Y, X, Z, NEGATIVE_UNIT_Y, X, Z after generate()
+	const std::vector<unsigned short>& getRingIndices() const { return vecRingIndices; };
 	void setPreset(const Preset preset);
+	static const char* getPresetName(const Preset preset);												//the enum name, e.g. Blue_Marble
 	void setNoise(const FastNoiseLite fn) { this->noise = fn; };
-	void setLightType(const LightType lightType) { this->lightType = lightType; };
+	void setLightType(const LightType lightType);															//swaps the material of faces and rings right away
+	const Ogre::MaterialPtr& getMaterial() const { return lightType == LightType::AMBIENT ? materialAmbient : materialSunlight; };
+	const Ogre::MaterialPtr& getRingMaterial() const { return lightType == LightType::AMBIENT ? materialRingAmbient : materialRingSunlight; };
+	void updateRings();																					//rebuilds the ring mesh and debris after a ring was changed, without the rest of generate()
+	void destroyRingDebris();																			//before the scene manager is destroyed
+	void buildRings();																					//quads of the visible rings into getRingBuffers() and their indices
+	const FaceBuffers& getRingBuffers() const { return scratchBuffers; };								//RingVertexFloats per vertex after buildRings()
+	static float getRingShade(const float t);															//band brightness 0 at the inner edge to 1 at the outer, same as Ring.frag
+	void setAutoLodGeneration(const bool bAutoLodGeneration);											//takes effect right away, no restart needed
+	void setLodStitchEdges(const bool bLodStitchEdges);
+	void setResolution(const size_t nSections, const int iDiaMultiplier);								//rebuilds the faces and rings in place and regenerates the planet
 	
 private:
+	void createMaterials();
 	void setValuesToNoiseObject();																		//sets the noise varialbes to the FastNoiseLite object
 
 	void createDefaultFaceVerticesAndIndices();															//for both planet mesh and rings	
+	void reserveBuffers();																				//face and scratch buffers for the current resolution, so generate() doesnt allocate
+	void buildFaces();																					//the faces left of this generate(), on the calling thread
+	void startGenerateWorkers(const size_t nWorkers);
+	void stopGenerateWorkers();
+	void runGenerateWorker(uint64_t nJob);
 	//for planet mesh
 	Ogre::MeshPtr createNormalisedFace(const Ogre::Vector3 vFace, const std::string strItem, const std::string strEntity);
-	void updateMesh(const Ogre::Mesh* const mesh, const Ogre::Vector3 vFace);
-	Ogre::ColourValue biomeColorInterpolation(const float& e, std::vector<Biome>::iterator& iter);
+	void fillFaceBuffers(Ogre::Mesh* const msh, const Ogre::Vector3 vFace);								//default sphere vertices and indices for the current resolution
+	void uploadMesh(Ogre::Mesh* const mesh, const FaceBuffers& buffers);								//for faces and rings
+	void uploadMesh(Ogre::Mesh* const mesh, const float* pVertices, const Ogre::RGBA* pColours, const size_t nVertexCount, const Ogre::AxisAlignedBox& box);
+	bool readMeshCache(const uint64_t hash, PlanetFile& file, CachedFace* pFaces);						//maps the entry and checks all 6 faces, pFaces are valid until the file closes
+	void copyCachedFaces(const CachedFace* pFaces);
+	void writeMeshCache(const uint64_t hash);
+	void waitMeshCacheStore();
+	void createLodLevels();																				//builds the lod index buffers and adds them to every face
+	void updateLodDistances();																			//switch distance of each level from its error wrt the current vertices
+	void removeLodLevels();
+	Ogre::ColourValue biomeColorInterpolation(const float& e, std::vector<Biome>::const_iterator& iter) const;
 
 	//for rings
-	Ogre::MeshPtr createRing(const Ogre::Vector3 vFace, Ogre::Entity** entity, Ogre::SceneNode** node, const Ogre::ColourValue colorInner, const Ogre::ColourValue colorOuter, const std::string strItem, const std::string strEntity);
-	void updateRing(const Ogre::Mesh* const mesh, const Ogre::Vector3 vFace, const float fOuterRingDia, const float fInnerThickness, const Ogre::ColourValue colorInner, const Ogre::ColourValue colorOuter);
+	void createRings();																					//the mesh, entity and node of all rings
+	void uploadRings();
+	uint64_t getRingsHash() const;																		//of everything the ring quads depend on
+	void updateRingDebris();																			//rebuilds the debris if it is on and its rings or seed changed
+
+	//pooled gpu buffers, returns the bound buffer if it can hold the count or else a new one that replaces it
+	Ogre::HardwareVertexBufferSharedPtr getVertexBuffer(Ogre::VertexData* const vertexData, const unsigned short source, const size_t nVertexCount);
+	Ogre::HardwareIndexBufferSharedPtr getIndexBuffer(Ogre::IndexData* const indexData, const size_t nIndexCount);
 
 };
 
@@ -0,0 +1,99 @@
+#include "PlanetBenchmark.h"
+#include <OgreDefaultHardwareBufferManager.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+//the stages of one run, in the order they are written
+enum BenchmarkStage { Normals, Noise, Displacement, Colouring, Rings, Upload, Total, StageCount };
+static const char* BenchmarkStageNames[StageCount] = { "normalsMs", "noiseMs", "displacementMs", "colouringMs", "ringsMs", "uploadMs", "totalMs" };
+
+static double getMs(const std::chrono::steady_clock::time_point timeStart)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+}
+
+//what uploadMesh() writes, into a system memory buffer of the same size
+static void uploadBuffers(const FaceBuffers& buffers)
+{
+    Ogre::DefaultHardwareBuffer vertices(buffers.vecVertices.size() * sizeof(float));
+    Ogre::DefaultHardwareBuffer colours(buffers.vecColours.size() * sizeof(Ogre::RGBA));
+    vertices.writeData(0, buffers.vecVertices.size() * sizeof(float), buffers.vecVertices.data(), true);
+    colours.writeData(0, buffers.vecColours.size() * sizeof(Ogre::RGBA), buffers.vecColours.data(), true);
+}
+
+bool PlanetBenchmark::run(const std::string& strOut, const std::vector<size_t>& vecSections, const size_t nRepeats, const size_t nThreads)
+{
+    FILE* file = std::fopen(strOut.c_str(), "w");
+    if (file == nullptr)
+    {
+        std::fprintf(stderr, "cannot open '%s'\n", strOut.c_str());
+        return false;
+    }
+    size_t nUsedThreads = std::clamp<size_t>(nThreads ? nThreads : std::thread::hardware_concurrency(), 1, 6);
+    std::fprintf(file, "{\n  \"threads\": %zu,\n  \"repeats\": %zu,\n  \"runs\": [", nUsedThreads, nRepeats);
+
+    bool bFirst = true;
+    for (size_t p = 0; p < PresetCount; p++)
+    {
+        Preset preset = static_cast<Preset>(p);
+        for (size_t nSections : vecSections)
+        {
+            Planet planet(nullptr, MeshType::NORMAL_BIOMES, "Benchmark", 0);
+            planet.resetToDefaultValues();
+            planet.bMeshCache = false;
+            planet.bBakeElevation = false;
+            planet.nGenerateThreads = nThreads;
+            //headless faces arent limited to 16 bit indices so the sections arent clamped
+            planet.nSections = std::max(nSections, MinSections);
+            planet.initHeadless();
+            //generates once, which warms up the buffers
+            planet.setPreset(preset);
+
+            std::vector<std::array<double, StageCount>> vecRuns;
+            for (size_t r = 0; r < std::max<size_t>(nRepeats, 1); r++)
+            {
+                planet.generate();
+                const GenerateTimings& timings = planet.getGenerateTimings();
+                std::array<double, StageCount> run{ timings.fNormalsMs, timings.fNoiseMs, timings.fDisplacementMs, timings.fColouringMs, 0.0, 0.0, timings.fTotalMs };
+
+                auto timeUpload = std::chrono::steady_clock::now();
+                for (const auto& face : planet.getFaceBuffers())
+                    uploadBuffers(face);
+                run[Upload] = getMs(timeUpload);
+
+                //the quads of the visible rings, generate() only rebuilds them when a ring changed
+                auto timeRing = std::chrono::steady_clock::now();
+                planet.buildRings();
+                run[Rings] = getMs(timeRing);
+                timeUpload = std::chrono::steady_clock::now();
+                uploadBuffers(planet.getRingBuffers());
+                run[Upload] += getMs(timeUpload);
+                run[Total] += run[Rings] + run[Upload];
+                vecRuns.emplace_back(run);
+            }
+
+            //median of every stage on its own
+            double fMedians[StageCount];
+            for (size_t s = 0; s < StageCount; s++)
+            {
+                std::vector<double> vecValues;
+                for (const auto& run : vecRuns)
+                    vecValues.emplace_back(run[s]);
+                std::nth_element(vecValues.begin(), vecValues.begin() + vecValues.size() / 2, vecValues.end());
+                fMedians[s] = vecValues[vecValues.size() / 2];
+            }
+
+            std::fprintf(file, "%s\n    { \"preset\": \"%s\", \"sections\": %zu, \"vertices\": %zu", bFirst ? "" : ",", Planet::getPresetName(preset), planet.nSections, planet.nVertices * 6);
+            for (size_t s = 0; s < StageCount; s++)
+                std::fprintf(file, ", \"%s\": %.3f", BenchmarkStageNames[s], fMedians[s]);
+            std::fprintf(file, " }");
+            bFirst = false;
+            std::printf("%-14s %4zu sections  %9.2f ms\n", Planet::getPresetName(preset), planet.nSections, fMedians[Total]);
+        }
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+    return std::fclose(file) == 0;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Planet.h"
+
+constexpr size_t BenchmarkRepeats = 5;									//generate() runs per preset and resolution after a warm up, the median is reported
+constexpr size_t BenchmarkSections[] = { 20, 50, 100, 150, 200, 250, 400 };	//past MaxSections only headless, like the exporters
+
+//times the whole generate() of every preset at several resolutions without a window or gpu
+//the stages come from Planet::getGenerateTimings(), the rings and the upload that a headless generate() skips are done the same way here,
+//the upload goes into Ogre's system memory buffers so it measures the copy handed to the driver and not the transfer
+class PlanetBenchmark
+{
+public:
+	//writes a json report to strOut, a progress line per run to stdout
+	static bool run(const std::string& strOut, const std::vector<size_t>& vecSections, const size_t nRepeats, const size_t nThreads);
+};
@@ -0,0 +1,547 @@
+#include "PlanetDaemon.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "HeightmapExporter.h"
+#include "MeshExporter.h"
+#include "PlanetStats.h"
+#include "ThumbnailRenderer.h"
+
+constexpr size_t DaemonHeightmapWidth = 2048;
+constexpr size_t DaemonThumbnailWidth = 256;
+
+static volatile std::sig_atomic_t bDaemonStop = 0;
+
+static void stopDaemon(int)
+{
+    bDaemonStop = 1;
+}
+
+//both loop over short reads and writes, false once the other end is gone
+static bool readAll(const int fd, void* pData, const size_t nSize)
+{
+    for (size_t nRead = 0; nRead < nSize; )
+    {
+        ssize_t n = ::recv(fd, static_cast<char*>(pData) + nRead, nSize - nRead, 0);
+        if (n <= 0 && !(n < 0 && errno == EINTR))
+            return false;
+        nRead += std::max<ssize_t>(n, 0);
+    }
+    return true;
+}
+
+static bool writeAll(const int fd, const void* pData, const size_t nSize)
+{
+    for (size_t nWritten = 0; nWritten < nSize; )
+    {
+        ssize_t n = ::send(fd, static_cast<const char*>(pData) + nWritten, nSize - nWritten, MSG_NOSIGNAL);
+        if (n <= 0 && !(n < 0 && errno == EINTR))
+            return false;
+        nWritten += std::max<ssize_t>(n, 0);
+    }
+    return true;
+}
+
+static bool writeResponse(const int fd, const DaemonStatus status, const uint64_t key, const void* pData, const size_t nSize)
+{
+    DaemonResponseHeader header{ status, 0, nSize, key };
+    return writeAll(fd, &header, sizeof(header)) && writeAll(fd, pData, nSize);
+}
+
+//growing buffer behind the stream the exporters write into, it becomes the result
+struct ResultBuffer
+{
+    unsigned char* pData = nullptr;
+    size_t nSize = 0, nCapacity = 0;
+    ~ResultBuffer() { std::free(pData); }
+};
+
+//a failed allocation fails the write and sets the error flag of the stream, open_memstream would drop the bytes silently
+//nothing written is the error, a cookie write must not return a negative count
+static ssize_t writeResultBuffer(void* pCookie, const char* pData, size_t nSize)
+{
+    ResultBuffer& buffer = *static_cast<ResultBuffer*>(pCookie);
+    if (nSize > buffer.nCapacity - buffer.nSize)
+    {
+        size_t nCapacity = std::max<size_t>({ 64 * 1024, buffer.nSize + nSize, buffer.nCapacity * 2 });
+        void* pGrown = std::realloc(buffer.pData, nCapacity);
+        if (pGrown == nullptr)
+            return 0;
+        buffer.pData = static_cast<unsigned char*>(pGrown);
+        buffer.nCapacity = nCapacity;
+    }
+    std::memcpy(buffer.pData + buffer.nSize, pData, nSize);
+    buffer.nSize += nSize;
+    return static_cast<ssize_t>(nSize);
+}
+
+#ifdef __APPLE__
+static int writeResultBufferBSD(void* pCookie, const char* pData, int nSize)
+{
+    ssize_t nWritten = writeResultBuffer(pCookie, pData, static_cast<size_t>(nSize));
+    return nWritten == 0 && nSize > 0 ? -1 : static_cast<int>(nWritten);
+}
+#endif
+
+//the exporters write into a memory stream, its buffer becomes the result without a copy
+template<typename Export>
+static std::shared_ptr<const DaemonResult> exportResult(const Export& exportTo)
+{
+    ResultBuffer buffer;
+#ifdef __APPLE__
+    FILE* file = ::funopen(&buffer, nullptr, writeResultBufferBSD, nullptr, nullptr);
+#else
+    cookie_io_functions_t functions = { nullptr, writeResultBuffer, nullptr, nullptr };
+    FILE* file = ::fopencookie(&buffer, "w", functions);
+#endif
+    if (file == nullptr)
+        return nullptr;
+    //an exporter that throws leaves the stream to be closed here before the buffer goes
+    struct CloseFile { FILE* file; ~CloseFile() { if (file != nullptr) std::fclose(file); } } closeFile = { file };
+    bool bWritten = exportTo(file);
+    bWritten = std::fflush(file) == 0 && !std::ferror(file) && bWritten;
+    closeFile.file = nullptr;
+    bWritten = std::fclose(file) == 0 && bWritten;
+    if (!bWritten)
+        return nullptr;
+    auto pResult = std::make_shared<const DaemonResult>(buffer.pData, buffer.nSize);
+    buffer.pData = nullptr;
+    return pResult;
+}
+
+DaemonResult::DaemonResult(void* pData, const size_t nSize) :
+    pData(static_cast<unsigned char*>(pData)),
+    nSize(nSize)
+{
+}
+
+DaemonResult::~DaemonResult()
+{
+    std::free(pData);
+}
+
+DaemonResultCache::DaemonResultCache(const size_t nBudget) :
+    nBudget(nBudget),
+    nBytes(0)
+{
+}
+
+DaemonResultCache::Result DaemonResultCache::get(const uint64_t key)
+{
+    auto it = mapResults.find(key);
+    if (it == mapResults.end())
+        return nullptr;
+    listResults.splice(listResults.begin(), listResults, it->second);
+    return it->second->second;
+}
+
+void DaemonResultCache::put(const uint64_t key, const Result& result)
+{
+    if (result->size() > nBudget || mapResults.count(key))
+        return;
+    listResults.emplace_front(key, result);
+    mapResults[key] = listResults.begin();
+    nBytes += result->size();
+    while (nBytes > nBudget)
+    {
+        nBytes -= listResults.back().second->size();
+        mapResults.erase(listResults.back().first);
+        listResults.pop_back();
+    }
+}
+
+PlanetDaemon::PlanetDaemon(const std::string& strPlanetFile, const std::vector<std::string>& vecParams, const size_t nCacheBudget) :
+    strPlanetFile(strPlanetFile),
+    vecParams(vecParams),
+    cache(nCacheBudget),
+    nRequests(0),
+    nHits(0),
+    nCoalesced(0),
+    bStop(false)
+{
+}
+
+PlanetDaemon::~PlanetDaemon()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexJobs);
+        bStop = true;
+    }
+    cvJobs.notify_all();
+    for (auto& worker : vecWorkers)
+        worker.join();
+}
+
+bool PlanetDaemon::applyJSON(Planet& planet, const std::string& strJSON, std::string& strError)
+{
+    //a flat object of names and numbers, strings or booleans, nothing nested
+    size_t i = 0;
+    auto skipSpace = [&]() { while (i < strJSON.size() && std::isspace(static_cast<unsigned char>(strJSON[i]))) i++; };
+    auto readString = [&](std::string& str)
+    {
+        if (i >= strJSON.size() || strJSON[i] != '"')
+            return false;
+        size_t nEnd = strJSON.find('"', i + 1);
+        if (nEnd == std::string::npos)
+            return false;
+        str = strJSON.substr(i + 1, nEnd - i - 1);
+        i = nEnd + 1;
+        return true;
+    };
+
+    skipSpace();
+    if (i >= strJSON.size() || strJSON[i++] != '{')
+    {
+        strError = "parameters are not a json object";
+        return false;
+    }
+    skipSpace();
+    if (i < strJSON.size() && strJSON[i] == '}')
+        return true;
+
+    while (i < strJSON.size())
+    {
+        std::string strName, strValue;
+        skipSpace();
+        if (!readString(strName))
+            break;
+        skipSpace();
+        if (i >= strJSON.size() || strJSON[i++] != ':')
+            break;
+        skipSpace();
+        if (!readString(strValue))
+        {
+            size_t nEnd = std::min(strJSON.find_first_of(",}", i), strJSON.size());
+            strValue = strJSON.substr(i, nEnd - i);
+            strValue.erase(strValue.find_last_not_of(" \t\r\n") + 1);
+            i = nEnd;
+        }
+        if (strValue == "true" || strValue == "false")
+            strValue = strValue == "true" ? "1" : "0";
+        if (!planet.setParam(strName, strValue))
+        {
+            strError = "invalid parameter '" + strName + "'";
+            return false;
+        }
+
+        skipSpace();
+        if (i < strJSON.size() && strJSON[i] == ',')
+            i++;
+        else if (i < strJSON.size() && strJSON[i] == '}')
+            return true;
+        else
+            break;
+    }
+    strError = "malformed json";
+    return false;
+}
+
+bool PlanetDaemon::initBase(Planet& planet, std::string& strError) const
+{
+    if (strPlanetFile.empty())
+        planet.resetToDefaultValues();
+    else if (!planet.readPlanetFile(strPlanetFile))
+    {
+        strError = "cannot read '" + strPlanetFile + "'";
+        return false;
+    }
+
+    for (auto& strAssignment : vecParams)
+    {
+        size_t nEquals = strAssignment.find('=');
+        if (nEquals == std::string::npos || !planet.setParam(strAssignment.substr(0, nEquals), strAssignment.substr(nEquals + 1)))
+        {
+            strError = "invalid parameter '" + strAssignment + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PlanetDaemon::initPlanet(Planet& planet, const DaemonRequestHeader& header, const std::vector<unsigned char>& vecParamsData, std::string& strError) const
+{
+    if (!initBase(planet, strError))
+        return false;
+
+    if (header.paramFormat == DaemonParamFormat::JSON)
+    {
+        if (!applyJSON(planet, std::string(vecParamsData.begin(), vecParamsData.end()), strError))
+            return false;
+    }
+    else if (header.paramFormat == DaemonParamFormat::Binary && vecParamsData.size() % sizeof(DaemonParamRecord) == 0)
+    {
+        for (size_t i = 0; i < vecParamsData.size(); i += sizeof(DaemonParamRecord))
+        {
+            DaemonParamRecord record;
+            std::memcpy(&record, vecParamsData.data() + i, sizeof(record));
+            planet.setParam(static_cast<PlanetParam>(record.key), record.value);
+        }
+    }
+    else
+    {
+        strError = "invalid parameter format";
+        return false;
+    }
+
+    //results are kept in memory, nothing is written next to the daemon, and the workers already keep the cores busy
+    planet.bMeshCache = false;
+    planet.bBakeElevation = false;
+    planet.nGenerateThreads = 1;
+    return true;
+}
+
+PlanetDaemon::Result PlanetDaemon::generate(Planet& planet, const DaemonRequestHeader& header) const
+{
+    auto timeStart = std::chrono::steady_clock::now();
+    planet.initHeadless();
+    planet.generate();
+
+    size_t nSections = header.nSections ? header.nSections : planet.nSections;
+    switch (header.output)
+    {
+    case DaemonOutput::Stats:
+    {
+        PlanetStats stats = PlanetStats::compute(planet);
+        stats.fGenerateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count();
+        std::string strJson = stats.toJson();
+        return exportResult([&](FILE* file) { return std::fwrite(strJson.data(), 1, strJson.size(), file) == strJson.size(); });
+    }
+    case DaemonOutput::PLY:
+    case DaemonOutput::GLB:
+    {
+        MeshFormat format = header.output == DaemonOutput::PLY ? MeshFormat::PLY : MeshFormat::GLB;
+        MeshExporter meshExporter(planet);
+        return exportResult([&](FILE* file) { return meshExporter.exportMesh(file, format, nSections); });
+    }
+    case DaemonOutput::Heightmap:
+    {
+        size_t nWidth = header.nWidth ? header.nWidth : DaemonHeightmapWidth;
+        HeightmapExporter heightmapExporter(planet);
+        return exportResult([&](FILE* file) { return heightmapExporter.exportHeightmap(file, HeightmapFormat::PNG16, nWidth, std::max<size_t>(1, nWidth / 2)); });
+    }
+    case DaemonOutput::Thumbnail:
+    {
+        //the workers already keep the cores busy
+        ThumbnailSettings thumbnailSettings;
+        thumbnailSettings.nWidth = thumbnailSettings.nHeight = header.nWidth ? header.nWidth : DaemonThumbnailWidth;
+        thumbnailSettings.nThreads = 1;
+        ThumbnailRenderer thumbnail(planet);
+        thumbnail.render(thumbnailSettings);
+        return exportResult([&](FILE* file) { return thumbnail.write(file, ThumbnailFormat::PNG); });
+    }
+    }
+    return nullptr;
+}
+
+PlanetDaemon::Result PlanetDaemon::request(std::unique_ptr<Planet> pPlanet, const DaemonRequestHeader& header, const uint64_t key)
+{
+    std::shared_future<Result> future;
+    {
+        std::lock_guard<std::mutex> lock(mutexResults);
+        nRequests++;
+        if (Result result = cache.get(key))
+        {
+            nHits++;
+            return result;
+        }
+
+        //the first request for a key generates it, the ones arriving before it is done wait on the same future
+        auto it = mapPending.find(key);
+        if (it != mapPending.end())
+        {
+            nCoalesced++;
+            future = it->second;
+        }
+        else
+        {
+            auto pPromise = std::make_shared<std::promise<Result>>();
+            future = pPromise->get_future().share();
+            mapPending.emplace(key, future);
+            std::shared_ptr<Planet> pShared(std::move(pPlanet));
+            {
+                std::lock_guard<std::mutex> lockJobs(mutexJobs);
+                queueJobs.emplace([this, pShared, pPromise, header, key]()
+                {
+                    //a request too large for the memory left fails on its own, the daemon and the requests waiting on it carry on
+                    Result result;
+                    try
+                    {
+                        result = generate(*pShared, header);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        std::fprintf(stderr, "%016llx failed: %s\n", static_cast<unsigned long long>(key), e.what());
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(mutexResults);
+                        if (result)
+                            cache.put(key, result);
+                        mapPending.erase(key);
+                    }
+                    pPromise->set_value(result);
+                });
+            }
+            cvJobs.notify_one();
+        }
+    }
+    return future.get();
+}
+
+void PlanetDaemon::handleConnection(const int fd)
+{
+    DaemonRequestHeader header;
+    while (readAll(fd, &header, sizeof(header)))
+    {
+        std::vector<unsigned char> vecParamsData(std::min<size_t>(header.nParamsSize, DaemonMaxParamsSize));
+        if (header.magic != DaemonRequestMagic || header.nParamsSize > DaemonMaxParamsSize || !readAll(fd, vecParamsData.data(), vecParamsData.size()))
+        {
+            const char strError[] = "bad request";
+            writeResponse(fd, DaemonStatus::BadRequest, 0, strError, sizeof(strError) - 1);
+            break;
+        }
+
+        auto timeStart = std::chrono::steady_clock::now();
+        auto pPlanet = std::make_unique<Planet>(nullptr, MeshType::NORMAL_BIOMES, "Daemon", 0);
+        std::string strError;
+        if (header.output > DaemonOutput::Thumbnail)
+            strError = "invalid output";
+        else if (header.nSections != 0 && (header.nSections < MinSections || header.nSections > DaemonMaxSections))
+            strError = "sections out of range";
+        else if (header.nWidth > DaemonMaxWidth)
+            strError = "width out of range";
+        if (!strError.empty() || !initPlanet(*pPlanet, header, vecParamsData, strError))
+        {
+            if (!writeResponse(fd, DaemonStatus::BadRequest, 0, strError.data(), strError.size()))
+                break;
+            continue;
+        }
+
+        //the same parameters give the same face buffers, the rest is what the request turns them into
+        uint64_t key = pPlanet->getMeshHash();
+        uint32_t nSections = header.nSections ? header.nSections : static_cast<uint32_t>(pPlanet->nSections);
+        for (uint32_t value : { static_cast<uint32_t>(header.output), nSections, header.nWidth })
+            key = fnv1a(&value, sizeof(value), key);
+
+        Result result = request(std::move(pPlanet), header, key);
+        std::printf("%016llx %s in %.1f ms\n", static_cast<unsigned long long>(key), result ? "served" : "failed",
+            std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeStart).count());
+        bool bWritten = result ? writeResponse(fd, DaemonStatus::OK, key, result->data(), result->size()) :
+            writeResponse(fd, DaemonStatus::Failed, key, "generation failed", 17);
+        if (!bWritten)
+            break;
+    }
+    ::close(fd);
+}
+
+bool PlanetDaemon::run(const std::string& strSocketPath, const size_t nJobs)
+{
+    //every request starts from the base, a bad one would fail all of them so the daemon doesnt start
+    {
+        Planet planet(nullptr, MeshType::NORMAL_BIOMES, "Daemon", 0);
+        std::string strError;
+        if (!initBase(planet, strError))
+        {
+            std::fprintf(stderr, "%s\n", strError.c_str());
+            return false;
+        }
+    }
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (strSocketPath.size() >= sizeof(address.sun_path))
+    {
+        std::fprintf(stderr, "socket path too long\n");
+        return false;
+    }
+    std::memcpy(address.sun_path, strSocketPath.c_str(), strSocketPath.size() + 1);
+
+    //a socket left over from a daemon that didnt shut down cleanly would fail the bind
+    ::unlink(strSocketPath.c_str());
+    int fdListen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fdListen < 0 || ::bind(fdListen, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(fdListen, SOMAXCONN) != 0)
+    {
+        std::fprintf(stderr, "cannot listen on '%s': %s\n", strSocketPath.c_str(), std::strerror(errno));
+        if (fdListen >= 0)
+            ::close(fdListen);
+        return false;
+    }
+
+    size_t nWorkers = std::max<size_t>(1, nJobs ? nJobs : std::thread::hardware_concurrency());
+    for (size_t i = 0; i < nWorkers; i++)
+    {
+        vecWorkers.emplace_back([this]()
+        {
+            for (;;)
+            {
+                std::function<void()> job;
+                {
+                    std::unique_lock<std::mutex> lock(mutexJobs);
+                    cvJobs.wait(lock, [this]() { return bStop || !queueJobs.empty(); });
+                    if (queueJobs.empty())
+                        return;
+                    job = std::move(queueJobs.front());
+                    queueJobs.pop();
+                }
+                job();
+            }
+        });
+    }
+
+    //any thread can get the signal so the listening socket is polled rather than waiting in accept() for it to be interrupted
+    std::signal(SIGINT, stopDaemon);
+    std::signal(SIGTERM, stopDaemon);
+    std::printf("listening on %s with %zu workers\n", strSocketPath.c_str(), nWorkers);
+    std::fflush(stdout);
+
+    //connections that finished are joined as new ones arrive, the rest are shut down on exit
+    struct Connection
+    {
+        int fd;
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> pDone;
+    };
+    std::list<Connection> listConnections;
+    while (!bDaemonStop)
+    {
+        pollfd pollListen{ fdListen, POLLIN, 0 };
+        int fd = ::poll(&pollListen, 1, 250) > 0 ? ::accept(fdListen, nullptr, nullptr) : -1;
+        for (auto it = listConnections.begin(); it != listConnections.end(); )
+        {
+            if (!*it->pDone)
+            {
+                ++it;
+                continue;
+            }
+            it->thread.join();
+            it = listConnections.erase(it);
+        }
+        if (fd < 0)
+            continue;
+
+        auto pDone = std::make_shared<std::atomic<bool>>(false);
+        listConnections.push_back({ fd, std::thread([this, fd, pDone]() { handleConnection(fd); *pDone = true; }), pDone });
+    }
+
+    ::close(fdListen);
+    ::unlink(strSocketPath.c_str());
+    for (auto& connection : listConnections)
+    {
+        if (!*connection.pDone)
+            ::shutdown(connection.fd, SHUT_RDWR);
+        connection.thread.join();
+    }
+    std::printf("%llu requests, %llu from the cache, %llu coalesced, %zu bytes cached\n", static_cast<unsigned long long>(nRequests),
+        static_cast<unsigned long long>(nHits), static_cast<unsigned long long>(nCoalesced), cache.getBytes());
+    return true;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "Planet.h"
+#include "PlanetFile.h"
+
+constexpr size_t DaemonCacheBudget = 256ull * 1024 * 1024;					//bytes of results kept in memory before the least recently used are dropped
+constexpr size_t DaemonMaxParamsSize = 64 * 1024;
+constexpr size_t DaemonMaxSections = 1024;									//a glb of 1024 sections is about 250 MB, the result is held in memory while it is sent
+constexpr size_t DaemonMaxWidth = 16384;
+constexpr uint32_t DaemonRequestMagic = makeChunkId('P', 'T', 'R', 'Q');
+
+//what a request gets back
+enum class DaemonOutput : uint32_t
+{
+	Stats,															//PlanetStats json
+	PLY,
+	GLB,
+	Heightmap,														//equirectangular 16 bit png, nWidth by nWidth / 2
+	Thumbnail														//png, nWidth square
+};
+
+enum class DaemonParamFormat : uint32_t
+{
+	JSON,															//{"Seed":42,"Frequency":0.8}, names as in Planet::setParam()
+	Binary															//array of DaemonParamRecord
+};
+
+enum class DaemonStatus : uint32_t
+{
+	OK,
+	BadRequest,
+	Failed
+};
+
+//a connection sends any number of requests, each is the header then nParamsSize bytes of parameters, little endian
+//every parameter is applied on top of the planet the daemon was started with
+struct DaemonRequestHeader
+{
+	uint32_t magic;
+	DaemonOutput output;
+	DaemonParamFormat paramFormat;
+	uint32_t nParamsSize;
+	uint32_t nSections;												//mesh sections, 0 for the planet's own
+	uint32_t nWidth;												//heightmap and thumbnail width, 0 for the default
+};
+
+struct DaemonParamRecord
+{
+	uint32_t key;													//PlanetParam
+	uint32_t value;													//int or the bits of a float, like planet.bin
+};
+
+//answer to every request, followed by nSize bytes of the result or an error message
+struct DaemonResponseHeader
+{
+	DaemonStatus status;
+	uint32_t reserved;
+	uint64_t nSize;
+	uint64_t key;													//cache key of the result
+};
+
+//bytes of a result, the malloc'd buffer of the memory stream the exporters wrote is taken over without a copy
+class DaemonResult
+{
+	unsigned char* pData;
+	size_t nSize;
+
+public:
+	DaemonResult(void* pData, const size_t nSize);								//takes ownership of a malloc'd buffer
+	~DaemonResult();
+	DaemonResult(const DaemonResult&) = delete;
+	DaemonResult& operator=(const DaemonResult&) = delete;
+
+	const unsigned char* data() const { return pData; }
+	size_t size() const { return nSize; }
+};
+
+//results in memory, least recently used first out once the total goes past the budget
+class DaemonResultCache
+{
+	using Result = std::shared_ptr<const DaemonResult>;
+	size_t nBudget, nBytes;
+	std::list<std::pair<uint64_t, Result>> listResults;							//most recently used first
+	std::unordered_map<uint64_t, std::list<std::pair<uint64_t, Result>>::iterator> mapResults;
+
+public:
+	DaemonResultCache(const size_t nBudget);
+	Result get(const uint64_t key);												//nullptr on a miss
+	void put(const uint64_t key, const Result& result);							//results larger than the whole budget arent kept
+	size_t getBytes() const { return nBytes; }
+};
+
+//serves generation requests over a unix domain socket
+//connections are handled on their own threads, planets are generated on a fixed pool of workers
+//identical requests in flight at the same time share one generation
+class PlanetDaemon
+{
+	using Result = std::shared_ptr<const DaemonResult>;
+
+	std::string strPlanetFile;														//base values, defaults when empty
+	std::vector<std::string> vecParams;												//Name=Value on top of the base
+
+	std::mutex mutexResults;
+	DaemonResultCache cache;
+	std::unordered_map<uint64_t, std::shared_future<Result>> mapPending;
+	uint64_t nRequests, nHits, nCoalesced;
+
+	std::mutex mutexJobs;
+	std::condition_variable cvJobs;
+	std::queue<std::function<void()>> queueJobs;
+	std::vector<std::thread> vecWorkers;
+	bool bStop;
+
+	bool initBase(Planet& planet, std::string& strError) const;						//the planet file and the parameters every request starts from
+	bool initPlanet(Planet& planet, const DaemonRequestHeader& header, const std::vector<unsigned char>& vecParamsData, std::string& strError) const;
+	static bool applyJSON(Planet& planet, const std::string& strJSON, std::string& strError);
+	Result generate(Planet& planet, const DaemonRequestHeader& header) const;
+	Result request(std::unique_ptr<Planet> pPlanet, const DaemonRequestHeader& header, const uint64_t key);
+	void handleConnection(const int fd);
+
+public:
+	PlanetDaemon(const std::string& strPlanetFile, const std::vector<std::string>& vecParams, const size_t nCacheBudget = DaemonCacheBudget);
+	~PlanetDaemon();
+	PlanetDaemon(const PlanetDaemon&) = delete;
+	PlanetDaemon& operator=(const PlanetDaemon&) = delete;
+
+	//blocks until SIGINT or SIGTERM, false if the base values are invalid or the socket couldnt be created
+	bool run(const std::string& strSocketPath, const size_t nJobs);
+};
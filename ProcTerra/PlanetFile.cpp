@@ -0,0 +1,223 @@
+#include "PlanetFile.h"
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+uint32_t crc32(const void* pData, const size_t nSize, const uint32_t crc)
+{
+    //reflected 0xEDB88320 polynomial, same as zlib
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }();
+
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+    uint32_t c = ~crc;
+    for (size_t i = 0; i < nSize; i++)
+        c = table[(c ^ p[i]) & 0xFF] ^ (c >> 8);
+    return ~c;
+}
+
+uint64_t fnv1a(const void* pData, const size_t nSize, const uint64_t hash)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+    uint64_t h = hash;
+    for (size_t i = 0; i < nSize; i++)
+        h = (h ^ p[i]) * 1099511628211ull;
+    return h;
+}
+
+PlanetFile::PlanetFile() :
+    pData(nullptr),
+    nSize(0),
+    pChunks(nullptr),
+    nChunks(0),
+#ifdef _WIN32
+    hFile(INVALID_HANDLE_VALUE),
+    hMapping(nullptr)
+#else
+    fd(-1)
+#endif
+{
+}
+
+PlanetFile::~PlanetFile()
+{
+    close();
+}
+
+bool PlanetFile::open(const std::string& strPath)
+{
+    close();
+
+#ifdef _WIN32
+    hFile = CreateFileA(strPath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(PlanetFileHeader)))
+    {
+        close();
+        return false;
+    }
+    nSize = static_cast<size_t>(size.QuadPart);
+    hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping == nullptr)
+    {
+        close();
+        return false;
+    }
+    pData = static_cast<const unsigned char*>(MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0));
+    if (pData == nullptr)
+    {
+        close();
+        return false;
+    }
+#else
+    fd = ::open(strPath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(PlanetFileHeader)))
+    {
+        close();
+        return false;
+    }
+    nSize = static_cast<size_t>(st.st_size);
+    void* pMapping = mmap(nullptr, nSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMapping == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    pData = static_cast<const unsigned char*>(pMapping);
+#endif
+
+    //header and chunk table have to be intact, the chunks themselves are checked when they are asked for
+    const PlanetFileHeader* header = reinterpret_cast<const PlanetFileHeader*>(pData);
+    size_t nTableSize = static_cast<size_t>(header->nChunks) * sizeof(PlanetFileChunk);
+    if (header->magic != PlanetFileMagic || header->version > PlanetFileVersion ||
+        nTableSize > nSize - sizeof(PlanetFileHeader) ||
+        crc32(pData + sizeof(PlanetFileHeader), nTableSize) != header->crcTable)
+    {
+        close();
+        return false;
+    }
+    pChunks = reinterpret_cast<const PlanetFileChunk*>(pData + sizeof(PlanetFileHeader));
+    nChunks = header->nChunks;
+    return true;
+}
+
+void PlanetFile::close()
+{
+#ifdef _WIN32
+    if (pData != nullptr)
+        UnmapViewOfFile(pData);
+    if (hMapping != nullptr)
+        CloseHandle(hMapping);
+    if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+    hFile = INVALID_HANDLE_VALUE;
+    hMapping = nullptr;
+#else
+    if (pData != nullptr)
+        munmap(const_cast<unsigned char*>(pData), nSize);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+    pData = nullptr;
+    nSize = 0;
+    pChunks = nullptr;
+    nChunks = 0;
+}
+
+const void* PlanetFile::getChunk(const uint32_t id, size_t* nChunkSize, uint32_t* chunkVersion) const
+{
+    for (uint32_t i = 0; i < nChunks; i++)
+    {
+        const PlanetFileChunk& chunk = pChunks[i];
+        if (chunk.id != id)
+            continue;
+
+        if (chunk.offset > nSize || chunk.size > nSize - chunk.offset || chunk.offset % PlanetFileAlignment != 0)
+            return nullptr;
+        const unsigned char* pChunk = pData + chunk.offset;
+        if (crc32(pChunk, static_cast<size_t>(chunk.size)) != chunk.crc)
+            return nullptr;
+
+        *nChunkSize = static_cast<size_t>(chunk.size);
+        if (chunkVersion != nullptr)
+            *chunkVersion = chunk.version;
+        return pChunk;
+    }
+    return nullptr;
+}
+
+void PlanetFileWriter::addChunk(const uint32_t id, const uint32_t version, const void* pData, const size_t nSize)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(pData);
+    vecChunks.emplace_back(Chunk{ id, version, std::vector<unsigned char>(p, p + nSize) });
+}
+
+bool PlanetFileWriter::write(const std::string& strPath) const
+{
+    auto align = [](const uint64_t offset) { return (offset + PlanetFileAlignment - 1) / PlanetFileAlignment * PlanetFileAlignment; };
+
+    std::vector<PlanetFileChunk> vecTable;
+    vecTable.reserve(vecChunks.size());
+    uint64_t offset = align(sizeof(PlanetFileHeader) + vecChunks.size() * sizeof(PlanetFileChunk));
+    for (auto& chunk : vecChunks)
+    {
+        vecTable.emplace_back(PlanetFileChunk{ chunk.id, chunk.version, offset, chunk.vecData.size(), crc32(chunk.vecData.data(), chunk.vecData.size()), 0 });
+        offset = align(offset + chunk.vecData.size());
+    }
+
+    PlanetFileHeader header{ PlanetFileMagic, PlanetFileVersion, static_cast<uint32_t>(vecTable.size()), crc32(vecTable.data(), vecTable.size() * sizeof(PlanetFileChunk)) };
+
+    //write next to the old file and swap it in, a crash halfway through never leaves a broken planet file behind
+    std::string strTempPath = strPath + ".tmp";
+    FILE* file = std::fopen(strTempPath.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    static const unsigned char padding[PlanetFileAlignment] = {};
+    bool bWritten = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        (vecTable.empty() || std::fwrite(vecTable.data(), sizeof(PlanetFileChunk), vecTable.size(), file) == vecTable.size());
+    uint64_t written = sizeof(header) + vecTable.size() * sizeof(PlanetFileChunk);
+    for (size_t i = 0; i < vecChunks.size() && bWritten; i++)
+    {
+        bWritten = std::fwrite(padding, 1, static_cast<size_t>(vecTable[i].offset - written), file) == vecTable[i].offset - written &&
+            std::fwrite(vecChunks[i].vecData.data(), 1, vecChunks[i].vecData.size(), file) == vecChunks[i].vecData.size();
+        written = vecTable[i].offset + vecChunks[i].vecData.size();
+    }
+    bWritten = std::fclose(file) == 0 && bWritten;
+
+    std::error_code error;
+    if (bWritten)
+        std::filesystem::rename(strTempPath, strPath, error);
+    if (!bWritten || error)
+    {
+        std::filesystem::remove(strTempPath, error);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//planet.bin layout, little endian
+//header | chunk table | chunk payloads, each payload starts on a 16 byte boundary so float arrays can be used straight from the mapping
+//every chunk carries its own version and crc32, readers skip chunks they dont know and keep defaults for chunks that are missing
+constexpr uint32_t PlanetFileMagic = 0x52455450;							//"PTER"
+constexpr uint32_t PlanetFileVersion = 1;
+constexpr size_t PlanetFileAlignment = 16;
+
+constexpr uint32_t makeChunkId(const char a, const char b, const char c, const char d)
+{
+	return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 | static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+}
+
+struct PlanetFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nChunks;
+	uint32_t crcTable;														//crc32 of the chunk table
+};
+
+struct PlanetFileChunk
+{
+	uint32_t id;
+	uint32_t version;
+	uint64_t offset;														//from the start of the file
+	uint64_t size;
+	uint32_t crc;
+	uint32_t reserved;
+};
+
+uint32_t crc32(const void* pData, const size_t nSize, const uint32_t crc = 0);
+uint64_t fnv1a(const void* pData, const size_t nSize, const uint64_t hash = 14695981039346656037ull);		//to tag data with the parameters it was built from
+
+//read only view of a planet file, the file is memory mapped so chunks are returned as pointers into the mapping without copying
+class PlanetFile
+{
+	const unsigned char* pData;
+	size_t nSize;
+	const PlanetFileChunk* pChunks;
+	uint32_t nChunks;
+#ifdef _WIN32
+	void* hFile, *hMapping;
+#else
+	int fd;
+#endif
+
+public:
+	PlanetFile();
+	~PlanetFile();
+	PlanetFile(const PlanetFile&) = delete;
+	PlanetFile& operator=(const PlanetFile&) = delete;
+
+	bool open(const std::string& strPath);									//maps the file and validates the header and chunk table, false if missing or corrupt
+	void close();
+	bool isOpen() const { return pData != nullptr; }
+
+	//pointer to the payload of the chunk or nullptr if it doesnt exist or fails its checksum
+	//only valid until close()
+	const void* getChunk(const uint32_t id, size_t* nChunkSize, uint32_t* chunkVersion = nullptr) const;
+};
+
+//collects chunks in memory and writes them out in one go, the file is replaced only once it has been written completely
+class PlanetFileWriter
+{
+	struct Chunk
+	{
+		uint32_t id, version;
+		std::vector<unsigned char> vecData;
+	};
+	std::vector<Chunk> vecChunks;
+
+public:
+	void addChunk(const uint32_t id, const uint32_t version, const void* pData, const size_t nSize);
+	bool write(const std::string& strPath) const;
+};
@@ -0,0 +1,59 @@
+#include "PlanetRegression.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+//regenerate with ProcTerraBatch --regression-print after a change that is meant to alter the planets, and bump MeshCacheVersion too
+const PresetHashes PlanetRegression::GoldenHashes[PresetCount] = {
+    { Preset::Swift_Planet, "Swift_Planet", { 0x2a9f2006f10fea30ull, 0x7cec98c4fcd9f81eull, 0x2805481b8c8c3ae6ull, 0x604f38ce76060e07ull, 0xda54f0aeff87147cull, 0x28e3235907096d3eull } },
+    { Preset::Evening_Star, "Evening_Star", { 0x2dd6742df7e766ccull, 0x6688ee91e5eb96a3ull, 0x4ad382a90f733b3dull, 0x662dc5218e0f2412ull, 0xf260f0dc2cda5f2bull, 0x0a1426d96de3fbb3ull } },
+    { Preset::Rocky_Moon, "Rocky_Moon", { 0x8df019353e4003a1ull, 0xf316583274c8a0d9ull, 0x581fd0ec7a74076cull, 0xfae54fd45f6bb189ull, 0xdec00e43715ceae7ull, 0x3b03d9092c1c0be4ull } },
+    { Preset::Blue_Marble, "Blue_Marble", { 0x3e5bfe9151144256ull, 0x1bfe870c43c7f82dull, 0x4978482a1c9d1559ull, 0x5e27a6c8d030fad0ull, 0x82c14ddcee13328cull, 0xa06ad75e230d851aull } },
+    { Preset::Ringed_Giant, "Ringed_Giant", { 0xec05abfa21388f13ull, 0x31dc4ee6a2ff7816ull, 0x1de08653465132bbull, 0x9dc1562c2ca33d66ull, 0xcd1eed802b82b43dull, 0xe698c779440f285full } },
+    { Preset::Ice_Giant, "Ice_Giant", { 0x8a2c050e5d3781d5ull, 0x227a74696eb57f0full, 0xeff881b46ca3ad9aull, 0x349f08cf8fca7da2ull, 0xac9de76b706c2da2ull, 0x1d887866dd3f17b9ull } },
+    { Preset::Rusty_Planet, "Rusty_Planet", { 0xfaa483e9163a63beull, 0xe607ee5812216cb9ull, 0xafb2b9cfb42fad34ull, 0xf7cdbeeace1c4f87ull, 0xe50276438ea291bfull, 0xc157cbd944fd9d3dull } } };
+
+bool PlanetRegression::run(const bool bPrint)
+{
+    //at least 2 threads so the parallel path is compared even on a single core
+    size_t nThreads = std::max<size_t>(2, std::thread::hardware_concurrency());
+    bool bPassed = true;
+    for (auto& golden : GoldenHashes)
+    {
+        uint64_t faceHashes[2][6];
+        for (size_t pass = 0; pass < 2; pass++)
+        {
+            Planet planet(nullptr, MeshType::NORMAL_BIOMES, "Regression", 0);
+            planet.resetToDefaultValues();
+            planet.bMeshCache = false;
+            planet.bBakeElevation = false;
+            planet.nGenerateThreads = pass ? nThreads : 1;
+            planet.initHeadless();
+            planet.setPreset(golden.preset);
+            for (size_t i = 0; i < 6; i++)
+                faceHashes[pass][i] = planet.getFaceBuffers()[i].getContentHash();
+        }
+
+        bool bDeterministic = std::equal(faceHashes[0], faceHashes[0] + 6, faceHashes[1]);
+        bool bMatches = std::equal(faceHashes[0], faceHashes[0] + 6, golden.faceHashes);
+        if (bPrint && bDeterministic)
+        {
+            std::printf("    { Preset::%s, \"%s\", { ", golden.strName, golden.strName);
+            for (size_t i = 0; i < 6; i++)
+                std::printf("0x%016llxull%s", static_cast<unsigned long long>(faceHashes[0][i]), i < 5 ? ", " : " } },\n");
+            continue;
+        }
+        if (!bDeterministic)
+            std::printf("%-14s differs between 1 and %zu threads\n", golden.strName, nThreads);
+        else
+            std::printf("%-14s %s\n", golden.strName, bMatches ? "ok" : "differs from the stored hashes");
+        for (size_t i = 0; i < 6; i++)
+        {
+            if (faceHashes[0][i] != golden.faceHashes[i] || faceHashes[1][i] != faceHashes[0][i])
+                std::printf("  face %zu expected %016llx, got %016llx on 1 thread and %016llx on %zu\n", i, static_cast<unsigned long long>(golden.faceHashes[i]),
+                    static_cast<unsigned long long>(faceHashes[0][i]), static_cast<unsigned long long>(faceHashes[1][i]), nThreads);
+        }
+        bPassed = bPassed && bDeterministic && bMatches;
+    }
+    return bPassed;
+}
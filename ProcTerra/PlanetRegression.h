@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include "Planet.h"
+
+//content hash of every face of a preset at the default sections, see FaceBuffers::getContentHash()
+struct PresetHashes
+{
+	Preset preset;
+	const char* strName;
+	uint64_t faceHashes[6];
+};
+
+//generates every preset on one thread and on all of them and compares the faces with each other and with the stored hashes
+//the stored hashes are for the default float math of x64 builds, fused multiply add or fast math changes them
+class PlanetRegression
+{
+	static const PresetHashes GoldenHashes[PresetCount];
+
+public:
+	static bool run(const bool bPrint);									//prints a report, or the hashes in the form of GoldenHashes when bPrint
+};
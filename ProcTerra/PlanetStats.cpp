@@ -0,0 +1,71 @@
+#include "PlanetStats.h"
+#include <algorithm>
+#include <cstdio>
+
+PlanetStats::PlanetStats() :
+    meshHash(0),
+    contentHash(0),
+    nVertices(0),
+    eMin(0.f),
+    eMax(0.f),
+    eMean(0.f),
+    histogram{},
+    fGenerateMs(0.f)
+{
+}
+
+PlanetStats PlanetStats::compute(const Planet& planet)
+{
+    PlanetStats stats;
+    stats.meshHash = planet.getMeshHash();
+    stats.contentHash = planet.getContentHash();
+    std::vector<size_t> vecBiomeCount(planet.vecBiomes.size());
+    double fSum = 0.0;
+    stats.eMin = 1.f;
+    stats.eMax = -1.f;
+    for (auto& face : planet.getFaceBuffers())
+    {
+        for (float e : face.vecElevations)
+        {
+            stats.eMin = std::min(stats.eMin, e);
+            stats.eMax = std::max(stats.eMax, e);
+            fSum += e;
+            size_t nBin = static_cast<size_t>((std::clamp(e, -1.f, 1.f) + 1.f) * 0.5f * ElevationHistogramBins);
+            stats.histogram[std::min(nBin, ElevationHistogramBins - 1)]++;
+
+            //same lookup as the biome colours, the top biome takes anything above it
+            auto iter = std::find_if(planet.vecBiomes.begin(), planet.vecBiomes.end(), [e](const Biome& biome) { return e < biome.e; });
+            if (!vecBiomeCount.empty())
+                vecBiomeCount[iter == planet.vecBiomes.end() ? vecBiomeCount.size() - 1 : iter - planet.vecBiomes.begin()]++;
+        }
+        stats.nVertices += face.vecElevations.size();
+    }
+
+    if (stats.nVertices == 0)
+    {
+        stats.eMin = stats.eMax = 0.f;
+        return stats;
+    }
+    stats.eMean = static_cast<float>(fSum / stats.nVertices);
+    for (size_t nCount : vecBiomeCount)
+        stats.vecBiomeCoverage.emplace_back(static_cast<float>(nCount) / stats.nVertices);
+    return stats;
+}
+
+std::string PlanetStats::toJson() const
+{
+    char strBuffer[256];
+    std::snprintf(strBuffer, sizeof(strBuffer), "{\"meshHash\":\"%016llx\",\"contentHash\":\"%016llx\",\"vertices\":%zu,\"generateMs\":%.3f,\"elevation\":{\"min\":%.6g,\"max\":%.6g,\"mean\":%.6g,\"histogram\":[",
+        static_cast<unsigned long long>(meshHash), static_cast<unsigned long long>(contentHash), nVertices, fGenerateMs, eMin, eMax, eMean);
+    std::string strJson = strBuffer;
+    for (size_t i = 0; i < histogram.size(); i++)
+        strJson += (i ? "," : "") + std::to_string(histogram[i]);
+    strJson += "]},\"biomeCoverage\":[";
+    for (size_t i = 0; i < vecBiomeCoverage.size(); i++)
+    {
+        std::snprintf(strBuffer, sizeof(strBuffer), "%s%.6g", i ? "," : "", vecBiomeCoverage[i]);
+        strJson += strBuffer;
+    }
+    strJson += "]}";
+    return strJson;
+}
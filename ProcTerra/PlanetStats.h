@@ -0,0 +1,24 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Planet.h"
+
+constexpr size_t ElevationHistogramBins = 32;								//raw elevation -1 to 1
+
+//summary of a generated planet for catalogues and batch runs, counted per vertex of the face buffers
+struct PlanetStats
+{
+	uint64_t meshHash;
+	uint64_t contentHash;											//Planet::getContentHash(), equal for equal planets whatever the thread count
+	size_t nVertices;
+	float eMin, eMax, eMean;
+	std::array<uint32_t, ElevationHistogramBins> histogram;
+	std::vector<float> vecBiomeCoverage;							//fraction of vertices in each biome, same order as Planet::vecBiomes
+	float fGenerateMs;												//filled by the caller
+
+	PlanetStats();
+	static PlanetStats compute(const Planet& planet);				//from the buffers of the last generate()
+	std::string toJson() const;
+};
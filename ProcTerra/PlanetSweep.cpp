@@ -0,0 +1,225 @@
+#include "PlanetSweep.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <thread>
+
+PlanetSweep::PlanetSweep(const std::string& strPlanetFile, const std::vector<std::string>& vecParams) :
+    strPlanetFile(strPlanetFile),
+    vecParams(vecParams)
+{
+}
+
+bool PlanetSweep::addAxis(const std::string& strAxis)
+{
+    size_t nEquals = strAxis.find('=');
+    if (nEquals == std::string::npos)
+        return false;
+    SweepAxis axis{ strAxis.substr(0, nEquals) };
+    std::string strValues = strAxis.substr(nEquals + 1);
+
+    size_t nRange = strValues.find("..");
+    if (nRange != std::string::npos)
+    {
+        //first..last:step, ints unless any of them has a decimal point
+        size_t nStep = strValues.find(':', nRange);
+        std::string strFirst = strValues.substr(0, nRange);
+        std::string strLast = strValues.substr(nRange + 2, nStep == std::string::npos ? std::string::npos : nStep - nRange - 2);
+        std::string strStep = nStep == std::string::npos ? "1" : strValues.substr(nStep + 1);
+        bool bFloat = (strFirst + strLast + strStep).find('.') != std::string::npos;
+        double fFirst = std::atof(strFirst.c_str()), fLast = std::atof(strLast.c_str()), fStep = std::atof(strStep.c_str());
+        if (fStep <= 0.0 || fLast < fFirst || (fLast - fFirst) / fStep >= MaxSweepCount)
+            return false;
+
+        //from the index so float steps dont drift
+        size_t nValues = static_cast<size_t>(std::floor((fLast - fFirst) / fStep + 1e-6)) + 1;
+        for (size_t i = 0; i < nValues; i++)
+        {
+            char strValue[32];
+            if (bFloat)
+                std::snprintf(strValue, sizeof(strValue), "%g", fFirst + i * fStep);
+            else
+                std::snprintf(strValue, sizeof(strValue), "%lld", std::llround(fFirst + i * fStep));
+            axis.vecValues.emplace_back(strValue);
+        }
+    }
+    else
+    {
+        for (size_t nStart = 0; nStart <= strValues.size(); )
+        {
+            size_t nComma = std::min(strValues.find(',', nStart), strValues.size());
+            axis.vecValues.emplace_back(strValues.substr(nStart, nComma - nStart));
+            nStart = nComma + 1;
+        }
+    }
+
+    //every value is checked now rather than failing halfway through the sweep
+    Planet planet(nullptr, MeshType::NORMAL_BIOMES, "Sweep", 0);
+    planet.resetToDefaultValues();
+    for (auto& strValue : axis.vecValues)
+    {
+        if (!planet.setParam(axis.strName, strValue))
+            return false;
+    }
+    if (getCount() * axis.vecValues.size() > MaxSweepCount)
+        return false;
+
+    vecAxes.emplace_back(std::move(axis));
+    return true;
+}
+
+size_t PlanetSweep::getCount() const
+{
+    size_t nCount = 1;
+    for (auto& axis : vecAxes)
+        nCount *= axis.vecValues.size();
+    return nCount;
+}
+
+std::vector<std::string> PlanetSweep::getParams(const size_t index) const
+{
+    //the last axis changes fastest
+    std::vector<std::string> vecParams(vecAxes.size());
+    size_t nRemainder = index;
+    for (size_t i = vecAxes.size(); i-- > 0; )
+    {
+        const SweepAxis& axis = vecAxes[i];
+        vecParams[i] = axis.strName + "=" + axis.vecValues[nRemainder % axis.vecValues.size()];
+        nRemainder /= axis.vecValues.size();
+    }
+    return vecParams;
+}
+
+bool PlanetSweep::initPlanet(Planet& planet, const size_t index) const
+{
+    if (strPlanetFile.empty())
+        planet.resetToDefaultValues();
+    else if (!planet.readPlanetFile(strPlanetFile))
+        return false;
+    planet.bMeshCache = false;
+    planet.bBakeElevation = false;
+    planet.nGenerateThreads = 1;
+
+    for (auto& vecAssignments : { vecParams, getParams(index) })
+    {
+        for (auto& strAssignment : vecAssignments)
+        {
+            size_t nEquals = strAssignment.find('=');
+            if (nEquals == std::string::npos || !planet.setParam(strAssignment.substr(0, nEquals), strAssignment.substr(nEquals + 1)))
+                return false;
+        }
+    }
+    planet.initHeadless();
+    return true;
+}
+
+bool PlanetSweep::run(const std::string& strOut, const size_t nJobs, const size_t nThumbnailWidth, const ThumbnailFormat thumbnailFormat)
+{
+    size_t nCount = getCount();
+    FILE* file = std::fopen((strOut + ".jsonl").c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    //lines are written in index order as soon as the ones before them are done, only those that finished early wait here
+    std::mutex mutexLines;
+    std::map<size_t, std::string> mapLines;
+    size_t nNextLine = 0;
+    auto timeFlush = std::chrono::steady_clock::now();
+    auto writeLine = [&](const size_t index, std::string&& strLine)
+    {
+        std::lock_guard<std::mutex> lock(mutexLines);
+        mapLines.emplace(index, std::move(strLine));
+        for (auto it = mapLines.begin(); it != mapLines.end() && it->first == nNextLine; it = mapLines.erase(it), nNextLine++)
+            std::fputs(it->second.c_str(), file);
+        //a sweep can run for hours, whatever is done is on disk
+        auto timeNow = std::chrono::steady_clock::now();
+        if (timeNow - timeFlush > std::chrono::seconds(1))
+        {
+            std::fflush(file);
+            timeFlush = timeNow;
+        }
+    };
+
+    std::atomic<size_t> nNext(0), nFailed(0);
+    //every thread already renders its own planet
+    ThumbnailSettings thumbnailSettings;
+    thumbnailSettings.nWidth = thumbnailSettings.nHeight = nThumbnailWidth;
+    thumbnailSettings.nThreads = 1;
+    auto timeStart = std::chrono::steady_clock::now();
+
+    //tasks are handed out one planet at a time so slow parameter combinations dont hold up a whole thread's share
+    size_t nThreads = std::max<size_t>(1, std::min(nJobs ? nJobs : std::thread::hardware_concurrency(), nCount));
+    std::vector<std::thread> vecThreads;
+    vecThreads.reserve(nThreads);
+    for (size_t t = 0; t < nThreads; t++)
+    {
+        vecThreads.emplace_back([&]()
+        {
+            for (size_t index = nNext++; index < nCount; index = nNext++)
+            {
+                Planet planet(nullptr, MeshType::NORMAL_BIOMES, "Sweep", 0);
+                if (!initPlanet(planet, index))
+                {
+                    nFailed++;
+                    writeLine(index, std::string());
+                    continue;
+                }
+                auto timeGenerate = std::chrono::steady_clock::now();
+                planet.generate();
+                PlanetStats stats = PlanetStats::compute(planet);
+                stats.fGenerateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeGenerate).count();
+
+                if (nThumbnailWidth)
+                {
+                    char strIndex[32];
+                    std::snprintf(strIndex, sizeof(strIndex), "_%06zu.%s", index, thumbnailFormat == ThumbnailFormat::PNG ? "png" : "ppm");
+                    ThumbnailRenderer thumbnail(planet);
+                    thumbnail.render(thumbnailSettings);
+                    if (!thumbnail.write(strOut + strIndex, thumbnailFormat))
+                        nFailed++;
+                }
+
+                //the values as setParam() read them, the text of the axis can be .5 or 007 which isnt json
+                std::string strLine = "{\"index\":" + std::to_string(index) + ",\"params\":{";
+                std::vector<std::string> vecAssignments = getParams(index);
+                for (size_t i = 0; i < vecAssignments.size(); i++)
+                {
+                    size_t nEquals = vecAssignments[i].find('=');
+                    std::string strName = vecAssignments[i].substr(0, nEquals);
+                    PlanetParam param;
+                    uint32_t value = 0;
+                    bool bFloat = false;
+                    Planet::parseParam(strName, vecAssignments[i].substr(nEquals + 1), param, value, bFloat);
+                    float fValue;
+                    std::memcpy(&fValue, &value, sizeof(fValue));
+                    char strValue[32];
+                    if (!bFloat)
+                        std::snprintf(strValue, sizeof(strValue), "%d", static_cast<int>(value));
+                    else if (std::isfinite(fValue))
+                        std::snprintf(strValue, sizeof(strValue), "%.9g", fValue);
+                    else
+                        std::snprintf(strValue, sizeof(strValue), "null");
+                    strLine += (i ? ",\"" : "\"") + strName + "\":" + strValue;
+                }
+                writeLine(index, strLine + "},\"stats\":" + stats.toJson() + "}\n");
+            }
+        });
+    }
+    for (auto& thread : vecThreads)
+        thread.join();
+
+    float fSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - timeStart).count();
+    std::printf("%zu planets in %.2f s on %zu threads, %.1f planets/sec\n", nCount, fSeconds, nThreads, nCount / std::max(fSeconds, 1e-6f));
+
+    bool bWritten = std::ferror(file) == 0;
+    bWritten = std::fclose(file) == 0 && bWritten;
+    if (nFailed)
+        std::fprintf(stderr, "%zu planets failed\n", nFailed.load());
+    return bWritten && nFailed == 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Planet.h"
+#include "PlanetStats.h"
+#include "ThumbnailRenderer.h"
+
+constexpr size_t SweepThumbnailWidth = 128;										//square
+constexpr size_t MaxSweepCount = 10000000;
+
+//one parameter of the grid, every combination of the values of all the axes is generated
+struct SweepAxis
+{
+	std::string strName;
+	std::vector<std::string> vecValues;
+};
+
+//generates a catalogue of planets from a parameter grid, one planet per task spread over all cores
+//every task has its own Planet and so its own FastNoiseLite objects, only the inputs are shared
+class PlanetSweep
+{
+	std::string strPlanetFile;														//base values, defaults when empty
+	std::vector<std::string> vecParams;												//Name=Value on top of the base for every planet
+	std::vector<SweepAxis> vecAxes;
+
+	bool initPlanet(Planet& planet, const size_t index) const;
+
+public:
+	PlanetSweep(const std::string& strPlanetFile, const std::vector<std::string>& vecParams);
+	bool addAxis(const std::string& strAxis);										//Name=a,b,c or Name=first..last or Name=first..last:step, false if invalid
+	size_t getCount() const;
+	std::vector<std::string> getParams(const size_t index) const;					//Name=Value of every axis for one planet
+	//writes <strOut>.jsonl with one line per planet in index order as they finish, and <strOut>_<index>.png or .ppm thumbnails unless nThumbnailWidth is 0
+	bool run(const std::string& strOut, const size_t nJobs, const size_t nThumbnailWidth, const ThumbnailFormat thumbnailFormat);
+};
@@ -0,0 +1,421 @@
+#include "RingDebris.h"
+#include "Planet.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+constexpr size_t RingDebrisShadeSteps = 256;                             //across the width of a ring, the bands are a few times wider
+
+static_assert(sizeof(RingDebrisInstance) == 9 * sizeof(float), "RingDebrisInstance must match the instance vertex declaration");
+
+//splitmix64, the same sequence on every platform unlike the std distributions
+static float nextRandom(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return static_cast<float>(z >> 40) / 16777216.f;
+}
+
+RingDebrisChunk::RingDebrisChunk(const std::string& strName, const Ogre::MeshPtr& mshRock) :
+    Ogre::SimpleRenderable(strName),
+    mshRock(mshRock),
+    nLod(1),
+    fLodDistance(0.f)
+{
+    mRenderOp.operationType = Ogre::RenderOperation::OT_TRIANGLE_LIST;
+    mRenderOp.useIndexes = true;
+    mRenderOp.numberOfInstances = 0;
+    mRenderOp.vertexData = new Ogre::VertexData();
+
+    // 1st buffer, the rock itself
+    Ogre::VertexDeclaration* decl = mRenderOp.vertexData->vertexDeclaration;
+    size_t offset = 0;
+    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3);
+    decl->addElement(0, offset, Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+
+    // 2nd buffer, one RingDebrisInstance per rock
+    offset = 0;
+    decl->addElement(1, offset, Ogre::VET_FLOAT4, Ogre::VES_TEXTURE_COORDINATES, 0);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT4);
+    decl->addElement(1, offset, Ogre::VET_FLOAT4, Ogre::VES_TEXTURE_COORDINATES, 1);
+    offset += Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT4);
+    decl->addElement(1, offset, Ogre::VET_UBYTE4_NORM, Ogre::VES_COLOUR);
+
+    setLod(0);
+}
+
+RingDebrisChunk::~RingDebrisChunk()
+{
+    delete mRenderOp.vertexData;
+}
+
+void RingDebrisChunk::setLod(const size_t nLod)
+{
+    if (this->nLod == nLod)
+        return;
+    this->nLod = nLod;
+    Ogre::SubMesh* sub = mshRock->getSubMesh(static_cast<unsigned short>(nLod));
+    mRenderOp.vertexData->vertexBufferBinding->setBinding(0, sub->vertexData->vertexBufferBinding->getBuffer(0));
+    mRenderOp.vertexData->vertexCount = sub->vertexData->vertexCount;
+    mRenderOp.indexData = sub->indexData;
+}
+
+void RingDebrisChunk::setInstances(const RingDebrisInstance* pInstances, const size_t nCount, const Ogre::AxisAlignedBox& box)
+{
+    TRACE_SCOPE("RingDebrisChunk::setInstances");
+    //keep the buffer already bound if it is large enough, like the planet buffers
+    Ogre::VertexBufferBinding* bind = mRenderOp.vertexData->vertexBufferBinding;
+    if (!bind->isBufferBound(1) || bind->getBuffer(1)->getNumVertices() < nCount)
+    {
+        Ogre::HardwareVertexBufferSharedPtr vbuf =
+            Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+                mRenderOp.vertexData->vertexDeclaration->getVertexSize(1), nCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+        //advance once per instance instead of once per vertex
+        vbuf->setIsInstanceData(true);
+        vbuf->setInstanceDataStepRate(1);
+        bind->setBinding(1, vbuf);
+    }
+    bind->getBuffer(1)->writeData(0, nCount * sizeof(RingDebrisInstance), static_cast<const void*>(pInstances), true);
+    mRenderOp.numberOfInstances = static_cast<Ogre::uint32>(nCount);
+    setBoundingBox(box);
+}
+
+size_t RingDebrisChunk::getInstanceBufferBytes() const
+{
+    Ogre::VertexBufferBinding* bind = mRenderOp.vertexData->vertexBufferBinding;
+    return bind->isBufferBound(1) ? bind->getBuffer(1)->getSizeInBytes() : 0;
+}
+
+void RingDebrisChunk::_notifyCurrentCamera(Ogre::Camera* cam)
+{
+    //rendering distance culling, then the rock for this distance
+    Ogre::SimpleRenderable::_notifyCurrentCamera(cam);
+    if (mParentNode != nullptr)
+        setLod(mParentNode->getSquaredViewDepth(cam->getLodCamera()) > fLodDistance * fLodDistance ? 1 : 0);
+}
+
+Ogre::Real RingDebrisChunk::getSquaredViewDepth(const Ogre::Camera* cam) const
+{
+    return mParentNode != nullptr ? mParentNode->getSquaredViewDepth(cam) : 0.f;
+}
+
+Ogre::Real RingDebrisChunk::getBoundingRadius() const
+{
+    return mBox.isNull() ? 0.f : std::max(mBox.getMinimum().length(), mBox.getMaximum().length());
+}
+
+RingDebris::RingDebris() :
+    mSceneMgr(nullptr),
+    sceneNode(nullptr),
+    visibilityMask(0),
+    bSunlight(false)
+{
+}
+
+bool RingDebris::init(Ogre::SceneManager* mSceneMgr, const std::string& strName, Ogre::SceneNode* parent, Ogre::uint32 visibilityMask)
+{
+    //the rocks are drawn with per instance vertex data
+    if (!Ogre::Root::getSingleton().getRenderSystem()->getCapabilities()->hasCapability(Ogre::RSC_VERTEX_BUFFER_INSTANCE_DATA))
+    {
+        Ogre::LogManager::getSingleton().logMessage("ProcTerra: no hardware instancing, ring debris is off");
+        return false;
+    }
+    this->mSceneMgr = mSceneMgr;
+    this->strName = strName;
+    this->visibilityMask = visibilityMask;
+    createRock();
+    createMaterials();
+    sceneNode = parent->createChildSceneNode();
+    return true;
+}
+
+void RingDebris::destroy()
+{
+    for (size_t c = 0; c < vecChunks.size(); c++)
+    {
+        vecChunkNodes[c]->detachObject(vecChunks[c]);
+        delete vecChunks[c];
+    }
+    vecChunks.clear();
+    vecChunkNodes.clear();
+    if (sceneNode != nullptr)
+    {
+        sceneNode->removeAndDestroyAllChildren();
+        mSceneMgr->destroySceneNode(sceneNode);
+        sceneNode = nullptr;
+    }
+}
+
+void RingDebris::createRock()
+{
+    //an icosahedron for the far lod and the same one subdivided once for the near lod
+    //both are pushed in and out by the same amount per vertex so switching between them barely shows
+    const float t = (1.f + std::sqrt(5.f)) / 2.f;
+    std::vector<Ogre::Vector3> vecPositions = {
+        { -1.f, t, 0.f }, { 1.f, t, 0.f }, { -1.f, -t, 0.f }, { 1.f, -t, 0.f },
+        { 0.f, -1.f, t }, { 0.f, 1.f, t }, { 0.f, -1.f, -t }, { 0.f, 1.f, -t },
+        { t, 0.f, -1.f }, { t, 0.f, 1.f }, { -t, 0.f, -1.f }, { -t, 0.f, 1.f } };
+    std::vector<unsigned short> vecFarIndices = {
+        0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+        1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+        3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+        4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1 };
+
+    //every edge split at its middle, shared by the 2 triangles on either side
+    std::vector<unsigned short> vecNearIndices;
+    std::map<std::pair<unsigned short, unsigned short>, unsigned short> mapMidpoints;
+    auto getMidpoint = [&vecPositions, &mapMidpoints](unsigned short a, unsigned short b)
+    {
+        auto key = std::make_pair(std::min(a, b), std::max(a, b));
+        auto iter = mapMidpoints.find(key);
+        if (iter != mapMidpoints.end())
+            return iter->second;
+        unsigned short index = static_cast<unsigned short>(vecPositions.size());
+        vecPositions.emplace_back((vecPositions[a] + vecPositions[b]) / 2.f);
+        mapMidpoints.emplace(key, index);
+        return index;
+    };
+    for (size_t i = 0; i < vecFarIndices.size(); i += 3)
+    {
+        unsigned short a = vecFarIndices[i], b = vecFarIndices[i + 1], c = vecFarIndices[i + 2];
+        unsigned short ab = getMidpoint(a, b), bc = getMidpoint(b, c), ca = getMidpoint(c, a);
+        for (unsigned short index : { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca })
+            vecNearIndices.emplace_back(index);
+    }
+
+    //lumpy and a little flattened, about unit radius so the instance size scales it
+    uint64_t state = 0x5EEDF00Dull;
+    for (auto& v : vecPositions)
+    {
+        v.normalise();
+        v *= 0.85f + 0.3f * nextRandom(state);
+        v *= Ogre::Vector3(1.f, 0.7f, 0.85f);
+    }
+
+    mshRock = Ogre::MeshManager::getSingleton().createManual(strName + "DebrisRock", "General");
+    for (const auto* pIndices : { &vecNearIndices, &vecFarIndices })
+    {
+        //smooth normals of this lod, the far one only uses the first 12 vertices
+        size_t nVertexCount = pIndices == &vecFarIndices ? 12 : vecPositions.size();
+        std::vector<Ogre::Vector3> vecNormals(nVertexCount, Ogre::Vector3::ZERO);
+        for (size_t i = 0; i < pIndices->size(); i += 3)
+        {
+            unsigned short a = (*pIndices)[i], b = (*pIndices)[i + 1], c = (*pIndices)[i + 2];
+            Ogre::Vector3 vNormal = (vecPositions[b] - vecPositions[a]).crossProduct(vecPositions[c] - vecPositions[a]);
+            vecNormals[a] += vNormal;
+            vecNormals[b] += vNormal;
+            vecNormals[c] += vNormal;
+        }
+        std::vector<float> vecVertices;
+        vecVertices.reserve(nVertexCount * 6);
+        for (size_t i = 0; i < nVertexCount; i++)
+        {
+            vecNormals[i].normalise();
+            for (float f : { vecPositions[i].x, vecPositions[i].y, vecPositions[i].z, vecNormals[i].x, vecNormals[i].y, vecNormals[i].z })
+                vecVertices.emplace_back(f);
+        }
+
+        Ogre::SubMesh* sub = mshRock->createSubMesh();
+        sub->useSharedVertices = false;
+        sub->vertexData = new Ogre::VertexData();
+        sub->vertexData->vertexCount = nVertexCount;
+        Ogre::VertexDeclaration* decl = sub->vertexData->vertexDeclaration;
+        decl->addElement(0, 0, Ogre::VET_FLOAT3, Ogre::VES_POSITION);
+        decl->addElement(0, Ogre::VertexElement::getTypeSize(Ogre::VET_FLOAT3), Ogre::VET_FLOAT3, Ogre::VES_NORMAL);
+        Ogre::HardwareVertexBufferSharedPtr vbuf =
+            Ogre::HardwareBufferManager::getSingleton().createVertexBuffer(
+                decl->getVertexSize(0), nVertexCount, Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+        vbuf->writeData(0, vbuf->getSizeInBytes(), static_cast<const void*>(vecVertices.data()), true);
+        sub->vertexData->vertexBufferBinding->setBinding(0, vbuf);
+
+        sub->indexData->indexBuffer = Ogre::HardwareBufferManager::getSingleton().createIndexBuffer(
+            Ogre::HardwareIndexBuffer::IT_16BIT, pIndices->size(), Ogre::HardwareBuffer::HBU_STATIC_WRITE_ONLY);
+        sub->indexData->indexBuffer->writeData(0, sub->indexData->indexBuffer->getSizeInBytes(), static_cast<const void*>(pIndices->data()), true);
+        sub->indexData->indexStart = 0;
+        sub->indexData->indexCount = pIndices->size();
+    }
+    mshRock->_setBounds(Ogre::AxisAlignedBox(-1.15f, -1.15f, -1.15f, 1.15f, 1.15f, 1.15f));
+    mshRock->_setBoundingSphereRadius(1.15f);
+    mshRock->load();
+}
+
+void RingDebris::createMaterials()
+{
+    //lit like the ring it belongs to, including the shadow of the planet
+    materialAmbient = Ogre::MaterialManager::getSingleton().create(strName + "DebrisAmbientMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    materialSunlight = Ogre::MaterialManager::getSingleton().create(strName + "DebrisSunlightMtr", Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
+    for (auto& material : { materialAmbient, materialSunlight })
+    {
+        Ogre::Pass* pass = material->getTechnique(0)->getPass(0);
+        pass->setVertexProgram("ProcTerra/RingDebrisVP");
+        pass->setFragmentProgram("ProcTerra/RingDebrisFP");
+        pass->getFragmentProgramParameters()->setNamedConstant("lighting", material == materialSunlight ? 1.f : 0.f);
+        material->load();
+    }
+}
+
+void RingDebris::build(const std::vector<Ring>& vecRings, const int iSeed, const float fSideLength, const size_t nPerRing)
+{
+    TRACE_SCOPE("RingDebris::build");
+    size_t nVisible = 0;
+    for (const auto& ring : vecRings)
+        nVisible += ring.bVisible;
+    //only grows, so rebuilding with the same or fewer rocks doesnt allocate
+    vecInstances.resize(nVisible * nPerRing);
+    vecChunkStarts.clear();
+    vecChunkStarts.emplace_back(0);
+    vecChunkCentres.clear();
+    vecChunkBoxes.clear();
+
+    //each ring has its own sequence from its slot, so showing or hiding one ring leaves the rocks of the others where they were
+    for (size_t r = 0; r < vecRings.size(); r++)
+    {
+        if (vecRings[r].bVisible)
+            scatter(vecRings[r], (static_cast<uint64_t>(static_cast<uint32_t>(iSeed)) << 32) | r, fSideLength, nPerRing);
+    }
+}
+
+void RingDebris::scatter(const Ring& ring, const uint64_t seed, const float fSideLength, const size_t nCount)
+{
+    Ogre::Quaternion orientation = Planet::getRingOrientation(ring);
+    float fOuter = ring.fOuterRingDia * fSideLength / 2.f;
+    float fInner = fOuter * (1.f - ring.fInnerThickness);
+    float fPadding = RingDebrisMaxSize * fSideLength * 1.15f;
+    uint64_t state = seed;
+
+    //the ring colour with its bands from the inner edge to the outer one, the same as Ring.frag
+    Ogre::ColourValue shades[RingDebrisShadeSteps];
+    for (size_t k = 0; k < RingDebrisShadeSteps; k++)
+    {
+        float t = static_cast<float>(k) / (RingDebrisShadeSteps - 1);
+        shades[k] = (ring.colorInner + (ring.colorOuter - ring.colorInner) * t) * Planet::getRingShade(t);
+    }
+    for (size_t s = 0; s < RingDebrisSectors; s++)
+    {
+        //the remainder goes to the first sectors
+        size_t nStart = vecChunkStarts.back();
+        size_t nEnd = nStart + nCount / RingDebrisSectors + (s < nCount % RingDebrisSectors);
+        Ogre::AxisAlignedBox box;
+        for (size_t i = nStart; i < nEnd; i++)
+        {
+            //uniform over the area of the annulus within the angle of this sector, thickest at the ring plane
+            float fRadius = std::sqrt(fInner * fInner + nextRandom(state) * (fOuter * fOuter - fInner * fInner));
+            float fAngle = (s + nextRandom(state)) * Ogre::Math::TWO_PI / RingDebrisSectors;
+            float fHeight = (nextRandom(state) + nextRandom(state) - 1.f) * RingDebrisThickness * fSideLength;
+            Ogre::Vector3 v = orientation * Ogre::Vector3(fRadius * std::cos(fAngle), fHeight, fRadius * std::sin(fAngle));
+
+            //mostly small rocks with the odd large one
+            float fSize = nextRandom(state);
+            fSize = (RingDebrisMinSize + (RingDebrisMaxSize - RingDebrisMinSize) * fSize * fSize * fSize) * fSideLength;
+
+            //uniformly random rotation, a point in the 4d unit ball pushed out onto its surface
+            float rotation[4], fLength;
+            do
+            {
+                for (float& f : rotation)
+                    f = nextRandom(state) * 2.f - 1.f;
+                fLength = rotation[0] * rotation[0] + rotation[1] * rotation[1] + rotation[2] * rotation[2] + rotation[3] * rotation[3];
+            } while (fLength > 1.f || fLength < 0.0001f);
+            fLength = 1.f / std::sqrt(fLength);
+
+            //a little lighter or darker per rock
+            float t = fOuter > fInner ? (fRadius - fInner) / (fOuter - fInner) : 0.f;
+            Ogre::ColourValue colour = shades[static_cast<size_t>(t * (RingDebrisShadeSteps - 1) + 0.5f)] * (0.75f + 0.5f * nextRandom(state));
+            colour.a = 1.f;
+            colour.saturate();
+
+            RingDebrisInstance& instance = vecInstances[i];
+            instance.position[0] = v.x;
+            instance.position[1] = v.y;
+            instance.position[2] = v.z;
+            instance.fSize = fSize;
+            for (size_t q = 0; q < 4; q++)
+                instance.rotation[q] = rotation[q] * fLength;
+            instance.colour = colour.getAsBYTE();
+            box.merge(v);
+        }
+
+        //positions relative to the centre of the chunk so its node is where the rocks are
+        Ogre::Vector3 vCentre = box.isNull() ? Ogre::Vector3::ZERO : box.getCenter();
+        for (size_t i = nStart; i < nEnd; i++)
+        {
+            vecInstances[i].position[0] -= vCentre.x;
+            vecInstances[i].position[1] -= vCentre.y;
+            vecInstances[i].position[2] -= vCentre.z;
+        }
+        if (!box.isNull())
+            box.setExtents(box.getMinimum() - vCentre - Ogre::Vector3(fPadding), box.getMaximum() - vCentre + Ogre::Vector3(fPadding));
+        vecChunkCentres.emplace_back(vCentre);
+        vecChunkBoxes.emplace_back(box);
+        vecChunkStarts.emplace_back(nEnd);
+    }
+}
+
+void RingDebris::upload(const float fSideLength)
+{
+    TRACE_SCOPE("RingDebris::upload");
+    //chunks are only created, a ring that goes away leaves its chunks hidden for when it comes back
+    size_t nChunks = vecChunkCentres.size();
+    while (vecChunks.size() < nChunks)
+    {
+        RingDebrisChunk* chunk = new RingDebrisChunk(strName + "Debris" + std::to_string(vecChunks.size()), mshRock);
+        chunk->setMaterial(bSunlight ? materialSunlight : materialAmbient);
+        chunk->setVisibilityFlags(visibilityMask);
+        Ogre::SceneNode* node = sceneNode->createChildSceneNode();
+        node->attachObject(chunk);
+        vecChunks.emplace_back(chunk);
+        vecChunkNodes.emplace_back(node);
+    }
+
+    for (size_t c = 0; c < vecChunks.size(); c++)
+    {
+        size_t nCount = c < nChunks ? vecChunkStarts[c + 1] - vecChunkStarts[c] : 0;
+        vecChunks[c]->setVisible(nCount != 0);
+        if (nCount == 0)
+            continue;
+        vecChunkNodes[c]->setPosition(vecChunkCentres[c]);
+        vecChunks[c]->setInstances(&vecInstances[vecChunkStarts[c]], nCount, vecChunkBoxes[c]);
+        vecChunks[c]->setLodDistance(RingDebrisLodDistance * fSideLength);
+        vecChunks[c]->setRenderingDistance(RingDebrisMaxDistance * fSideLength);
+    }
+
+    //the shadow of the planet on the rocks
+    for (auto& material : { materialAmbient, materialSunlight })
+        material->getTechnique(0)->getPass(0)->getFragmentProgramParameters()->setNamedConstant("planetRadius", fSideLength / 2.f);
+}
+
+void RingDebris::hide()
+{
+    for (auto chunk : vecChunks)
+        chunk->setVisible(false);
+}
+
+void RingDebris::setLightType(const bool bSunlight)
+{
+    this->bSunlight = bSunlight;
+    for (auto chunk : vecChunks)
+        chunk->setMaterial(bSunlight ? materialSunlight : materialAmbient);
+}
+
+size_t RingDebris::getCpuBytes() const
+{
+    return vecInstances.capacity() * sizeof(RingDebrisInstance) + vecChunkStarts.capacity() * sizeof(size_t) +
+        vecChunkCentres.capacity() * sizeof(Ogre::Vector3) + vecChunkBoxes.capacity() * sizeof(Ogre::AxisAlignedBox);
+}
+
+size_t RingDebris::getGpuBytes() const
+{
+    size_t nBytes = 0;
+    if (mshRock)
+    {
+        for (unsigned short i = 0; i < mshRock->getNumSubMeshes(); i++)
+            nBytes += mshRock->getSubMesh(i)->vertexData->vertexBufferBinding->getBuffer(0)->getSizeInBytes() + mshRock->getSubMesh(i)->indexData->indexBuffer->getSizeInBytes();
+    }
+    for (auto chunk : vecChunks)
+        nBytes += chunk->getInstanceBufferBytes();
+    return nBytes;
+}
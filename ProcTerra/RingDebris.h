@@ -0,0 +1,84 @@
+#pragma once
+#include <Ogre.h>
+#include <string>
+#include <vector>
+
+struct Ring;
+
+constexpr size_t DefaultRingDebrisPerRing = 40000;
+constexpr size_t MaxRingDebrisPerRing = 200000;
+constexpr size_t RingDebrisSectors = 32;									//chunks around each ring, each is culled and picks its lod on its own
+constexpr float RingDebrisThickness = 0.002f;								//how far rocks scatter off the ring plane wrt planet dia
+constexpr float RingDebrisMinSize = 0.0004f;								//rock radius wrt planet dia, most are close to the min
+constexpr float RingDebrisMaxSize = 0.003f;
+constexpr float RingDebrisLodDistance = 0.6f;								//wrt planet dia, chunks further from the camera draw the low detail rock
+constexpr float RingDebrisMaxDistance = 2.5f;								//wrt planet dia, chunks further away arent drawn at all
+
+//per instance vertex data, RingDebris.vert scales, rotates and moves the rock with it
+struct RingDebrisInstance
+{
+	float position[3];														//relative to the chunk node
+	float fSize;
+	float rotation[4];														//quaternion x, y, z, w
+	Ogre::RGBA colour;
+};
+
+//one sector of a ring, all of its rocks in a single instanced draw
+//the rock mesh has the near lod in submesh 0 and the far one in submesh 1, only the geometry binding is swapped between them
+class RingDebrisChunk : public Ogre::SimpleRenderable
+{
+	Ogre::MeshPtr mshRock;
+	size_t nLod;
+	float fLodDistance;
+
+	void setLod(const size_t nLod);
+
+public:
+	RingDebrisChunk(const std::string& strName, const Ogre::MeshPtr& mshRock);
+	~RingDebrisChunk();
+	void setInstances(const RingDebrisInstance* pInstances, const size_t nCount, const Ogre::AxisAlignedBox& box);	//pooled, the buffer only grows
+	void setLodDistance(const float fLodDistance) { this->fLodDistance = fLodDistance; };
+	size_t getInstanceCount() const { return mRenderOp.numberOfInstances; };
+	size_t getInstanceBufferBytes() const;
+
+	void _notifyCurrentCamera(Ogre::Camera* cam) override;										//distance from the lod camera picks the rock
+	Ogre::Real getSquaredViewDepth(const Ogre::Camera* cam) const override;
+	Ogre::Real getBoundingRadius() const override;
+};
+
+//instanced rocks scattered through the visible rings, placed from the planet seed so a planet always gets the same field
+//each chunk has its own node at its centre so the scene manager frustum culls it and drops it past RingDebrisMaxDistance
+class RingDebris
+{
+	Ogre::SceneManager* mSceneMgr;
+	std::string strName;
+	Ogre::SceneNode* sceneNode;
+	Ogre::uint32 visibilityMask;
+	Ogre::MeshPtr mshRock;
+	Ogre::MaterialPtr materialAmbient, materialSunlight;					//ProcTerra/RingDebrisVP and RingDebrisFP
+	bool bSunlight;
+	std::vector<RingDebrisChunk*> vecChunks;								//RingDebrisSectors per ring, unused ones are hidden
+	std::vector<Ogre::SceneNode*> vecChunkNodes;
+	std::vector<RingDebrisInstance> vecInstances;							//of the last build(), grouped by chunk
+	std::vector<size_t> vecChunkStarts;										//first instance of every chunk and the end of the last one
+	std::vector<Ogre::Vector3> vecChunkCentres;
+	std::vector<Ogre::AxisAlignedBox> vecChunkBoxes;						//relative to the centre
+
+	void createRock();
+	void createMaterials();
+	void scatter(const Ring& ring, const uint64_t seed, const float fSideLength, const size_t nCount);
+
+public:
+	RingDebris();
+	bool init(Ogre::SceneManager* mSceneMgr, const std::string& strName, Ogre::SceneNode* parent, Ogre::uint32 visibilityMask);	//false without hardware instancing
+	void destroy();																				//before the scene manager goes, the chunks arent owned by it
+	bool isInitialised() const { return sceneNode != nullptr; };
+
+	void build(const std::vector<Ring>& vecRings, const int iSeed, const float fSideLength, const size_t nPerRing);	//cpu side only, also headless
+	void upload(const float fSideLength);
+	void hide();
+	void setLightType(const bool bSunlight);
+	const std::vector<RingDebrisInstance>& getInstances() const { return vecInstances; };
+	size_t getCpuBytes() const;
+	size_t getGpuBytes() const;
+};
@@ -1,10 +1,44 @@
 #include "Core.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
 
 int main(int argc, char**argv)
 {
 	Core core;
+	//--frame-times <csv> records every frame from startup and writes them on exit
+	//--record-path <file> records the camera for --flythrough
+	//--flythrough [file] flies every preset along the recorded or built in path, prints the frame times, writes --flythrough-out and exits
+	//--no-idle draws every frame even when nothing on screen changes
+	std::string strFlythroughPath, strFlythroughOut = "./flythrough.json";
+	bool bFlythrough = false;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* strValue = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (std::strcmp(argv[i], "--flythrough") == 0)
+		{
+			bFlythrough = true;
+			if (strValue != nullptr && std::strncmp(strValue, "--", 2) != 0)
+				strFlythroughPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--no-idle") == 0)
+			core.setIdleMode(false);
+		else if (strValue == nullptr)
+			continue;
+		else if (std::strcmp(argv[i], "--frame-times") == 0)
+			core.recordFrameTimes(argv[++i]);
+		else if (std::strcmp(argv[i], "--record-path") == 0)
+			core.recordCameraPath(argv[++i]);
+		else if (std::strcmp(argv[i], "--flythrough-out") == 0)
+			strFlythroughOut = argv[++i];
+	}
+	if (bFlythrough && !core.runFlythrough(strFlythroughPath, strFlythroughOut))
+	{
+		std::fprintf(stderr, "cannot read the camera path '%s'\n", strFlythroughPath.c_str());
+		return 1;
+	}
 	core.initApp();
-	core.getRoot()->startRendering();
+	core.run();
 	core.destroy();
 	return 0;
 }
@@ -0,0 +1,406 @@
+#include "ThumbnailRenderer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include "PNGWriter.h"
+
+ThumbnailSettings::ThumbnailSettings() :
+    nWidth(256),
+    nHeight(256),
+    lightType(LightType::DIRECTIONAL),
+    vSunDirection(.55f, .2f, -.75f),
+    colorAmbient(1.f, 1.f, 1.f),
+    colorSunlight(.85f * 1.512f, .86f * 1.512f, .86f * 1.512f),
+    colorBackground(Ogre::ColourValue::Black),
+    fCameraPitch(0.35f),
+    nThreads(0)
+{
+}
+
+ThumbnailRenderer::ThumbnailRenderer(const Planet& planet) :
+    nSections(0),
+    fMinRadius(std::numeric_limits<float>::max()),
+    fMaxRadius(0.f),
+    fFrame(1.f),
+    nWidth(0),
+    nHeight(0)
+{
+    //same order as the faces of the planet
+    const Ogre::Vector3 faces[6] = {
+        Ogre::Vector3::UNIT_Y, Ogre::Vector3::UNIT_X, Ogre::Vector3::UNIT_Z,
+        Ogre::Vector3::NEGATIVE_UNIT_Y, Ogre::Vector3::NEGATIVE_UNIT_X, Ogre::Vector3::NEGATIVE_UNIT_Z };
+    for (size_t i = 0; i < 6; i++)
+    {
+        Ogre::Quaternion vertexRot = Planet::getFaceRotation(faces[i]);
+        const Ogre::Vector3 axes[3] = { vertexRot.xAxis(), vertexRot.yAxis(), vertexRot.zAxis() };
+        for (size_t j = 0; j < 3; j++)
+        {
+            faceAxes[i][j][0] = axes[j].x;
+            faceAxes[i][j][1] = axes[j].y;
+            faceAxes[i][j][2] = axes[j].z;
+        }
+    }
+
+    const std::vector<FaceBuffers>& vecFaceBuffers = planet.getFaceBuffers();
+    if (vecFaceBuffers.size() != 6 || vecFaceBuffers[0].vecColours.empty())
+        return;
+    size_t nSegments = static_cast<size_t>(std::lround(std::sqrt(static_cast<double>(vecFaceBuffers[0].vecColours.size()))));
+    nSections = nSegments - 1;
+    size_t nFaceVertices = nSegments * nSegments;
+    for (auto vec : { &vecRadius, &vecR, &vecG, &vecB, &vecNX, &vecNY, &vecNZ })
+        vec->resize(nFaceVertices * 6);
+
+    for (size_t i = 0; i < 6; i++)
+    {
+        const FaceBuffers& face = vecFaceBuffers[i];
+        auto position = [&face](const size_t j) { return Ogre::Vector3(face.vecVertices[j * 6], face.vecVertices[j * 6 + 1], face.vecVertices[j * 6 + 2]); };
+        for (size_t j = 0; j < nFaceVertices; j++)
+        {
+            size_t k = i * nFaceVertices + j;
+            Ogre::Vector3 v = position(j);
+            vecRadius[k] = v.length();
+            fMinRadius = std::min(fMinRadius, vecRadius[k]);
+            fMaxRadius = std::max(fMaxRadius, vecRadius[k]);
+
+            //RGBA is in byte order
+            unsigned char colour[4];
+            std::memcpy(colour, &face.vecColours[j], 4);
+            vecR[k] = colour[0] / 255.f;
+            vecG[k] = colour[1] / 255.f;
+            vecB[k] = colour[2] / 255.f;
+
+            //normal of the displaced surface from the neighbouring vertices, one sided on the border
+            size_t col = j % nSegments, row = j / nSegments;
+            Ogre::Vector3 vCol = position(row * nSegments + std::min(col + 1, nSections)) - position(row * nSegments + (col ? col - 1 : 0));
+            Ogre::Vector3 vRow = position(std::min(row + 1, nSections) * nSegments + col) - position((row ? row - 1 : 0) * nSegments + col);
+            Ogre::Vector3 vNormal = vCol.crossProduct(vRow);
+            vNormal.normalise();
+            if (vNormal.dotProduct(v) < 0.f)
+                vNormal = -vNormal;
+            vecNX[k] = vNormal.x;
+            vecNY[k] = vNormal.y;
+            vecNZ[k] = vNormal.z;
+        }
+    }
+    //the rings are flat discs with bands, like the ring quads of the app
+    fFrame = fMaxRadius;
+    for (auto& ring : planet.vecRings)
+    {
+        if (!ring.bVisible)
+            continue;
+        float fOuter = ring.fOuterRingDia * planet.fSideLength / 2.f;
+        vecRings.push_back({ Planet::getRingOrientation(ring) * Ogre::Vector3::UNIT_Y, fOuter * (1.f - ring.fInnerThickness), fOuter, ring.colorInner, ring.colorOuter });
+        fFrame = std::max(fFrame, fOuter);
+    }
+    fFrame *= 1.05f;
+}
+
+void ThumbnailRenderer::lookup(const float* x, const float* y, const float* z, int32_t indices[4][ThumbnailPacket], float weights[4][ThumbnailPacket]) const
+{
+    float fSections = static_cast<float>(nSections);
+    int32_t nSegments = static_cast<int32_t>(nSections + 1), nLast = static_cast<int32_t>(nSections - 1);
+
+    //the lanes work on locals written out afterwards, one loop per output, or the compiler assumes the outputs alias faceAxes and each other
+    int32_t base[ThumbnailPacket];
+    float u[ThumbnailPacket], w[ThumbnailPacket];
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+    {
+        //the face is the one of the major axis, y, x, z major are faces 0, 1, 2 and the negative side adds 3
+        float fX = std::abs(x[l]), fY = std::abs(y[l]), fZ = std::abs(z[l]);
+        int32_t bMajorY = static_cast<int32_t>(fY >= fX) & static_cast<int32_t>(fY >= fZ);
+        int32_t bMajorX = (bMajorY ^ 1) & static_cast<int32_t>(fX >= fZ);
+        int32_t bMajorZ = (bMajorY ^ 1) & (bMajorX ^ 1);
+        int32_t bNegative = (bMajorY & static_cast<int32_t>(!(y[l] > 0.f))) | (bMajorX & static_cast<int32_t>(!(x[l] > 0.f))) | (bMajorZ & static_cast<int32_t>(!(z[l] > 0.f)));
+        int32_t i = bMajorX + 2 * bMajorZ + 3 * bNegative;
+
+        //its grid is the default plane at y = -1, the face's axes are loaded by index like the heightfield
+        const float (&axes)[3][3] = faceAxes[i];
+        float fColDot = x[l] * axes[0][0] + y[l] * axes[0][1] + z[l] * axes[0][2];
+        float fPlaneDot = x[l] * axes[1][0] + y[l] * axes[1][1] + z[l] * axes[1][2];
+        float fRowDot = x[l] * axes[2][0] + y[l] * axes[2][1] + z[l] * axes[2][2];
+        float fPlane = -1.f / fPlaneDot;
+        float fCol = (fColDot * fPlane + 1.f) * 0.5f * fSections, fRow = (fRowDot * fPlane + 1.f) * 0.5f * fSections;
+        fCol = fCol > 0.f ? fCol : 0.f;
+        fCol = fCol < fSections ? fCol : fSections;
+        fRow = fRow > 0.f ? fRow : 0.f;
+        fRow = fRow < fSections ? fRow : fSections;
+        int32_t col = static_cast<int32_t>(fCol), row = static_cast<int32_t>(fRow);
+        col = col < nLast ? col : nLast;
+        row = row < nLast ? row : nLast;
+        u[l] = fCol - col;
+        w[l] = fRow - row;
+        base[l] = i * nSegments * nSegments + row * nSegments + col;
+    }
+
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+    {
+        indices[0][l] = base[l];
+        indices[1][l] = base[l] + 1;
+        indices[2][l] = base[l] + nSegments;
+        indices[3][l] = base[l] + nSegments + 1;
+    }
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+    {
+        weights[0][l] = (1.f - u[l]) * (1.f - w[l]);
+        weights[1][l] = u[l] * (1.f - w[l]);
+        weights[2][l] = (1.f - u[l]) * w[l];
+        weights[3][l] = u[l] * w[l];
+    }
+}
+
+void ThumbnailRenderer::getRadius(const float* x, const float* y, const float* z, float* pRadius) const
+{
+    int32_t indices[4][ThumbnailPacket];
+    float weights[4][ThumbnailPacket];
+    lookup(x, y, z, indices, weights);
+    const float* pHeights = vecRadius.data();
+    float fRadius[ThumbnailPacket];
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+        fRadius[l] = pHeights[indices[0][l]] * weights[0][l] + pHeights[indices[1][l]] * weights[1][l] + pHeights[indices[2][l]] * weights[2][l] + pHeights[indices[3][l]] * weights[3][l];
+    std::copy(fRadius, fRadius + ThumbnailPacket, pRadius);
+}
+
+void ThumbnailRenderer::marchPacket(const ThumbnailSettings& settings, const float fCos, const float fSin, const float y, const float* pX, float* pZHit, Ogre::ColourValue* pColours) const
+{
+    //march the shell between the bounding spheres from the camera side, every ray reaching the inner sphere hits
+    //each lane takes its own number of steps, a lane stays in the packet masked off once it hit or ran out of steps
+    float fMaxRadius2 = fMaxRadius * fMaxRadius, fMinRadius2 = fMinRadius * fMinRadius;
+    float fShellSteps = ThumbnailShellSteps / std::max(fMaxRadius - fMinRadius, 1e-3f);
+    float fDist2[ThumbnailPacket], zEnter[ThumbnailPacket], zExit[ThumbnailPacket], zAbove[ThumbnailPacket], zBelow[ThumbnailPacket], fSteps[ThumbnailPacket];
+    int32_t bMarching[ThumbnailPacket], bHit[ThumbnailPacket];                          //masks are ints combined with & and | so the lanes dont branch
+    float fMinSteps = static_cast<float>(ThumbnailShellSteps), fMarchSteps = static_cast<float>(ThumbnailMarchSteps), fMaxSteps = 0.f;
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+    {
+        fDist2[l] = pX[l] * pX[l] + y * y;
+        zEnter[l] = std::sqrt(fMaxRadius2 - fDist2[l]);
+        float fInner2 = fMinRadius2 - fDist2[l];
+        float zInner = std::sqrt(fInner2 > 0.f ? fInner2 : 0.f);
+        zExit[l] = fInner2 > 0.f ? zInner : -zEnter[l];
+        zAbove[l] = zBelow[l] = zEnter[l];
+        float fShell = (zEnter[l] - zExit[l]) * fShellSteps;
+        fShell = fShell > fMinSteps ? fShell : fMinSteps;
+        fShell = fShell < fMarchSteps ? fShell : fMarchSteps;
+        fSteps[l] = static_cast<float>(static_cast<int32_t>(fShell));                    //truncating is the floor, the shell is at least the minimum steps
+        bMarching[l] = 1;
+        bHit[l] = 0;
+    }
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+        fMaxSteps = std::max(fMaxSteps, fSteps[l]);
+
+    float dx[ThumbnailPacket], dy[ThumbnailPacket], dz[ThumbnailPacket], r[ThumbnailPacket], z[ThumbnailPacket], fRadius[ThumbnailPacket];
+    auto direction = [&]()
+    {
+        for (size_t l = 0; l < ThumbnailPacket; l++)
+        {
+            r[l] = std::sqrt(fDist2[l] + z[l] * z[l]);
+            dx[l] = pX[l] / r[l];
+            dy[l] = (y * fCos + z[l] * fSin) / r[l];
+            dz[l] = (z[l] * fCos - y * fSin) / r[l];
+        }
+    };
+    for (float fStep = 1.f; fStep <= fMaxSteps; fStep++)
+    {
+        for (size_t l = 0; l < ThumbnailPacket; l++)
+            z[l] = zEnter[l] + (zExit[l] - zEnter[l]) * fStep / fSteps[l];
+        direction();
+        getRadius(dx, dy, dz, fRadius);
+        int32_t bAny = 0;
+        for (size_t l = 0; l < ThumbnailPacket; l++)
+        {
+            int32_t bStep = bMarching[l] & static_cast<int32_t>(fStep <= fSteps[l]);
+            int32_t bAbove = static_cast<int32_t>(r[l] > fRadius[l]);
+            zAbove[l] = bStep & bAbove ? z[l] : zAbove[l];
+            zBelow[l] = bStep & (bAbove ^ 1) ? z[l] : zBelow[l];
+            bHit[l] |= bStep & (bAbove ^ 1);
+            bMarching[l] = bStep & bAbove;
+            bAny |= bMarching[l];
+        }
+        if (!bAny)
+            break;
+    }
+
+    //bisection between the last step above the surface and the first below it, lanes that missed keep their values
+    for (size_t refine = 0; refine < ThumbnailRefineSteps; refine++)
+    {
+        for (size_t l = 0; l < ThumbnailPacket; l++)
+            z[l] = (zAbove[l] + zBelow[l]) * 0.5f;
+        direction();
+        getRadius(dx, dy, dz, fRadius);
+        for (size_t l = 0; l < ThumbnailPacket; l++)
+        {
+            int32_t bAbove = static_cast<int32_t>(r[l] > fRadius[l]);
+            zAbove[l] = bHit[l] & bAbove ? z[l] : zAbove[l];
+            zBelow[l] = bHit[l] & (bAbove ^ 1) ? z[l] : zBelow[l];
+        }
+    }
+
+    int32_t indices[4][ThumbnailPacket];
+    float weights[4][ThumbnailPacket];
+    std::copy(zBelow, zBelow + ThumbnailPacket, z);
+    direction();
+    lookup(dx, dy, dz, indices, weights);
+    Ogre::Vector3 vLight = -settings.vSunDirection.normalisedCopy();
+    for (size_t l = 0; l < ThumbnailPacket; l++)
+    {
+        pZHit[l] = bHit[l] ? zBelow[l] : -std::numeric_limits<float>::max();
+        pColours[l] = settings.colorBackground;
+        if (!bHit[l])
+            continue;
+
+        float fR = 0.f, fG = 0.f, fB = 0.f, fNX = 0.f, fNY = 0.f, fNZ = 0.f;
+        for (size_t n = 0; n < 4; n++)
+        {
+            int32_t index = indices[n][l];
+            fR += vecR[index] * weights[n][l];
+            fG += vecG[index] * weights[n][l];
+            fB += vecB[index] * weights[n][l];
+            fNX += vecNX[index] * weights[n][l];
+            fNY += vecNY[index] * weights[n][l];
+            fNZ += vecNZ[index] * weights[n][l];
+        }
+        Ogre::ColourValue colour(fR, fG, fB);
+        if (settings.lightType == LightType::DIRECTIONAL)
+        {
+            float fDiffuse = (fNX * vLight.x + fNY * vLight.y + fNZ * vLight.z) / std::max(std::sqrt(fNX * fNX + fNY * fNY + fNZ * fNZ), 1e-6f);
+            colour = colour * settings.colorSunlight * std::max(0.f, fDiffuse);
+        }
+        else
+            colour = colour * settings.colorAmbient;
+        pColours[l] = colour;
+    }
+}
+
+void ThumbnailRenderer::renderRows(const ThumbnailSettings& settings, const size_t row0, const size_t nRows)
+{
+    //the camera looks down at the planet by the pitch, the planet is marched in camera space and looked up in world space
+    float fCos = std::cos(settings.fCameraPitch), fSin = std::sin(settings.fCameraPitch);
+    Ogre::Vector3 vLight = -settings.vSunDirection.normalisedCopy();
+    Ogre::Vector3 vLightCamera(vLight.x, vLight.y * fCos - vLight.z * fSin, vLight.y * fSin + vLight.z * fCos);
+    bool bSunlight = settings.lightType == LightType::DIRECTIONAL;
+    float fPixel = 2.f * fFrame / static_cast<float>(std::min(nWidth, nHeight));
+    float fMaxRadius2 = fMaxRadius * fMaxRadius, fMinRadius2 = fMinRadius * fMinRadius;
+
+    //the planet of a row first, packets are made only of the pixels inside the outer sphere and the last one is padded with its last ray
+    std::vector<float> vecZHit(nWidth);
+    std::vector<Ogre::ColourValue> vecColours(nWidth);
+    std::vector<size_t> vecInside;
+    vecInside.reserve(nWidth);
+    for (size_t row = row0; row < row0 + nRows; row++)
+    {
+        float y = (static_cast<float>(nHeight) * 0.5f - static_cast<float>(row) - 0.5f) * fPixel;
+        vecInside.clear();
+        for (size_t col = 0; col < nWidth; col++)
+        {
+            float x = (static_cast<float>(col) + 0.5f - static_cast<float>(nWidth) * 0.5f) * fPixel;
+            vecZHit[col] = -std::numeric_limits<float>::max();
+            vecColours[col] = settings.colorBackground;
+            if (x * x + y * y < fMaxRadius2 && !vecRadius.empty())
+                vecInside.push_back(col);
+        }
+        for (size_t first = 0; first < vecInside.size(); first += ThumbnailPacket)
+        {
+            size_t nLanes = std::min(ThumbnailPacket, vecInside.size() - first);
+            float x[ThumbnailPacket], zHit[ThumbnailPacket];
+            Ogre::ColourValue colours[ThumbnailPacket];
+            for (size_t l = 0; l < ThumbnailPacket; l++)
+                x[l] = (static_cast<float>(vecInside[first + std::min(l, nLanes - 1)]) + 0.5f - static_cast<float>(nWidth) * 0.5f) * fPixel;
+            marchPacket(settings, fCos, fSin, y, x, zHit, colours);
+            for (size_t l = 0; l < nLanes; l++)
+            {
+                vecZHit[vecInside[first + l]] = zHit[l];
+                vecColours[vecInside[first + l]] = colours[l];
+            }
+        }
+
+        for (size_t col = 0; col < nWidth; col++)
+        {
+            float x = (static_cast<float>(col) + 0.5f - static_cast<float>(nWidth) * 0.5f) * fPixel;
+            float fDist2 = x * x + y * y;
+            float zHit = vecZHit[col];
+            Ogre::ColourValue colour = vecColours[col];
+
+            //nearest ring in front of the planet, lit from both sides and in the shadow of the planet
+            for (auto& ring : vecRings)
+            {
+                Ogre::Vector3 vNormal(ring.vNormal.x, ring.vNormal.y * fCos - ring.vNormal.z * fSin, ring.vNormal.y * fSin + ring.vNormal.z * fCos);
+                if (std::abs(vNormal.z) < 1e-4f)
+                    continue;
+                float z = -(x * vNormal.x + y * vNormal.y) / vNormal.z;
+                float r = std::sqrt(fDist2 + z * z);
+                if (z <= zHit || r < ring.fInner || r > ring.fOuter)
+                    continue;
+                zHit = z;
+
+                float t = (r - ring.fInner) / std::max(ring.fOuter - ring.fInner, 1e-6f);
+                colour = (ring.colorInner * (1.f - t) + ring.colorOuter * t) * Planet::getRingShade(t);
+                if (bSunlight)
+                {
+                    Ogre::Vector3 v(x, y, z);
+                    float fTowardsLight = v.dotProduct(vLightCamera);
+                    bool bShadow = fTowardsLight < 0.f && (v - vLightCamera * fTowardsLight).squaredLength() < fMinRadius2;
+                    colour = colour * (bShadow ? Ogre::ColourValue(0.f, 0.f, 0.f) : settings.colorSunlight * std::abs(vNormal.dotProduct(vLightCamera)));
+                }
+                else
+                    colour = colour * settings.colorAmbient;
+            }
+
+            unsigned char* pPixel = &vecPixels[(row * nWidth + col) * 3];
+            pPixel[0] = static_cast<unsigned char>(std::clamp(colour.r, 0.f, 1.f) * 255.f + 0.5f);
+            pPixel[1] = static_cast<unsigned char>(std::clamp(colour.g, 0.f, 1.f) * 255.f + 0.5f);
+            pPixel[2] = static_cast<unsigned char>(std::clamp(colour.b, 0.f, 1.f) * 255.f + 0.5f);
+        }
+    }
+}
+
+const std::vector<unsigned char>& ThumbnailRenderer::render(const ThumbnailSettings& settings)
+{
+    nWidth = settings.nWidth;
+    nHeight = settings.nHeight;
+    vecPixels.resize(nWidth * nHeight * 3);
+    if (nWidth == 0 || nHeight == 0)
+        return vecPixels;
+
+    //bands of rows per thread, small images arent worth starting threads for
+    size_t nThreads = std::max<size_t>(1, std::min<size_t>(settings.nThreads ? settings.nThreads : std::thread::hardware_concurrency(), nHeight / 32));
+    size_t nBand = (nHeight + nThreads - 1) / nThreads;
+    std::vector<std::thread> vecThreads;
+    for (size_t t = 1; t < nThreads; t++)
+    {
+        size_t row0 = t * nBand;
+        if (row0 < nHeight)
+            vecThreads.emplace_back([this, &settings, row0, nBand]() { renderRows(settings, row0, std::min(nBand, nHeight - row0)); });
+    }
+    renderRows(settings, 0, std::min(nBand, nHeight));
+    for (auto& thread : vecThreads)
+        thread.join();
+    return vecPixels;
+}
+
+bool ThumbnailRenderer::write(const std::string& strPath, const ThumbnailFormat format) const
+{
+    FILE* file = std::fopen(strPath.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+    bool bWritten = write(file, format);
+    return std::fclose(file) == 0 && bWritten;
+}
+
+bool ThumbnailRenderer::write(FILE* file, const ThumbnailFormat format) const
+{
+    if (format == ThumbnailFormat::PNG)
+    {
+        PNGWriter png;
+        png.begin(file, nWidth, nHeight, 8, PNGColourType::RGB);
+        png.writeRows(vecPixels.data(), nHeight);
+        png.end();
+    }
+    else
+    {
+        std::fprintf(file, "P6\n%zu %zu\n255\n", nWidth, nHeight);
+        std::fwrite(vecPixels.data(), 1, vecPixels.size(), file);
+    }
+    return std::fflush(file) == 0 && std::ferror(file) == 0;
+}
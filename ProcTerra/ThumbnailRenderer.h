@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Planet.h"
+
+constexpr size_t ThumbnailShellSteps = 8;									//heightfield steps for a ray straight through the shell between the bounding spheres
+constexpr size_t ThumbnailMarchSteps = 32;									//at most, rays near the edge cross a lot more of the shell
+constexpr size_t ThumbnailRefineSteps = 6;									//bisection after the first step below the surface
+constexpr size_t ThumbnailPacket = 8;										//rays marched in lockstep, one lane each
+
+enum class ThumbnailFormat
+{
+	PPM,
+	PNG
+};
+
+//same defaults as the sunlight in Core
+struct ThumbnailSettings
+{
+	size_t nWidth, nHeight;
+	LightType lightType;
+	Ogre::Vector3 vSunDirection;										//direction the light travels
+	Ogre::ColourValue colorAmbient;										//ambient mode only, the sunlight has none like in Core
+	Ogre::ColourValue colorSunlight;									//diffuse times power scale
+	Ogre::ColourValue colorBackground;
+	float fCameraPitch;													//radians looking down, rings with no pitch would be edge on from the default camera
+	size_t nThreads;													//0 for all cores, 1 when the caller already runs one render per core
+	ThumbnailSettings();
+};
+
+//ray casts a generated planet and its rings on the cpu, no gpu or render system needed
+//the heightfield is the face buffers of the last generate() looked up with the same grid as the mesh
+//the camera is orthographic, like the default orbit camera on +z but looking down a little
+class ThumbnailRenderer
+{
+	struct RingDisc
+	{
+		Ogre::Vector3 vNormal;
+		float fInner, fOuter;
+		Ogre::ColourValue colorInner, colorOuter;
+	};
+
+	//structure of arrays of all 6 faces, every lane of a packet loads from them by index
+	size_t nSections;
+	std::vector<float> vecRadius, vecR, vecG, vecB, vecNX, vecNY, vecNZ;
+	float fMinRadius, fMaxRadius, fFrame;
+	float faceAxes[6][3][3];													//x, y and z axis of every face, rotates a direction into the default face plane
+	std::vector<RingDisc> vecRings;
+	size_t nWidth, nHeight;
+	std::vector<unsigned char> vecPixels;
+
+	//bilinear weights and the 4 indices of a packet of unit directions in the face grid
+	//every lane runs the same branchless float math so the compiler can vectorise it, the heightfield loads are gathers
+	void lookup(const float* x, const float* y, const float* z, int32_t indices[4][ThumbnailPacket], float weights[4][ThumbnailPacket]) const;
+	void getRadius(const float* x, const float* y, const float* z, float* pRadius) const;
+	//colour and depth of the planet for a packet of pixels of one row, lanes that hit or leave the shell are masked off until all are done
+	void marchPacket(const ThumbnailSettings& settings, const float fCos, const float fSin, const float y, const float* pX, float* pZHit, Ogre::ColourValue* pColours) const;
+	void renderRows(const ThumbnailSettings& settings, const size_t row0, const size_t nRows);
+
+public:
+	ThumbnailRenderer(const Planet& planet);									//copies what it needs, the planet can change afterwards
+	const std::vector<unsigned char>& render(const ThumbnailSettings& settings);	//rgb, rows from the top
+	bool write(const std::string& strPath, const ThumbnailFormat format) const;	//the last render()
+	bool write(FILE* file, const ThumbnailFormat format) const;					//into any open stream, the caller closes it
+};
@@ -0,0 +1,124 @@
+#include "Trace.h"
+#ifdef PROCTERRA_TRACE
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//the events of one thread in one recording, only that thread appends to it
+struct TraceThreadBuffer
+{
+    TraceChunk* pHead;
+    TraceChunk* pTail;
+    uint32_t nSession;
+    int iThreadId;
+    std::atomic<const char*> strThreadName;
+
+    TraceThreadBuffer(const uint32_t nSession, const int iThreadId, const char* strThreadName) :
+        pHead(new TraceChunk()), pTail(pHead), nSession(nSession), iThreadId(iThreadId), strThreadName(strThreadName)
+    {}
+    ~TraceThreadBuffer()
+    {
+        for (TraceChunk* pChunk = pHead; pChunk != nullptr;)
+        {
+            TraceChunk* pNext = pChunk->pNext.load(std::memory_order_relaxed);
+            delete pChunk;
+            pChunk = pNext;
+        }
+    }
+};
+
+std::atomic<bool> Trace::bRecording(false);
+
+//only touched once per thread and recording, never for an event
+static std::mutex mutexThreads;
+static std::vector<std::shared_ptr<TraceThreadBuffer>> vecThreads;
+static std::atomic<uint32_t> nSession(0);
+static int64_t nSessionStartNs = 0;
+static int iNextThreadId = 0;
+
+static thread_local std::shared_ptr<TraceThreadBuffer> pThreadBuffer;
+static thread_local const char* strThreadName = nullptr;
+
+void Trace::start()
+{
+    std::lock_guard<std::mutex> lock(mutexThreads);
+    //threads still holding a buffer of the last recording replace it with their next event
+    vecThreads.clear();
+    iNextThreadId = 0;
+    nSessionStartNs = now();
+    nSession++;
+    bRecording = true;
+}
+
+bool Trace::stop(const std::string& strPath)
+{
+    bRecording = false;
+    std::vector<std::shared_ptr<TraceThreadBuffer>> vecBuffers;
+    int64_t nStartNs;
+    {
+        std::lock_guard<std::mutex> lock(mutexThreads);
+        vecBuffers = vecThreads;
+        nStartNs = nSessionStartNs;
+    }
+
+    FILE* file = std::fopen(strPath.c_str(), "w");
+    if (file == nullptr)
+        return false;
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool bFirst = true;
+    for (const auto& pBuffer : vecBuffers)
+    {
+        const char* strName = pBuffer->strThreadName.load();
+        if (strName != nullptr)
+        {
+            std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", bFirst ? "" : ",\n", pBuffer->iThreadId, strName);
+            bFirst = false;
+        }
+        //a thread may still be appending its last event, counts only cover events that are completely written
+        for (TraceChunk* pChunk = pBuffer->pHead; pChunk != nullptr; pChunk = pChunk->pNext.load(std::memory_order_acquire))
+        {
+            size_t nCount = pChunk->nCount.load(std::memory_order_acquire);
+            for (size_t i = 0; i < nCount; i++)
+            {
+                const TraceEvent& event = pChunk->events[i];
+                std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", bFirst ? "" : ",\n",
+                    event.strName, pBuffer->iThreadId, (event.nStartNs - nStartNs) / 1000.0, event.nDurationNs / 1000.0);
+                bFirst = false;
+            }
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}
+
+void Trace::setThreadName(const char* strName)
+{
+    strThreadName = strName;
+    if (pThreadBuffer)
+        pThreadBuffer->strThreadName = strName;
+}
+
+void Trace::record(const char* strName, const int64_t nStartNs, const int64_t nEndNs)
+{
+    uint32_t nCurrentSession = nSession.load(std::memory_order_acquire);
+    if (!pThreadBuffer || pThreadBuffer->nSession != nCurrentSession)
+    {
+        std::lock_guard<std::mutex> lock(mutexThreads);
+        pThreadBuffer = std::make_shared<TraceThreadBuffer>(nCurrentSession, iNextThreadId++, strThreadName);
+        vecThreads.emplace_back(pThreadBuffer);
+    }
+
+    TraceChunk* pTail = pThreadBuffer->pTail;
+    size_t nCount = pTail->nCount.load(std::memory_order_relaxed);
+    if (nCount == TraceChunkEvents)
+    {
+        TraceChunk* pChunk = new TraceChunk();
+        pTail->pNext.store(pChunk, std::memory_order_release);
+        pThreadBuffer->pTail = pTail = pChunk;
+        nCount = 0;
+    }
+    pTail->events[nCount] = TraceEvent{ strName, nStartNs, nEndNs - nStartNs };
+    pTail->nCount.store(nCount + 1, std::memory_order_release);
+}
+#endif
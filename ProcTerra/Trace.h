@@ -0,0 +1,66 @@
+#pragma once
+//scoped markers written as chrome trace event json, open the file in chrome://tracing or ui.perfetto.dev
+//only built with -DPROCTERRA_TRACE (cmake -DPROCTERRA_TRACE=ON), otherwise TRACE_SCOPE is nothing at all
+#ifdef PROCTERRA_TRACE
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+constexpr size_t TraceChunkEvents = 4096;									//events per allocation of a thread's buffer
+
+struct TraceEvent
+{
+	const char* strName;													//string literal, only the pointer is kept
+	int64_t nStartNs, nDurationNs;
+};
+
+//every thread appends to its own list of chunks without locking, the writer follows them from the head
+//nCount and pNext are published after the events they cover so a writer never reads a half written event
+struct TraceChunk
+{
+	TraceEvent events[TraceChunkEvents];
+	std::atomic<size_t> nCount;
+	std::atomic<TraceChunk*> pNext;
+	TraceChunk() : nCount(0), pNext(nullptr) {}
+};
+
+class Trace
+{
+public:
+	static void start();																	//drops anything recorded before
+	static bool stop(const std::string& strPath);											//stops recording and writes what was recorded
+	static bool isRecording() { return bRecording.load(std::memory_order_relaxed); }
+	static void setThreadName(const char* strName);											//shown in the viewer in place of the thread id
+	static int64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+	static void record(const char* strName, const int64_t nStartNs, const int64_t nEndNs);
+
+private:
+	static std::atomic<bool> bRecording;
+};
+
+//records from construction to destruction, costs one relaxed load when not recording
+class TraceScope
+{
+	const char* strName;
+	int64_t nStartNs;
+
+public:
+	TraceScope(const char* strName) : strName(strName), nStartNs(Trace::isRecording() ? Trace::now() : 0) {}
+	~TraceScope()
+	{
+		if (nStartNs != 0 && Trace::isRecording())
+			Trace::record(strName, nStartNs, Trace::now());
+	}
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
@@ -0,0 +1,47 @@
+#include <OgreUnifiedShader.h>
+
+// the annulus, its colour gradient and bands are worked out per pixel so the edges stay round at any distance
+// keep in step with Planet::getRingShade() and the thumbnail renderer
+
+OGRE_UNIFORMS(
+    uniform vec4 ambient;
+    uniform vec4 lightDiffuse;
+    uniform vec4 lightDirection;
+    uniform float lighting;
+    uniform float planetRadius;
+    uniform float bandStrength;
+    uniform float bandFrequency;
+)
+
+MAIN_PARAMETERS
+IN(vec3 oPosition, TEXCOORD0)
+IN(vec3 oNormal, TEXCOORD1)
+IN(vec4 oColourOuter, TEXCOORD2)
+IN(vec4 oColourInner, TEXCOORD3)
+IN(vec2 oUv, TEXCOORD4)
+MAIN_DECLARATION
+{
+    float r = length(oUv);
+    float fInner = oColourInner.w;
+    if (r > 1.0 || r < fInner)
+        discard;
+
+    // 0 at the inner edge, 1 at the outer one
+    float t = (r - fInner) / max(1.0 - fInner, 0.000001);
+    vec3 colour = mix(oColourInner.rgb, oColourOuter.rgb, t);
+    colour *= 1.0 - bandStrength * (0.5 + 0.5 * sin(t * bandFrequency + 3.0 * sin(t * bandFrequency * 0.37)));
+
+    vec3 light = ambient.rgb;
+    if (lighting > 0.5)
+    {
+        // lit from both sides, dark where the planet is between the ring and the sun
+        vec3 vLight = normalize(lightDirection.xyz);
+        float fTowardsLight = dot(oPosition, vLight);
+        vec3 vClosest = oPosition - vLight * fTowardsLight;
+        float fShadow = 1.0;
+        if (fTowardsLight < 0.0 && dot(vClosest, vClosest) < planetRadius * planetRadius)
+            fShadow = 0.0;
+        light += lightDiffuse.rgb * abs(dot(normalize(oNormal), vLight)) * fShadow;
+    }
+    gl_FragColor = vec4(colour * light, 1.0);
+}
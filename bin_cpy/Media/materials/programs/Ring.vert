@@ -0,0 +1,29 @@
+#include <OgreUnifiedShader.h>
+
+// one quad per ring in the ring plane, uv0 is -1 to 1 across the outer diameter
+
+OGRE_UNIFORMS(
+    uniform mat4 worldViewProj;
+)
+
+MAIN_PARAMETERS
+IN(vec4 vertex, POSITION)
+IN(vec3 normal, NORMAL)
+IN(vec4 colour, COLOR)
+IN(vec2 uv0, TEXCOORD0)
+IN(vec4 uv1, TEXCOORD1)
+OUT(vec3 oPosition, TEXCOORD0)
+OUT(vec3 oNormal, TEXCOORD1)
+OUT(vec4 oColourOuter, TEXCOORD2)
+OUT(vec4 oColourInner, TEXCOORD3)
+OUT(vec2 oUv, TEXCOORD4)
+MAIN_DECLARATION
+{
+    gl_Position = mul(worldViewProj, vertex);
+    oPosition = vertex.xyz;
+    oNormal = normal;
+    oColourOuter = colour;
+    // inner colour and the inner radius over the outer one in w
+    oColourInner = uv1;
+    oUv = uv0;
+}
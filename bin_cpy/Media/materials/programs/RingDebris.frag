@@ -0,0 +1,32 @@
+#include <OgreUnifiedShader.h>
+
+// lit like Ring.frag, one sided since the rocks are closed
+
+OGRE_UNIFORMS(
+    uniform vec4 ambient;
+    uniform vec4 lightDiffuse;
+    uniform vec4 lightDirection;
+    uniform float lighting;
+    uniform float planetRadius;
+)
+
+MAIN_PARAMETERS
+IN(vec3 oPosition, TEXCOORD0)
+IN(vec3 oNormal, TEXCOORD1)
+IN(vec4 oColour, TEXCOORD2)
+MAIN_DECLARATION
+{
+    vec3 light = ambient.rgb;
+    if (lighting > 0.5)
+    {
+        // dark where the planet is between the rock and the sun
+        vec3 vLight = normalize(lightDirection.xyz);
+        float fTowardsLight = dot(oPosition, vLight);
+        vec3 vClosest = oPosition - vLight * fTowardsLight;
+        float fShadow = 1.0;
+        if (fTowardsLight < 0.0 && dot(vClosest, vClosest) < planetRadius * planetRadius)
+            fShadow = 0.0;
+        light += lightDiffuse.rgb * max(dot(normalize(oNormal), vLight), 0.0) * fShadow;
+    }
+    gl_FragColor = vec4(oColour.rgb * light, 1.0);
+}
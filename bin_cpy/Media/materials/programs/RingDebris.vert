@@ -0,0 +1,32 @@
+#include <OgreUnifiedShader.h>
+
+// one rock per instance, the instance data is the position relative to the chunk and size in uv0, the rotation in uv1
+
+OGRE_UNIFORMS(
+    uniform mat4 worldViewProj;
+    uniform mat4 world;
+)
+
+vec3 rotate(vec4 q, vec3 v)
+{
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+MAIN_PARAMETERS
+IN(vec4 vertex, POSITION)
+IN(vec3 normal, NORMAL)
+IN(vec4 colour, COLOR)
+IN(vec4 uv0, TEXCOORD0)
+IN(vec4 uv1, TEXCOORD1)
+OUT(vec3 oPosition, TEXCOORD0)
+OUT(vec3 oNormal, TEXCOORD1)
+OUT(vec4 oColour, TEXCOORD2)
+MAIN_DECLARATION
+{
+    vec4 position = vec4(rotate(uv1, vertex.xyz * uv0.w) + uv0.xyz, 1.0);
+    gl_Position = mul(worldViewProj, position);
+    // the chunk node only moves the rocks, so the planet centre is the origin of the world
+    oPosition = mul(world, position).xyz;
+    oNormal = rotate(uv1, normal);
+    oColour = colour;
+}